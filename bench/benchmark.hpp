@@ -0,0 +1,286 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/utility.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	namespace cr = std::chrono;
+	namespace ut = utility;
+
+	// Keeps the optimizer from discarding a computed value.
+	template <typename T>
+	void doNotOptimize(const T& value)
+	{
+#if defined _MSC_VER
+		const volatile auto sink{ reinterpret_cast<const volatile char*>(&value) };
+		static_cast<void>(*sink);
+#else
+		asm volatile("" : : "g"(&value) : "memory");
+#endif
+	}
+
+	// Counts calls to the global operator new, which main.cpp replaces.
+	inline std::atomic<std::size_t> allocationCount{};
+
+	struct Options
+	{
+		std::string filter;
+		std::string jsonPath;
+		std::string revision;
+		cr::milliseconds warmup{ 200 };
+		cr::milliseconds minSampleTime{ 5 };
+		std::size_t repetitions{ 30 };
+	};
+
+	struct Result
+	{
+		std::string name;
+		std::size_t iterations{};
+		std::size_t repetitions{};
+
+		// Items per second at the median, zero if the case has no items.
+		double throughput{};
+
+		// All times are nanoseconds per iteration.
+		double min{};
+		double mean{};
+		double stddev{};
+		double p50{};
+		double p90{};
+		double p99{};
+		double max{};
+	};
+
+	// Runs every registered case in three phases: the iteration count per 
+	// sample is doubled until one sample takes at least minSampleTime, then 
+	// the case runs untimed for the warmup period, and finally it is timed 
+	// for the requested number of repetitions. Percentiles are taken over 
+	// the per-sample times, which filters out scheduler noise.
+	class Runner
+	{
+		using Clock = cr::steady_clock;
+
+		struct Case
+		{
+			std::string name;
+			std::function<void(std::size_t)> body;
+			double itemsPerIteration;
+		};
+
+		Options _options;
+		std::vector<Case> _cases;
+		std::vector<Result> _results;
+
+	public:
+		explicit Runner(Options options)
+			: _options{ std::move(options) }
+		{}
+
+		// body(iterations) has to execute the measured operation 
+		// exactly iterations times.
+		void add(std::string name, std::function<void(std::size_t)> body)
+		{
+			add(std::move(name), 0.0, std::move(body));
+		}
+
+		// Same, but also reports throughput for cases that process a 
+		// known number of items (segments, pixels, ...) per iteration.
+		void add(std::string name, double itemsPerIteration, 
+			std::function<void(std::size_t)> body)
+		{
+			if (name.find(_options.filter) != std::string::npos)
+			{
+				_cases.push_back({ std::move(name), std::move(body), itemsPerIteration });
+			}
+		}
+
+		auto& results() const
+		{
+			return _results;
+		}
+
+		void run()
+		{
+			std::printf("%-40s %12s %12s %12s %12s %12s %12s\n", "benchmark", 
+				"iterations", "min ns", "p50 ns", "p90 ns", "p99 ns", "items/s");
+
+			for (auto& c : _cases)
+			{
+				_results.push_back(runCase(c));
+
+				const auto& r{ _results.back() };
+
+				std::printf("%-40s %12zu %12.1f %12.1f %12.1f %12.1f %12.4g\n",
+					r.name.c_str(), r.iterations, r.min, r.p50, r.p90, r.p99, r.throughput);
+			}
+		}
+
+		std::string toJson() const
+		{
+			std::string json{ "{\n" };
+
+			json += "  \"revision\": \"" + escape(_options.revision) + "\",\n";
+			json += "  \"unit\": \"ns/iteration\",\n";
+			json += "  \"benchmarks\": [";
+
+			for (std::size_t i{}; i < _results.size(); ++i)
+			{
+				const auto& r{ _results[i] };
+
+				json += i == 0 ? "\n" : ",\n";
+				json += ut::formatString(
+					"    { \"name\": \"%s\", \"iterations\": %zu, "
+					"\"repetitions\": %zu, \"min\": %.3f, \"mean\": %.3f, "
+					"\"stddev\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+					"\"p99\": %.3f, \"max\": %.3f, \"throughput\": %.1f }",
+					escape(r.name).c_str(), r.iterations, r.repetitions, 
+					r.min, r.mean, r.stddev, r.p50, r.p90, r.p99, r.max, 
+					r.throughput);
+			}
+
+			json += "\n  ]\n}\n";
+
+			return json;
+		}
+
+	private:
+		static double elapsedNs(Clock::time_point begin, Clock::time_point end)
+		{
+			return static_cast<double>(
+				cr::duration_cast<cr::nanoseconds>(end - begin).count());
+		}
+
+		static double percentile(const std::vector<double>& sorted, double p)
+		{
+			const auto rank{ p * static_cast<double>(sorted.size() - 1) };
+			const auto lower{ static_cast<std::size_t>(rank) };
+			const auto upper{ std::min(lower + 1, sorted.size() - 1) };
+			const auto weight{ rank - static_cast<double>(lower) };
+
+			return sorted[lower] * (1.0 - weight) + sorted[upper] * weight;
+		}
+
+		static std::string escape(const std::string& s)
+		{
+			std::string escaped;
+
+			for (auto c : s)
+			{
+				if (c == '"' || c == '\\')
+				{
+					escaped += '\\';
+				}
+
+				escaped += c;
+			}
+
+			return escaped;
+		}
+
+		Result runCase(const Case& c) const
+		{
+			const auto minSampleNs{ static_cast<double>(
+				cr::duration_cast<cr::nanoseconds>(_options.minSampleTime).count()) };
+
+			std::size_t iterations{ 1 };
+
+			for (;;)
+			{
+				const auto begin{ Clock::now() };
+				c.body(iterations);
+				const auto end{ Clock::now() };
+
+				if (elapsedNs(begin, end) >= minSampleNs || iterations >= (1u << 30))
+				{
+					break;
+				}
+
+				iterations *= 2;
+			}
+
+			const auto warmupEnd{ Clock::now() + _options.warmup };
+
+			while (Clock::now() < warmupEnd)
+			{
+				c.body(iterations);
+			}
+
+			std::vector<double> samples;
+			samples.reserve(_options.repetitions);
+
+			for (std::size_t i{}; i < _options.repetitions; ++i)
+			{
+				const auto begin{ Clock::now() };
+				c.body(iterations);
+				const auto end{ Clock::now() };
+
+				samples.push_back(elapsedNs(begin, end) / iterations);
+			}
+
+			std::sort(samples.begin(), samples.end());
+
+			Result result;
+			result.name = c.name;
+			result.iterations = iterations;
+			result.repetitions = samples.size();
+
+			double sum{};
+
+			for (auto s : samples)
+			{
+				sum += s;
+			}
+
+			result.mean = sum / samples.size();
+
+			double squaredDeviations{};
+
+			for (auto s : samples)
+			{
+				squaredDeviations += (s - result.mean) * (s - result.mean);
+			}
+
+			result.stddev = std::sqrt(squaredDeviations / samples.size());
+			result.min = samples.front();
+			result.max = samples.back();
+			result.p50 = percentile(samples, 0.50);
+			result.p90 = percentile(samples, 0.90);
+			result.p99 = percentile(samples, 0.99);
+			result.throughput = c.itemsPerIteration * 1e9 / result.p50;
+
+			return result;
+		}
+	};
+}
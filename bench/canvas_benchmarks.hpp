@@ -0,0 +1,963 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "canvas_drawing.hpp"
+#include "glyph_atlas.hpp"
+#include "info_panel.hpp"
+#include "reference_rasterizer.hpp"
+#include "vertex_decimator.hpp"
+
+#if defined _WIN32
+#include "string_cache.hpp"
+#endif
+
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bench
+{
+	using namespace std::string_literals;
+
+	constexpr pingstats::pxindex CANVAS_WIDTH{ 1280 };
+	constexpr pingstats::pxindex CANVAS_HEIGHT{ 720 };
+
+	// Random walk across the whole canvas, one vertex every two pixels,
+	// which is roughly what a plot at the default zoom level looks like.
+	inline std::vector<pingstats::Vertex> makePlotVertices()
+	{
+		std::mt19937 engine{ 42 };
+		std::normal_distribution<double> step{ 0.0, 12.0 };
+
+		std::vector<pingstats::Vertex> vertices;
+		double y{ CANVAS_HEIGHT / 2.0 };
+
+		for (pingstats::pxindex x{}; x < CANVAS_WIDTH; x += 2)
+		{
+			y = std::clamp(y + step(engine), 0.0, CANVAS_HEIGHT - 1.0);
+			vertices.push_back({ static_cast<double>(x), y, 
+				pingstats::Color{ 0x80, 0xFF, 0x80 } });
+		}
+
+		return vertices;
+	}
+
+	// Runs every supported kernel set against the scalar reference on
+	// misaligned, odd sized rects.
+	inline void verifyCanvasKernels()
+	{
+		using namespace pingstats;
+
+		constexpr std::size_t STRIDE{ 203 };
+		constexpr std::size_t ROWS{ 37 };
+
+		std::mt19937 engine{ 42 };
+		std::vector<std::uint32_t> source(STRIDE * ROWS);
+
+		for (auto& pixel : source)
+		{
+			pixel = engine();
+		}
+
+		const auto& reference{ scalarCanvasKernels() };
+
+		for (const auto kernels : supportedCanvasKernels())
+		{
+			for (std::size_t offset{}; offset < 17; ++offset)
+			{
+				for (const std::size_t width : { 0, 1, 3, 15, 16, 17, 63, 64, 65, 185 })
+				{
+					const auto color{ Color{ static_cast<std::uint32_t>(engine()) }.premultiplied().value };
+					const auto mask{ reinterpret_cast<const std::uint8_t*>(&source[offset]) };
+
+					{
+						auto expected{ source };
+						auto actual{ source };
+
+						reference.streamFill(&expected[offset], STRIDE, width, ROWS - 1, color);
+						kernels->streamFill(&actual[offset], STRIDE, width, ROWS - 1, color);
+
+						if (expected != actual)
+						{
+							throw std::runtime_error(kernels->name + " stream fill differs from scalar."s);
+						}
+					}
+
+					for (const auto masked : { false, true })
+					{
+						auto expected{ source };
+						auto actual{ source };
+
+						reference.blend(&expected[offset], STRIDE, width, ROWS - 1, 
+							color, masked ? mask : nullptr, 4 * STRIDE - 1);
+						kernels->blend(&actual[offset], STRIDE, width, ROWS - 1, 
+							color, masked ? mask : nullptr, 4 * STRIDE - 1);
+
+						if (expected != actual)
+						{
+							throw std::runtime_error(kernels->name + " blend differs from scalar."s);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// The scalar blend against source over in floating point, for every 
+	// alpha, mask and channel value combination that matters.
+	inline void verifyBlend()
+	{
+		using namespace pingstats;
+
+		const auto& scalar{ scalarCanvasKernels() };
+		std::size_t maxError{};
+
+		for (std::uint32_t alpha{}; alpha < 256; alpha += 5)
+		{
+			for (std::uint32_t mask{}; mask < 256; mask += 3)
+			{
+				for (std::uint32_t channel{}; channel < 256; channel += 15)
+				{
+					const Color color{ 0xFF, 0x80, 0x00, static_cast<std::uint8_t>(alpha) };
+					const auto m{ static_cast<std::uint8_t>(mask) };
+					const auto d{ static_cast<std::uint8_t>(channel) };
+					auto pixel{ Color{ d, d, d, 0xFF }.value };
+
+					scalar.blend(&pixel, 1, 1, 1, color.premultiplied().value, &m, 1);
+
+					const auto coverage{ alpha / 255.0 * mask / 255.0 };
+					const std::array<double, 3> source{ 255.0, 128.0, 0.0 };
+					const std::array<std::uint8_t, 3> actual{ 
+						Color{ pixel }.r(), Color{ pixel }.g(), Color{ pixel }.b() };
+
+					for (std::size_t c{}; c < 3; ++c)
+					{
+						const auto exact{ source[c] * coverage + d * (1.0 - coverage) };
+						maxError = std::max(maxError, static_cast<std::size_t>(
+							std::ceil(std::abs(actual[c] - exact) - 0.5)));
+					}
+
+					if (Color{ pixel }.a() != 255)
+					{
+						throw std::runtime_error("Blending made an opaque pixel translucent.");
+					}
+				}
+			}
+		}
+
+		std::printf("blend: at most %zu LSB off source over\n", maxError);
+
+		if (maxError > 2)
+		{
+			throw std::runtime_error("Blend is more than 2 LSB off source over.");
+		}
+	}
+
+	// Per kernel set, so one megapixel rects give the cost per megapixel.
+	inline void addCanvasKernelBenchmarks(Runner& runner)
+	{
+		using namespace pingstats;
+
+		verifyCanvasKernels();
+		verifyBlend();
+
+		constexpr std::size_t WIDTH{ 3840 };
+		constexpr std::size_t HEIGHT{ 2160 };
+		constexpr std::size_t RECT{ 1000 };
+
+		const auto destCanvas{ std::make_shared<Canvas>(WIDTH, HEIGHT) };
+		const auto sourceCanvas{ std::make_shared<Canvas>(WIDTH, HEIGHT) };
+		const Rect rect{ 1, 1, 1 + RECT, 1 + RECT };
+
+		// Past streamFillThreshold() fills stream, smaller ones and copies are plain loops.
+		std::printf("canvas kernels: %s, streaming fills past %zu KiB\n", 
+			canvasKernels().name, streamFillThreshold() >> 10);
+
+		runner.add("clear 3840x2160", [=](std::size_t iterations) {
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				clearCanvas(*destCanvas, Color{ 0x20, 0x20, 0x20 });
+				doNotOptimize(destCanvas->pixelPtr()[0]);
+			}
+		});
+
+		runner.add("fill 1 MP", [=](std::size_t iterations) {
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				fillCanvasRect(*destCanvas, rect, Color{ 0x20, 0x20, 0x20 });
+				doNotOptimize(destCanvas->pixelPtr()[0]);
+			}
+		});
+
+		runner.add("copy 1 MP", [=](std::size_t iterations) {
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				copyCanvasRect(*destCanvas, *sourceCanvas, rect, 3, 0);
+				doNotOptimize(destCanvas->pixelPtr()[0]);
+			}
+		});
+
+		const auto dest{ std::make_shared<std::vector<std::uint32_t>>(WIDTH * HEIGHT) };
+		const auto source{ std::make_shared<std::vector<std::uint32_t>>(WIDTH * HEIGHT) };
+
+		for (const auto kernels : supportedCanvasKernels())
+		{
+			const std::string suffix{ " "s + kernels->name };
+
+			const auto color{ Color{ 40, 140, 180, 90 }.premultiplied().value };
+
+			// The scalar set doesn't stream, the plain loop to compare with.
+			runner.add("stream fill 3840x2160" + suffix, [=](std::size_t iterations) {
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					kernels->streamFill(dest->data(), WIDTH, WIDTH, HEIGHT, 0x20202020);
+					doNotOptimize(dest->front());
+				}
+			});
+
+			runner.add("stream fill 1 MP" + suffix, [=](std::size_t iterations) {
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					kernels->streamFill(&(*dest)[WIDTH + 1], WIDTH, RECT, RECT, 0x20202020);
+					doNotOptimize(dest->front());
+				}
+			});
+
+			runner.add("blend 1 MP" + suffix, [=](std::size_t iterations) {
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					kernels->blend(&(*dest)[WIDTH + 1], WIDTH, 
+						RECT, RECT, color, nullptr, 0);
+					doNotOptimize(dest->front());
+				}
+			});
+
+			runner.add("blend 1 MP masked" + suffix, [=](std::size_t iterations) {
+				const auto mask{ reinterpret_cast<const std::uint8_t*>(source->data()) };
+
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					kernels->blend(&(*dest)[WIDTH + 1], WIDTH, 
+						RECT, RECT, color, mask, 4 * WIDTH);
+					doNotOptimize(dest->front());
+				}
+			});
+		}
+	}
+
+	inline void referenceDrawPrettyLines(pingstats::Canvas& canvas, 
+		const pingstats::Rect& clip, int thickness, 
+		const pingstats::Vertex* vertices, std::size_t nVertices)
+	{
+		switch (thickness)
+		{
+		default: referenceDrawPrettyLines<0>(canvas, clip, vertices, nVertices); break;
+		case 1: referenceDrawPrettyLines<1>(canvas, clip, vertices, nVertices); break;
+		case 2: referenceDrawPrettyLines<2>(canvas, clip, vertices, nVertices); break;
+		}
+	}
+
+	// Compares drawPrettyLines against the floating point rasterizer it 
+	// replaced, on random lines that partially leave the clip rect. Blend 
+	// weights are rounded differently, so channels may differ by one; more
+	// than that only happens where a line passes exactly between two rows.
+	inline void verifyLineRasterizer()
+	{
+		using namespace pingstats;
+
+		std::mt19937 engine{ 42 };
+		std::uniform_real_distribution<double> coordinate{ -200.0, 840.0 };
+
+		std::vector<Vertex> vertices;
+
+		for (int i{}; i < 400; ++i)
+		{
+			vertices.push_back({ coordinate(engine), coordinate(engine) * 0.75, 
+				Color{ 200, 100, 50 } });
+		}
+
+		const Rect clip{ 20, 30, 600, 450 };
+
+		for (const auto thickness : { 0, 1, 2 })
+		{
+			Canvas actual{ 640, 480 };
+			Canvas expected{ 640, 480 };
+
+			clearCanvas(actual, Color{ 10, 20, 30 });
+			clearCanvas(expected, Color{ 10, 20, 30 });
+
+			drawPrettyLines(actual, clip, thickness, vertices.data(), vertices.size());
+			referenceDrawPrettyLines(expected, clip, thickness, vertices.data(), vertices.size());
+
+			std::size_t differing{};
+			std::size_t beyondOneLsb{};
+
+			for (std::size_t i{}; i < actual.size(); ++i)
+			{
+				const Color a{ actual.pixelPtr()[i] };
+				const Color e{ expected.pixelPtr()[i] };
+
+				const auto distance{ std::max({ 
+					std::abs(a.r() - e.r()), 
+					std::abs(a.g() - e.g()), 
+					std::abs(a.b() - e.b()) }) };
+
+				differing += distance > 0;
+				beyondOneLsb += distance > 1;
+			}
+
+			std::printf("line rasterizer thickness %d: %zu of %zu pixels differ, "
+				"%zu by more than 1 LSB\n", thickness, differing, actual.size(), beyondOneLsb);
+
+			if (beyondOneLsb * 10000 > actual.size())
+			{
+				throw std::runtime_error("Line rasterizer differs from reference.");
+			}
+		}
+	}
+
+	// Compares drawThickLines against measuring every pixel against every
+	// segment, on random lines with two colours that partially leave the 
+	// clip rect.
+	inline void verifyThickLineRasterizer()
+	{
+		using namespace pingstats;
+
+		std::mt19937 engine{ 42 };
+		std::uniform_real_distribution<double> coordinate{ -40.0, 280.0 };
+
+		std::vector<Vertex> vertices;
+
+		for (int i{}; i < 40; ++i)
+		{
+			vertices.push_back({ coordinate(engine), coordinate(engine) * 0.75, 
+				i % 5 == 0 ? Color{ 250, 60, 60 } : Color{ 200, 100, 50 } });
+		}
+
+		const Rect clip{ 10, 15, 230, 170 };
+
+		for (const auto thickness : { 3, 4, 6, 9 })
+		{
+			Canvas actual{ 240, 180 };
+			Canvas expected{ 240, 180 };
+
+			clearCanvas(actual, Color{ 10, 20, 30 });
+			clearCanvas(expected, Color{ 10, 20, 30 });
+
+			drawPrettyLines(actual, clip, thickness, vertices.data(), vertices.size());
+			referenceDrawThickLines(expected, clip, thickness, vertices.data(), vertices.size());
+
+			std::size_t differing{};
+			std::size_t beyondOneLsb{};
+
+			for (std::size_t i{}; i < actual.size(); ++i)
+			{
+				const Color a{ actual.pixelPtr()[i] };
+				const Color e{ expected.pixelPtr()[i] };
+
+				const auto distance{ std::max({ 
+					std::abs(a.r() - e.r()), 
+					std::abs(a.g() - e.g()), 
+					std::abs(a.b() - e.b()) }) };
+
+				differing += distance > 0;
+				beyondOneLsb += distance > 1;
+			}
+
+			std::printf("thick line rasterizer thickness %d: %zu of %zu pixels differ, "
+				"%zu by more than 1 LSB\n", thickness, differing, actual.size(), beyondOneLsb);
+
+			if (beyondOneLsb > 0)
+			{
+				throw std::runtime_error("Thick line rasterizer differs from reference.");
+			}
+		}
+	}
+
+	// A random walk with 16 samples per pixel column and some loss, 
+	// roughly what a long history squeezed into a small plot looks like.
+	inline std::vector<pingstats::Vertex> makeDenseVertices(
+		pingstats::Color pingColor, pingstats::Color lossColor)
+	{
+		using namespace pingstats;
+
+		std::mt19937 engine{ 7 };
+		std::normal_distribution<double> step{ 0.0, 6.0 };
+		std::uniform_int_distribution<int> loss{ 0, 99 };
+
+		std::vector<Vertex> vertices;
+		double y{ CANVAS_HEIGHT / 2.0 };
+
+		for (int i{}; i < CANVAS_WIDTH * 16; ++i)
+		{
+			y = std::clamp(y + step(engine), 0.0, CANVAS_HEIGHT - 1.0);
+			vertices.push_back({ i / 16.0, y, loss(engine) == 0 ? lossColor : pingColor });
+		}
+
+		return vertices;
+	}
+
+	inline std::vector<pingstats::Vertex> decimateVertices(
+		const std::vector<pingstats::Vertex>& vertices, pingstats::Color lossColor)
+	{
+		using namespace pingstats;
+
+		std::vector<Vertex> decimated;
+		VertexDecimator decimator{ lossColor };
+
+		for (const auto& vertex : vertices)
+		{
+			decimator.push(decimated, vertex);
+		}
+
+		decimator.flush(decimated);
+
+		return decimated;
+	}
+
+	inline void verifyVertexDecimator()
+	{
+		using namespace pingstats;
+
+		const Color pingColor{ 0x60, 0xC0, 0xFF };
+		const Color lossColor{ 0xFF, 0x40, 0x40 };
+		const auto vertices{ makeDenseVertices(pingColor, lossColor) };
+		const auto decimated{ decimateVertices(vertices, lossColor) };
+
+		if (decimated.size() > static_cast<std::size_t>(CANVAS_WIDTH + 1) * 4)
+		{
+			throw std::runtime_error("Vertex decimator kept too many vertices.");
+		}
+
+		const Rect clip{ 0, 0, CANVAS_WIDTH, CANVAS_HEIGHT };
+
+		for (const auto thickness : { 0, 1, 2 })
+		{
+			Canvas actual{ CANVAS_WIDTH, CANVAS_HEIGHT };
+			Canvas expected{ CANVAS_WIDTH, CANVAS_HEIGHT };
+
+			clearCanvas(actual, Color{});
+			clearCanvas(expected, Color{});
+
+			drawPrettyLines(actual, clip, thickness, decimated.data(), decimated.size());
+			drawPrettyLines(expected, clip, thickness, vertices.data(), vertices.size());
+
+			// Anti-aliasing weights legitimately change with fewer overlapping 
+			// segments, what has to match is the envelope: the topmost and 
+			// bottommost touched pixel of every column. Exactly two effects 
+			// move it, and every column has to stay within both:
+			//
+			// - A steep segment is sampled at row centres, so its end rows are
+			//   extrapolated up to half a pixel past its vertices, which can
+			//   land them in the neighbouring column. The tiny steep segments
+			//   the decimator removes do that, so each column is compared
+			//   against itself and its two neighbours, for every thickness.
+			// - End rows are weighted by how much of them the segment covers;
+			//   when that rounds to nothing the pixel stays untouched, so the
+			//   extremes may differ by one row.
+			const auto envelopes{ [](const Canvas& canvas) {
+				std::vector<std::pair<pxindex, pxindex>> extents(
+					CANVAS_WIDTH, { CANVAS_HEIGHT, -1 });
+
+				for (pxindex y{}; y < CANVAS_HEIGHT; ++y)
+				{
+					for (pxindex x{}; x < CANVAS_WIDTH; ++x)
+					{
+						if (canvas(x, y) != Color{}.value)
+						{
+							extents[x].first = std::min(extents[x].first, y);
+							extents[x].second = std::max(extents[x].second, y);
+						}
+					}
+				}
+
+				return extents;
+			} };
+
+			const auto actualEnvelopes{ envelopes(actual) };
+			const auto expectedEnvelopes{ envelopes(expected) };
+			const auto contained{ [](const auto& inner, const auto& outer, pxindex x) {
+				auto top{ outer[x].first };
+				auto bottom{ outer[x].second };
+
+				for (auto i{ std::max(x - 1, 0) }; i <= std::min(x + 1, CANVAS_WIDTH - 1); ++i)
+				{
+					top = std::min(top, outer[i].first);
+					bottom = std::max(bottom, outer[i].second);
+				}
+
+				return inner[x].first >= top - 1 && inner[x].second <= bottom + 1;
+			} };
+
+			std::size_t mismatched{};
+
+			for (pxindex x{}; x < CANVAS_WIDTH; ++x)
+			{
+				mismatched += !contained(actualEnvelopes, expectedEnvelopes, x) 
+					|| !contained(expectedEnvelopes, actualEnvelopes, x);
+			}
+
+			std::printf("vertex decimator thickness %d: %zu -> %zu vertices, "
+				"%zu of %d column envelopes mismatched\n", thickness, 
+				vertices.size(), decimated.size(), mismatched, CANVAS_WIDTH);
+
+			if (mismatched > 0)
+			{
+				throw std::runtime_error("Decimated plot differs from full plot.");
+			}
+		}
+	}
+
+	inline void verifyGlyphAtlas()
+	{
+		using namespace pingstats;
+
+		auto atlas{ makeBuiltinGlyphAtlas(2) };
+		const auto& spacing{ atlas.getFontSpacing() };
+
+		// Give one glyph a soft edge so the blend path is covered as well.
+		atlas.glyph('~')[0] = 0x80;
+
+		const Color clearColor{ 0x10, 0x20, 0x30 };
+		const Color textColor{ 0xF0, 0xC0, 0x80 };
+		const std::string_view text{ "ping 12.34 ms~" };
+
+		Canvas canvas{ 200, 40 };
+		clearCanvas(canvas, Color{});
+
+		// Partially outside on the left and bottom, clipped to the canvas.
+		const pxindex x0{ -spacing.fontWidth / 2 };
+		const pxindex y0{ 40 - spacing.fontHeight / 2 };
+		atlas.draw(canvas, clearColor, textColor, x0, y0, text);
+		atlas.draw(canvas, clearColor, textColor, 4, 4, text);
+
+		for (std::size_t i{}; i < text.size(); ++i)
+		{
+			const auto mask{ atlas.glyph(text[i]) };
+
+			for (pxindex y{}; y < spacing.fontHeight; ++y)
+			{
+				for (pxindex x{}; x < spacing.fontWidth; ++x)
+				{
+					const auto px{ 4 + static_cast<pxindex>(i) * spacing.fontWidth + x };
+					const auto coverage{ mask[x + y * spacing.fontWidth] };
+					const auto expected{ mergeColors(clearColor, textColor, coverage / 255.0) };
+
+					if (px < canvas.width() && canvas(px, 4 + y) != expected.value)
+					{
+						throw std::runtime_error("Glyph atlas composited wrong colour.");
+					}
+				}
+			}
+		}
+
+		// Proportional advances, with ink reaching into the next glyph. Each 
+		// pixel takes the larger coverage of the glyphs over it.
+		atlas.setAdvance('i', spacing.fontWidth / 2, spacing.fontWidth / 2);
+		atlas.setAdvance('l', spacing.fontWidth / 2, spacing.fontWidth / 2);
+		atlas.setAdvance('f', spacing.fontWidth - 3, spacing.fontWidth);
+		atlas.glyph('f')[spacing.fontWidth - 1] = 0xFF;
+
+		const std::string_view proportional{ "fifl ~f" };
+		const auto width{ atlas.textWidth(proportional) };
+		std::vector<std::uint8_t> coverage(static_cast<std::size_t>(width * spacing.fontHeight));
+		pxindex pen{};
+
+		for (const auto c : proportional)
+		{
+			const auto mask{ atlas.glyph(c) };
+			const auto inkWidth{ atlas.textWidth(std::string_view{ &c, 1 }) };
+
+			for (pxindex y{}; y < spacing.fontHeight; ++y)
+			{
+				for (pxindex x{}; x < inkWidth; ++x)
+				{
+					auto& merged{ coverage[pen + x + y * width] };
+					merged = std::max(merged, mask[x + y * spacing.fontWidth]);
+				}
+			}
+
+			pen += atlas.advance(c);
+		}
+
+		if (pen - atlas.advance('f') + spacing.fontWidth != width)
+		{
+			throw std::runtime_error("Glyph atlas text width doesn't add up the advances.");
+		}
+
+		clearCanvas(canvas, Color{});
+		atlas.draw(canvas, clearColor, textColor, 4, 4, proportional);
+
+		for (pxindex y{}; y < spacing.fontHeight; ++y)
+		{
+			for (pxindex x{ -1 }; x <= width; ++x)
+			{
+				const auto inside{ x >= 0 && x < width };
+				const auto expected{ inside ? mergeColors(clearColor, textColor, 
+					coverage[x + y * width] / 255.0) : Color{} };
+
+				if (canvas(4 + x, 4 + y) != expected.value)
+				{
+					throw std::runtime_error("Glyph atlas placed proportional glyphs wrong.");
+				}
+			}
+		}
+
+		std::printf("glyph atlas: %zu glyphs, %dx%d cells, proportional text %d px wide\n", 
+			GlyphAtlas::GLYPH_COUNT, spacing.fontWidth, spacing.fontHeight, 
+			width);
+	}
+
+	// Fills the panel the way PingPlotter::drawInfo does.
+	inline void setInfoPanelLines(pingstats::InfoPanel& panel, double pingMs, int seconds)
+	{
+		using namespace pingstats;
+
+		const Color textColor{ 180, 180, 180 };
+		const Color pingColor{ 40, 140, 180 };
+
+		panel.clearLines();
+		panel.line(0, pingColor, 600, 8).append("ping ").appendFixed(pingMs, 2, 4).append(" ms");
+		panel.line(1, pingColor, 600, 26).append("jttr ").appendFixed(pingMs / 7.0, 2, 4).append(" ms");
+		panel.line(2, pingColor, 600, 44).append("loss ").appendFixed(0.5, 2, 4).append(" %");
+		panel.line(3, textColor, 400, 8).append('[').appendFixed(pingMs, 2).append(" ms | -")
+			.appendInteger(seconds / 60, 2, '0').append(':').appendInteger(seconds % 60, 2, '0').append(']');
+		panel.line(4, textColor, 400, 26).append("mean ").appendFixed(20.15, 2, 4).append(" ms");
+		panel.line(5, textColor, 400, 44).append("grid ").appendFixed(10.0, 2, 4).append(" ms");
+		panel.line(6, textColor, 8, 8).append("Google DNS");
+		panel.line(7, textColor, 8, 26).append("8.8.8.8");
+		panel.line(8, textColor, 8, 44).append("(0, 0) Success");
+	}
+
+	inline void verifyInfoPanel()
+	{
+		using namespace pingstats;
+
+		const auto atlas{ makeBuiltinGlyphAtlas(2) };
+		const Rect rect{ 0, CANVAS_HEIGHT - 64, CANVAS_WIDTH, CANVAS_HEIGHT };
+		const Color clearColor{ 4, 4, 20 };
+
+		Canvas canvas{ CANVAS_WIDTH, CANVAS_HEIGHT };
+		clearCanvas(canvas, Color{});
+		InfoPanel panel;
+
+		setInfoPanelLines(panel, 12.34, 5);
+		panel.draw(canvas, rect, atlas, clearColor);
+
+		// Steady state: formatting and drawing a frame must not allocate.
+		const auto allocations{ allocationCount.load() };
+
+		setInfoPanelLines(panel, 12.34, 5);
+		panel.draw(canvas, rect, atlas, clearColor);
+		const auto unchangedLines{ panel.linesDrawn() };
+
+		setInfoPanelLines(panel, 13.5, 6);
+		panel.draw(canvas, rect, atlas, clearColor);
+		const auto changedLines{ panel.linesDrawn() };
+
+		const auto frameAllocations{ allocationCount.load() - allocations };
+
+		std::printf("info panel: %zu allocations, %zu lines redrawn unchanged, "
+			"%zu changed\n", frameAllocations, unchangedLines, changedLines);
+
+		if (frameAllocations != 0)
+		{
+			throw std::runtime_error("Info panel allocates per frame.");
+		}
+
+		if (unchangedLines != 0 || changedLines != 3)
+		{
+			throw std::runtime_error("Info panel redraws the wrong lines.");
+		}
+
+		// The layer has to look exactly like drawing the final lines directly.
+		Canvas expected{ CANVAS_WIDTH, CANVAS_HEIGHT };
+		clearCanvas(expected, Color{});
+		InfoPanel fresh;
+
+		setInfoPanelLines(fresh, 13.5, 6);
+		fresh.draw(expected, rect, atlas, clearColor);
+
+		if (!std::equal(canvas.pixelPtr(), canvas.pixelPtr() + canvas.size(), expected.pixelPtr()))
+		{
+			throw std::runtime_error("Incrementally updated info panel differs.");
+		}
+	}
+
+	// Drags the window from 800x600 to 1920x1160 and back, resizing the back
+	// buffer and a section layer the way MainWindow and PingPlotter do and
+	// clearing both like the following frame would.
+	inline std::size_t resizeSweep(
+		pingstats::Canvas& backBuffer, 
+		pingstats::Canvas& layer, 
+		bool pooled)
+	{
+		using namespace pingstats;
+
+		static constexpr pxindex STEPS{ 140 };
+
+		for (pxindex step{}; step < 2 * STEPS; ++step)
+		{
+			const auto t{ step < STEPS ? step : 2 * STEPS - step };
+			const auto width{ 800 + 8 * t };
+			const auto height{ 600 + 4 * t };
+
+			if (pooled)
+			{
+				resizeCanvasPredictive(backBuffer, width, height);
+				resizeCanvas(layer, width / 2 - 6, height / 2 - 6);
+			}
+			else
+			{
+				backBuffer = Canvas{ width, height };
+				layer = Canvas{ width / 2 - 6, height / 2 - 6 };
+			}
+
+			clearCanvas(backBuffer, Color{ 0x20, 0x20, 0x20 });
+			clearCanvas(layer, Color{ 0x20, 0x20, 0x20 });
+		}
+
+		return 2 * STEPS;
+	}
+
+	inline void verifyCanvasPool()
+	{
+		using namespace pingstats;
+
+		Canvas backBuffer;
+		Canvas layer;
+
+		const auto before{ canvasPool().allocations() };
+		const auto resizes{ resizeSweep(backBuffer, layer, true) };
+		const auto warm{ canvasPool().allocations() };
+
+		resizeSweep(backBuffer, layer, true);
+		resizeSweep(backBuffer, layer, true);
+
+		const auto steady{ canvasPool().allocations() - warm };
+
+		std::printf("canvas pool: %zu resizes, %zu allocations in the first sweep, %zu after\n", 
+			resizes, warm - before, steady);
+
+		if (steady != 0)
+		{
+			throw std::runtime_error("Canvas pool allocates while resizing in steady state.");
+		}
+
+		canvasPool().release(backBuffer);
+		canvasPool().release(layer);
+	}
+
+	inline void addCanvasBenchmarks(Runner& runner)
+	{
+		using namespace pingstats;
+
+		verifyLineRasterizer();
+		verifyThickLineRasterizer();
+		verifyVertexDecimator();
+		verifyGlyphAtlas();
+		verifyInfoPanel();
+		verifyCanvasPool();
+
+		const auto canvas{ std::make_shared<Canvas>(CANVAS_WIDTH, CANVAS_HEIGHT) };
+		const auto vertices{ std::make_shared<std::vector<Vertex>>(makePlotVertices()) };
+		const Rect clip{ 0, 0, CANVAS_WIDTH, CANVAS_HEIGHT };
+
+		runner.add("clearCanvas 1280x720", [canvas](std::size_t iterations) {
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				clearCanvas(*canvas, Color{ 0x20, 0x20, 0x20 });
+				doNotOptimize(*canvas->pixelPtr());
+			}
+		});
+
+		runner.add("fillCanvasRect 640x360", [canvas](std::size_t iterations) {
+			const Rect rect{ 320, 180, 960, 540 };
+
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				fillCanvasRect(*canvas, rect, Color{ 0x20, 0x20, 0x20 });
+				doNotOptimize(*canvas->pixelPtr());
+			}
+		});
+
+		for (const auto pooled : { false, true })
+		{
+			Canvas backBuffer;
+			Canvas layer;
+			const auto resizes{ static_cast<double>(resizeSweep(backBuffer, layer, pooled)) };
+
+			runner.add(pooled ? "resize sweep, pooled canvases" : "resize sweep, reallocated canvases", resizes,
+				[pooled, backBuffer = std::make_shared<Canvas>(std::move(backBuffer)), 
+				layer = std::make_shared<Canvas>(std::move(layer))](std::size_t iterations) {
+					for (std::size_t i{}; i < iterations; ++i)
+					{
+						resizeSweep(*backBuffer, *layer, pooled);
+						doNotOptimize(*backBuffer->pixelPtr());
+					}
+				}
+			);
+		}
+
+		const auto segments{ static_cast<double>(vertices->size() - 1) };
+
+		for (const auto thickness : { -1, 0, 1, 2, 3, 4, 6 })
+		{
+			runner.add("drawPrettyLines thickness " + std::to_string(thickness), segments,
+				[canvas, vertices, clip, thickness](std::size_t iterations) {
+					for (std::size_t i{}; i < iterations; ++i)
+					{
+						drawPrettyLines(*canvas, clip, thickness, 
+							vertices->data(), vertices->size());
+						doNotOptimize(*canvas->pixelPtr());
+					}
+				}
+			);
+		}
+
+		for (const auto thickness : { 0, 1, 2 })
+		{
+			runner.add("reference lines thickness " + std::to_string(thickness), segments,
+				[canvas, vertices, clip, thickness](std::size_t iterations) {
+					for (std::size_t i{}; i < iterations; ++i)
+					{
+						referenceDrawPrettyLines(*canvas, clip, thickness, 
+							vertices->data(), vertices->size());
+						doNotOptimize(*canvas->pixelPtr());
+					}
+				}
+			);
+		}
+
+		const Color lossColor{ 0xFF, 0x40, 0x40 };
+		const auto dense{ std::make_shared<std::vector<Vertex>>(
+			makeDenseVertices(Color{ 0x60, 0xC0, 0xFF }, lossColor)) };
+		const auto denseCount{ static_cast<double>(dense->size()) };
+
+		runner.add("drawPrettyLines 16 vertices/px", denseCount,
+			[canvas, dense, clip](std::size_t iterations) {
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					drawPrettyLines(*canvas, clip, 1, dense->data(), dense->size());
+					doNotOptimize(*canvas->pixelPtr());
+				}
+			}
+		);
+
+		runner.add("M4 decimate + drawPrettyLines 16 vertices/px", denseCount,
+			[canvas, dense, clip, lossColor, 
+			decimated = std::vector<Vertex>{}, 
+			decimator = VertexDecimator{ lossColor }](std::size_t iterations) mutable {
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					decimated.clear();
+
+					for (const auto& vertex : *dense)
+					{
+						decimator.push(decimated, vertex);
+					}
+
+					decimator.flush(decimated);
+
+					drawPrettyLines(*canvas, clip, 1, decimated.data(), decimated.size());
+					doNotOptimize(*canvas->pixelPtr());
+				}
+			}
+		);
+
+		const auto atlas{ std::make_shared<GlyphAtlas>(makeBuiltinGlyphAtlas(2)) };
+
+		runner.add("GlyphAtlas::draw changing string", 
+			[canvas, atlas, buffer = std::array<char, 32>{}, counter = 0u]
+			(std::size_t iterations) mutable {
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					const auto length{ std::snprintf(buffer.data(), buffer.size(), 
+						"Last %u ms", counter++) };
+
+					atlas->draw(*canvas, Color{ 0x20, 0x20, 0x20 }, 
+						Color{ 0xFF, 0xFF, 0xFF }, 16, 16, 
+						std::string_view{ buffer.data(), static_cast<std::size_t>(length) });
+
+					doNotOptimize(*canvas->pixelPtr());
+				}
+			}
+		);
+
+		runner.add("InfoPanel frame, 3 of 9 lines changed", 
+			[canvas, atlas, panel = std::make_shared<InfoPanel>(), counter = 0]
+			(std::size_t iterations) mutable {
+				const Rect rect{ 0, CANVAS_HEIGHT - 64, CANVAS_WIDTH, CANVAS_HEIGHT };
+
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					++counter;
+					setInfoPanelLines(*panel, 10.0 + counter % 1000 * 0.01, counter);
+					panel->draw(*canvas, rect, *atlas, Color{ 4, 4, 20 });
+					doNotOptimize(*canvas->pixelPtr());
+				}
+			}
+		);
+
+#if defined _WIN32
+		LOGFONT logFont{};
+		logFont.lfHeight = 16;
+		logFont.lfWeight = FW_NORMAL;
+		logFont.lfCharSet = ANSI_CHARSET;
+		logFont.lfQuality = CLEARTYPE_QUALITY;
+		wcscpy_s(logFont.lfFaceName, L"Consolas");
+
+		const auto stringCache{ std::make_shared<StringCache>(logFont) };
+
+		runner.add("StringCache::draw hit", [canvas, stringCache](std::size_t iterations) {
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				stringCache->draw(*canvas, Color{ 0x20, 0x20, 0x20 }, 
+					Color{ 0xFF, 0xFF, 0xFF }, 16, 16, "Mean 20.15 ms");
+			}
+		});
+
+		runner.add("StringCache::draw miss", 
+			[canvas, stringCache, counter = 0u](std::size_t iterations) mutable {
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					stringCache->draw(*canvas, Color{ 0x20, 0x20, 0x20 }, 
+						Color{ 0xFF, 0xFF, 0xFF }, 16, 16, 
+						"Last " + std::to_string(counter++) + " ms");
+				}
+			}
+		);
+#endif
+	}
+}
@@ -0,0 +1,538 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+#pragma once
+
+#include "utility/tree_config.hpp"
+#include "latency_heatmap.hpp"
+#include "ping_data.hpp"
+#include "ping_plotter.hpp"
+#include "plot_vertex_buffer.hpp"
+#include "vertical_scale.hpp"
+
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	// A section pinged at 50 Hz whose latency flips between an idle and a
+	// bufferbloated mode every few seconds, the case the heatmap is for.
+	// Losses can be delivered late, the way timeouts are.
+	class HeatmapFixture
+	{
+		std::mt19937 _engine{ 42 };
+		cr::steady_clock::time_point _nextSentTime;
+		cr::nanoseconds _lossDelay;
+		std::vector<pingstats::IcmpEchoResult> _pendingLosses;
+
+		void deliverLosses(cr::steady_clock::time_point time)
+		{
+			std::size_t delivered{};
+
+			for (; delivered < _pendingLosses.size() && 
+				_pendingLosses[delivered].sentTime + _lossDelay <= time; ++delivered)
+			{
+				data.insertPingResult(_pendingLosses[delivered]);
+			}
+
+			_pendingLosses.erase(_pendingLosses.begin(), _pendingLosses.begin() + delivered);
+		}
+
+	public:
+		ut::TreeConfigNode config{ nullptr, "heatmap" };
+		pingstats::PingData data{ config };
+		std::unique_ptr<pingstats::PingPlotter> plotter;
+		pingstats::Canvas canvas;
+		cr::steady_clock::time_point now;
+
+		HeatmapFixture(pingstats::pxindex width, pingstats::pxindex height, 
+			const std::string& mode, cr::seconds history, 
+			cr::steady_clock::time_point start = cr::steady_clock::now(),
+			cr::nanoseconds lossDelay = {})
+			: _nextSentTime{ start }
+			, _lossDelay{ lossDelay }
+			, canvas{ width, height }
+			, now{ start }
+		{
+			// "line, no band" is the line mode without the percentile band.
+			auto& plotcfg{ *config.findOrAppendNode("render")->findOrAppendNode("plot") };
+			const auto noBand{ mode == "line, no band" };
+
+			plotcfg.storeValue("mode", noBand ? std::string{ "line" } : mode);
+			plotcfg.storeValue("percentileBand", noBand ? "false" : "true");
+			config.findOrAppendNode("stats")->storeValue("historySize", "16384");
+
+			plotter = std::make_unique<pingstats::PingPlotter>(config);
+			advance(history);
+		}
+
+		// Inserts the results sent until now, as if they arrived instantly,
+		// and the losses whose delay is over.
+		void advance(cr::nanoseconds step)
+		{
+			now += step;
+
+			for (; _nextSentTime <= now; _nextSentTime += cr::milliseconds{ 20 })
+			{
+				deliverLosses(_nextSentTime);
+
+				const auto bloated{ (_nextSentTime.time_since_epoch() / cr::seconds{ 5 }) % 2 != 0 };
+				const auto ms{ std::uniform_real_distribution<double>{ 10.0, 14.0 }(_engine) + 
+					(bloated && _engine() % 2 != 0 ? 30.0 : 0.0) };
+				const auto lost{ _engine() % 100 == 0 };
+
+				pingstats::IcmpEchoResult result{};
+				result.sentTime = _nextSentTime;
+				result.latency = cr::duration_cast<cr::nanoseconds>(ut::milliseconds_f64{ ms });
+				result.errorCode = lost ? 11010 : 0;
+				result.statusCode = result.errorCode;
+
+				if (lost && _lossDelay > cr::nanoseconds::zero())
+				{
+					_pendingLosses.push_back(result);
+				}
+				else
+				{
+					data.insertPingResult(result);
+				}
+			}
+
+			deliverLosses(now);
+		}
+
+		void draw()
+		{
+			plotter->redraw(canvas, pingstats::Rect{ 0, 0, canvas.width(), canvas.height() }, 
+				data, now, now, false);
+		}
+	};
+
+	inline void verifyLatencyHeatmap()
+	{
+		using pingstats::LatencyHeatmap;
+
+		for (auto ms{ LatencyHeatmap::MIN_MS }; ms < 8000.0; ms *= 1.01)
+		{
+			const auto b{ LatencyHeatmap::bucket(ms) };
+
+			if (LatencyHeatmap::bucketLowerMs(b) > ms || LatencyHeatmap::bucketLowerMs(b + 1) <= ms)
+			{
+				throw std::runtime_error("LatencyHeatmap puts " + 
+					std::to_string(ms) + " ms into the wrong bucket.");
+			}
+		}
+
+		LatencyHeatmap heatmap;
+		heatmap.reset(8);
+		heatmap.insert(3, 20.0);
+		heatmap.insert(3 + 8, 20.0);
+		heatmap.insert(3, 20.0);
+		heatmap.insertLoss(2);
+
+		if (heatmap.samples(3) != 0 || heatmap.samples(11) != 1 || heatmap.samples(2) != 0)
+		{
+			throw std::runtime_error("LatencyHeatmap doesn't evict old columns.");
+		}
+
+		// Scrolling and updating cell by cell has to end up with the same
+		// picture as drawing everything at once, also when losses arrive 
+		// after cells right of them were drawn.
+		const auto start{ cr::steady_clock::now() };
+		const auto lossDelay{ cr::seconds{ 2 } };
+
+		HeatmapFixture incremental{ 640, 360, "heatmap", cr::seconds{ 30 }, start, lossDelay };
+
+		for (int frame{}; frame < 600; ++frame)
+		{
+			incremental.draw();
+			incremental.advance(cr::milliseconds{ 17 });
+		}
+
+		HeatmapFixture full{ 640, 360, "heatmap", cr::seconds{ 30 }, start, lossDelay };
+		full.advance(incremental.now - full.now);
+
+		// The status line follows the previous frame's selection, so both 
+		// draw the last frame twice.
+		for (int i{}; i < 2; ++i)
+		{
+			incremental.draw();
+			full.draw();
+		}
+
+		const auto pixels{ static_cast<std::size_t>(640 * 360) };
+
+		if (!std::equal(full.canvas.pixelPtr(), full.canvas.pixelPtr() + pixels, 
+			incremental.canvas.pixelPtr()))
+		{
+			throw std::runtime_error("Incremental heatmap frames differ from a full redraw.");
+		}
+	}
+
+	// Pixels of the plot area, inside the border and above the info panel,
+	// that are mostly the loss colour.
+	inline std::size_t countLossPixels(pingstats::Canvas& canvas)
+	{
+		std::size_t count{};
+
+		for (pingstats::pxindex y{ 1 }; y < canvas.height() * 3 / 4; ++y)
+		{
+			for (pingstats::pxindex x{ 1 }; x + 1 < canvas.width(); ++x)
+			{
+				const pingstats::Color color{ canvas(static_cast<std::size_t>(x), static_cast<std::size_t>(y)) };
+				count += color.r() >= color.b() + 60;
+			}
+		}
+
+		return count;
+	}
+
+	// A line plot that got results after later ones were drawn has to 
+	// show them like a plot drawn from scratch. First a single loss 
+	// delivered two seconds late into a 2 Hz plot, then timeouts at 50 Hz.
+	// Joints drawn a frame apart blend a little differently, so only the
+	// loss coloured pixels are compared.
+	inline void verifyLateResults()
+	{
+		using namespace pingstats;
+
+		const auto start{ cr::steady_clock::now() };
+		const auto compare{ [](PingPlotter& plotter, Canvas& canvas, 
+			const PingData& data, cr::steady_clock::time_point now, const char* what) {
+			const Rect rect{ 0, 0, canvas.width(), canvas.height() };
+
+			plotter.redraw(canvas, rect, data, now, now, false);
+			const auto incremental{ countLossPixels(canvas) };
+
+			plotter.setMode(PlotMode::LINE);
+			plotter.redraw(canvas, rect, data, now, now, false);
+			const auto full{ countLossPixels(canvas) };
+
+			if (full == 0 || incremental * 10 < full * 9 || incremental * 10 > full * 11)
+			{
+				throw std::runtime_error("Incremental line plot with " + std::string{ what } + 
+					" has " + std::to_string(incremental) + " loss pixels, a full redraw " + 
+					std::to_string(full) + ".");
+			}
+		} };
+
+		{
+			ut::TreeConfigNode config{ nullptr, "late" };
+			PingData data{ config };
+			PingPlotter plotter{ config };
+			Canvas canvas{ 640, 360 };
+
+			const auto sentTime{ [&](int i) { return start + i * cr::milliseconds{ 500 }; } };
+			auto now{ start };
+			int next{};
+			bool lateDelivered{};
+
+			for (; now < sentTime(60); now += cr::milliseconds{ 33 })
+			{
+				for (; next < 60 && sentTime(next) <= now; ++next)
+				{
+					if (next != 30)
+					{
+						IcmpEchoResult result{};
+						result.sentTime = sentTime(next);
+						result.latency = cr::milliseconds{ 20 + next % 7 };
+						data.insertPingResult(result);
+					}
+				}
+
+				if (!lateDelivered && sentTime(30) + cr::seconds{ 2 } <= now)
+				{
+					IcmpEchoResult result{};
+					result.sentTime = sentTime(30);
+					result.errorCode = 11010;
+					result.statusCode = 11010;
+					data.insertPingResult(result);
+					lateDelivered = true;
+				}
+
+				plotter.redraw(canvas, Rect{ 0, 0, canvas.width(), canvas.height() }, 
+					data, now, now, false);
+			}
+
+			compare(plotter, canvas, data, now, "a late loss");
+		}
+
+		HeatmapFixture incremental{ 640, 360, "line", cr::seconds{ 30 }, start, cr::seconds{ 2 } };
+
+		for (int frame{}; frame < 600; ++frame)
+		{
+			incremental.draw();
+			incremental.advance(cr::milliseconds{ 17 });
+		}
+
+		compare(*incremental.plotter, incremental.canvas, incremental.data, 
+			incremental.now, "late timeouts");
+	}
+
+	// Keeps a vertex buffer in sync with a history that gets results 
+	// appended, inserted late and dropped from the front, and checks the
+	// points against the history after every step.
+	inline void verifyPlotVertexBuffer()
+	{
+		using namespace pingstats;
+
+		std::mt19937 engine{ 7 };
+		std::vector<IcmpEchoResult> history;
+		PlotVertexBuffer buffer;
+		std::vector<Vertex> points;
+
+		const auto start{ cr::steady_clock::now() };
+		const Color ping{ 1, 1, 1 };
+		const Color loss{ 2, 2, 2 };
+		std::size_t rebuilds{};
+
+		for (int step{}; step < 2000; ++step)
+		{
+			IcmpEchoResult result{};
+			result.sentTime = start + cr::milliseconds{ 500 * step };
+			result.latency = cr::microseconds{ 1000 + engine() % 100000 };
+			result.errorCode = engine() % 8 == 0 ? 11010 : 0;
+
+			// Every 50th result arrives late, somewhere in the last second.
+			if (step % 50 == 49)
+			{
+				result.sentTime -= cr::milliseconds{ 1 + engine() % 999 };
+			}
+
+			history.insert(std::upper_bound(history.begin(), history.end(), result,
+				[](const auto& lhs, const auto& rhs) {
+					return lhs.sentTime < rhs.sentTime;
+				}), result);
+
+			if (history.size() > 600)
+			{
+				history.erase(history.begin(), history.begin() + 300);
+			}
+
+			const auto first{ history.size() > 220 ? history.size() - 200 - engine() % 20 : 0 };
+
+			buffer.sync(history, first, [&](std::size_t) {
+				++rebuilds;
+				return 0.0;
+			});
+
+			points.clear();
+			buffer.transform(points, 0, buffer.size(), 0.0, 1.0, 0.0, -1.0, ping, loss);
+
+			if (points.size() != history.size() - first)
+			{
+				throw std::runtime_error("PlotVertexBuffer holds the wrong number of points.");
+			}
+
+			auto carried{ std::numeric_limits<double>::quiet_NaN() };
+
+			for (std::size_t k{}; k < points.size(); ++k)
+			{
+				const auto& r{ history[first + k] };
+				const auto lost{ r.errorCode != 0 || r.statusCode != 0 };
+				const auto seconds{ ut::seconds_f64{ r.sentTime - buffer.origin() }.count() };
+
+				if (!lost)
+				{
+					carried = ut::milliseconds_f64{ r.latency }.count();
+				}
+
+				// Lost results before the first success carry a latency 
+				// from before the checked range.
+				if (std::abs(points[k].x - seconds) > 1e-9 ||
+					(lost ? loss : ping).value != points[k].color.value ||
+					(!std::isnan(carried) && points[k].y != carried))
+				{
+					throw std::runtime_error("PlotVertexBuffer point " + 
+						std::to_string(k) + " doesn't match the history.");
+				}
+			}
+		}
+
+		std::printf("plot vertex buffer: 2000 steps, %zu rebuilds\n", rebuilds);
+	}
+
+	// Checks that scales invert and keep their grid in range, that the 
+	// auto scale rescales twice for a spike and never for jitter, and 
+	// counts rescales of a plot over ten minutes of flipping bufferbloat.
+	inline void verifyVerticalScale()
+	{
+		using pingstats::ScaleMode;
+		using pingstats::VerticalAutoScale;
+		using pingstats::VerticalScale;
+
+		for (const auto mode : { ScaleMode::LINEAR, ScaleMode::LOG })
+		{
+			for (const auto height : { 17.0, 200.0, 1080.0 })
+			{
+				const VerticalScale scale{ mode, 5.0, 300.0, height };
+				auto lastMs{ -1.0 };
+
+				for (auto ms{ std::max(scale.bottomMs(), 1.0) }; ms <= scale.topMs(); ms *= 1.1)
+				{
+					if (std::abs(scale.latency(scale.pixels(ms)) - ms) > 1e-9 * ms)
+					{
+						throw std::runtime_error("VerticalScale doesn't invert at " + 
+							std::to_string(ms) + " ms.");
+					}
+				}
+
+				scale.forEachGridLine([&](double ms) {
+					if (ms <= lastMs || ms < scale.bottomMs() || ms > scale.topMs())
+					{
+						throw std::runtime_error("VerticalScale has a grid line at " + 
+							std::to_string(ms) + " ms.");
+					}
+
+					lastMs = ms;
+				});
+
+				if (std::abs(scale.pixels(scale.topMs()) - height) > 1e-9 * height)
+				{
+					throw std::runtime_error("VerticalScale doesn't end at the top.");
+				}
+			}
+		}
+
+		const auto start{ cr::steady_clock::now() };
+		std::mt19937 engine{ 42 };
+
+		VerticalAutoScale spike;
+		VerticalAutoScale jitter;
+
+		// Checked four times a second for two minutes, with a spike in 
+		// view from 30 s to 90 s.
+		for (int step{}; step < 480; ++step)
+		{
+			const auto now{ start + step * cr::milliseconds{ 250 } };
+			const auto noise{ std::uniform_real_distribution<double>{ -3.0, 3.0 }(engine) };
+
+			spike.update(ScaleMode::LINEAR, 400.0, 10.0, step >= 120 && step < 360 ? 300.0 : 20.0, now);
+			jitter.update(ScaleMode::LOG, 400.0, 10.0 + noise, 21.0 + noise, now);
+		}
+
+		if (spike.rescales() != 2 || spike.scale().topMs() >= 40.0 || jitter.rescales() != 0)
+		{
+			throw std::runtime_error("VerticalAutoScale rescaled " + 
+				std::to_string(spike.rescales()) + " times for a spike and " + 
+				std::to_string(jitter.rescales()) + " times for jitter.");
+		}
+
+		HeatmapFixture fixture{ 640, 360, "line", cr::seconds{ 200 } };
+
+		for (int frame{}; frame < 600 * 60; ++frame)
+		{
+			fixture.advance(cr::microseconds{ 16667 });
+			fixture.draw();
+		}
+
+		std::printf("vertical scale: %zu rescales over 10 min of bufferbloat, top %.0f ms\n", 
+			fixture.plotter->rescales(), fixture.plotter->scale().topMs());
+	}
+
+	inline void addHeatmapBenchmarks(Runner& runner)
+	{
+		verifyLatencyHeatmap();
+		verifyLateResults();
+		verifyPlotVertexBuffer();
+		verifyVerticalScale();
+
+		runner.add("LatencyHeatmap::insert", 
+			[heatmap = std::make_shared<pingstats::LatencyHeatmap>()](std::size_t iterations) {
+				heatmap->reset(1024);
+
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					heatmap->insert(static_cast<std::int64_t>(i / 16), 10.0 + (i % 7) * 9.0);
+				}
+
+				doNotOptimize(heatmap->samples(0));
+			}
+		);
+
+		// What a line layer rebuild costs per visible result: 192 s at 50 Hz.
+		const auto history{ std::make_shared<HeatmapFixture>(640, 360, "line", cr::seconds{ 192 }) };
+
+		runner.add("PlotVertexBuffer::transform", 
+			static_cast<double>(history->data.pingResults().size()),
+			[history, buffer = std::make_shared<pingstats::PlotVertexBuffer>(), 
+			vertices = std::vector<pingstats::Vertex>{}](std::size_t iterations) mutable {
+				const auto& results{ history->data.pingResults() };
+				buffer->sync(results, 0, [](std::size_t) { return 0.0; });
+
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					vertices.clear();
+					buffer->transform(vertices, 0, buffer->size(), 1920.0, 10.0, 1080.0, 2.0,
+						pingstats::Color{ 40, 140, 180 }, pingstats::Color{ 180, 140, 40 });
+					doNotOptimize(vertices.back());
+				}
+			}
+		);
+
+		// A full screen section at 60 Hz, with a few results per frame.
+		for (const auto mode : { "line", "line, no band", "heatmap" })
+		{
+			const auto fixture{ std::make_shared<HeatmapFixture>(
+				1920, 1080, mode, cr::seconds{ 200 }) };
+
+			runner.add("PingPlotter " + std::string{ mode } + " 1920x1080 60 Hz frame", 
+				[fixture](std::size_t iterations) {
+					for (std::size_t i{}; i < iterations; ++i)
+					{
+						fixture->advance(cr::microseconds{ 16667 });
+						fixture->draw();
+						doNotOptimize(*fixture->canvas.pixelPtr());
+					}
+				}
+			);
+		}
+
+		// Switching modes repaints the layer from all visible results.
+		for (const auto mode : { "line", "line, no band", "heatmap" })
+		{
+			const auto fixture{ std::make_shared<HeatmapFixture>(
+				1920, 1080, mode, cr::seconds{ 200 }) };
+			const auto plotMode{ std::string{ mode } == "heatmap" ? 
+				pingstats::PlotMode::HEATMAP : pingstats::PlotMode::LINE };
+
+			runner.add("PingPlotter " + std::string{ mode } + " 1920x1080 rebuild", 
+				[fixture, plotMode](std::size_t iterations) {
+					for (std::size_t i{}; i < iterations; ++i)
+					{
+						fixture->plotter->setMode(plotMode);
+						fixture->draw();
+						doNotOptimize(*fixture->canvas.pixelPtr());
+					}
+				}
+			);
+		}
+	}
+}
@@ -0,0 +1,279 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+// Benchmarks for the hot paths of data collection and rendering.
+//
+//   pingstats_bench [--filter <substring>] [--json <file>] 
+//                   [--repetitions <n>] [--warmup-ms <n>] [--min-sample-ms <n>]
+
+#include "benchmark.hpp"
+#include "canvas_benchmarks.hpp"
+#include "heatmap_benchmarks.hpp"
+#include "ping_data_benchmarks.hpp"
+#include "snapshot_benchmarks.hpp"
+#include "utility_benchmarks.hpp"
+#include "zoom_benchmarks.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#if !defined PINGSTATS_REVISION
+#define PINGSTATS_REVISION "unknown"
+#endif
+
+// Every allocation function is replaced, plain, array, nothrow and aligned, 
+// so allocationCount sees all of them and each delete frees what its new 
+// got. Aligned blocks keep malloc's pointer just in front of them.
+
+void* countedAllocate(std::size_t size, std::size_t alignment) noexcept
+{
+	bench::allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	if (alignment <= alignof(std::max_align_t))
+	{
+		return std::malloc(size == 0 ? 1 : size);
+	}
+
+	const auto raw{ std::malloc(size + alignment + sizeof(void*)) };
+
+	if (raw == nullptr)
+	{
+		return nullptr;
+	}
+
+	const auto address{ (reinterpret_cast<std::uintptr_t>(raw) + 
+		sizeof(void*) + alignment - 1) & ~(alignment - 1) };
+	const auto ptr{ reinterpret_cast<void**>(address) };
+
+	ptr[-1] = raw;
+
+	return ptr;
+}
+
+void countedFree(void* ptr, std::size_t alignment) noexcept
+{
+	if (ptr != nullptr && alignment > alignof(std::max_align_t))
+	{
+		ptr = static_cast<void**>(ptr)[-1];
+	}
+
+	std::free(ptr);
+}
+
+void* countedAllocateOrThrow(std::size_t size, std::size_t alignment)
+{
+	if (const auto ptr{ countedAllocate(size, alignment) })
+	{
+		return ptr;
+	}
+
+	throw std::bad_alloc{};
+}
+
+constexpr auto DEFAULT_ALIGNMENT{ alignof(std::max_align_t) };
+
+void* operator new(std::size_t size)
+{
+	return countedAllocateOrThrow(size, DEFAULT_ALIGNMENT);
+}
+
+void* operator new[](std::size_t size)
+{
+	return countedAllocateOrThrow(size, DEFAULT_ALIGNMENT);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return countedAllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return countedAllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAllocate(size, DEFAULT_ALIGNMENT);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAllocate(size, DEFAULT_ALIGNMENT);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return countedAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return countedAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept
+{
+	countedFree(ptr, DEFAULT_ALIGNMENT);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	countedFree(ptr, DEFAULT_ALIGNMENT);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	countedFree(ptr, DEFAULT_ALIGNMENT);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	countedFree(ptr, DEFAULT_ALIGNMENT);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	countedFree(ptr, DEFAULT_ALIGNMENT);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	countedFree(ptr, DEFAULT_ALIGNMENT);
+}
+
+void operator delete(void* ptr, std::align_val_t alignment) noexcept
+{
+	countedFree(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept
+{
+	countedFree(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+	countedFree(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+	countedFree(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	countedFree(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	countedFree(ptr, static_cast<std::size_t>(alignment));
+}
+
+bench::Options parseOptions(int argc, char** argv)
+{
+	bench::Options options;
+	options.revision = PINGSTATS_REVISION;
+
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string arg{ argv[i] };
+
+		if (i + 1 >= argc)
+		{
+			throw std::runtime_error("Missing value for \"" + arg + "\".");
+		}
+
+		const std::string value{ argv[++i] };
+
+		if (arg == "--filter")
+		{
+			options.filter = value;
+		}
+		else if (arg == "--json")
+		{
+			options.jsonPath = value;
+		}
+		else if (arg == "--repetitions")
+		{
+			options.repetitions = std::max<std::size_t>(std::stoul(value), 1);
+		}
+		else if (arg == "--warmup-ms")
+		{
+			options.warmup = bench::cr::milliseconds{ std::stoul(value) };
+		}
+		else if (arg == "--min-sample-ms")
+		{
+			options.minSampleTime = bench::cr::milliseconds{ std::stoul(value) };
+		}
+		else
+		{
+			throw std::runtime_error("Unknown option \"" + arg + "\".");
+		}
+	}
+
+	return options;
+}
+
+int main(int argc, char** argv) try
+{
+	const auto options{ parseOptions(argc, argv) };
+
+	bench::Runner runner{ options };
+
+	bench::addPingDataBenchmarks(runner);
+	bench::addCanvasBenchmarks(runner);
+	bench::addCanvasKernelBenchmarks(runner);
+	bench::addHeatmapBenchmarks(runner);
+	bench::addSnapshotBenchmarks(runner);
+	bench::addUtilityBenchmarks(runner);
+	bench::addZoomBenchmarks(runner);
+
+	runner.run();
+
+	if (!options.jsonPath.empty())
+	{
+		std::ofstream file{ options.jsonPath, std::ios::binary };
+		file << runner.toJson();
+
+		if (!file)
+		{
+			throw std::runtime_error("Writing \"" + options.jsonPath + "\" failed.");
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+catch (const std::exception& e)
+{
+	std::fprintf(stderr, "%s\n", e.what());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,270 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/tree_config.hpp"
+#include "ping_data.hpp"
+#include "windowed_quantiles.hpp"
+
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench
+{
+	// Deterministic stream of results with jitter and 1 % loss.
+	inline std::vector<pingstats::IcmpEchoResult> makeEchoResults(std::size_t count)
+	{
+		std::mt19937 engine{ 42 };
+		std::normal_distribution<double> latency{ 20.0, 4.0 };
+		std::uniform_int_distribution<int> loss{ 0, 99 };
+
+		std::vector<pingstats::IcmpEchoResult> results(count);
+		auto sentTime{ cr::steady_clock::now() - count * cr::milliseconds{ 500 } };
+
+		for (auto& result : results)
+		{
+			const auto lost{ loss(engine) == 0 };
+			const auto ms{ std::max(latency(engine), 1.0) };
+
+			result.sentTime = sentTime;
+			result.latency = lost ? cr::nanoseconds{ cr::seconds{ 1 } } :
+				cr::duration_cast<cr::nanoseconds>(ut::milliseconds_f64{ ms });
+			result.errorCode = lost ? 11010 : 0;
+			result.statusCode = result.errorCode;
+			result.responder = pingstats::IpEndPoint{ 0x0100007F };
+			result.sysLatency = static_cast<std::uint32_t>(ms);
+
+			sentTime += cr::milliseconds{ 500 };
+		}
+
+		return results;
+	}
+
+	// Checks LatencyBandWindow against sorting the window for every 
+	// sample, with plenty of duplicates, and that PingData keeps one 
+	// band per result through compaction.
+	inline void verifyLatencyBandWindow()
+	{
+		std::mt19937 engine{ 42 };
+		std::size_t checks{};
+
+		for (const auto window : { 1, 2, 7, 60 })
+		{
+			pingstats::LatencyBandWindow bandWindow{ static_cast<std::size_t>(window) };
+			std::vector<double> samples;
+
+			for (int i{}; i < 2000; ++i)
+			{
+				const auto ms{ static_cast<double>(engine() % 50) };
+
+				samples.push_back(ms);
+				bandWindow.push(ms);
+
+				std::vector<double> sorted(samples.end() - std::min<std::ptrdiff_t>(
+					window, static_cast<std::ptrdiff_t>(samples.size())), samples.end());
+				std::sort(sorted.begin(), sorted.end());
+
+				const auto rank{ [&](double q) {
+					return sorted[static_cast<std::size_t>(q * (sorted.size() - 1) + 0.5)];
+				} };
+
+				const auto band{ bandWindow.band() };
+
+				if (band.lowMs != rank(0.1) || band.highMs != rank(0.9))
+				{
+					throw std::runtime_error("LatencyBandWindow of " + std::to_string(window) + 
+						" disagrees with the sorted window at sample " + std::to_string(i) + ".");
+				}
+
+				++checks;
+			}
+		}
+
+		ut::TreeConfigNode config{ nullptr, "root" };
+		config.findOrAppendNode("stats")->storeValue("historySize", "100");
+
+		pingstats::PingData data{ config };
+		pingstats::IcmpEchoResult lost{};
+		lost.errorCode = 11010;
+		data.insertPingResult(lost);
+
+		if (data.latencyBands().front().valid())
+		{
+			throw std::runtime_error("PingData has a band before the first success.");
+		}
+
+		for (const auto& result : makeEchoResults(1000))
+		{
+			data.insertPingResult(result);
+
+			if (data.latencyBands().size() != data.pingResults().size())
+			{
+				throw std::runtime_error("PingData lost track of its latency bands.");
+			}
+		}
+
+		std::printf("latency band window: %zu checks\n", checks);
+	}
+
+	// Inserts on one thread while another reads through the thread-safe
+	// interface. Result k has k ms latency and responder k, so any snapshot
+	// mixing two insertions breaks the relations checked here.
+	inline void verifyPingDataSnapshots()
+	{
+		constexpr std::uint32_t RESULTS{ 50000 };
+
+		ut::TreeConfigNode config{ nullptr, "root" };
+		config.findOrAppendNode("stats")->storeValue("historySize", "64");
+
+		pingstats::PingData data{ config };
+		std::atomic<bool> done{};
+
+		std::thread writer{ [&] {
+			auto sentTime{ cr::steady_clock::now() };
+
+			for (std::uint32_t k{ 1 }; k <= RESULTS; ++k)
+			{
+				pingstats::IcmpEchoResult result{};
+				result.sentTime = sentTime;
+				result.latency = cr::milliseconds{ k };
+				result.responder = pingstats::IpEndPoint{ k };
+
+				data.insertPingResult(result);
+
+				// Same responder, so the published stats keep their relations.
+				if (k % 16 == 0)
+				{
+					data.insertTraceResult(result);
+				}
+
+				sentTime += cr::milliseconds{ 500 };
+			}
+
+			done.store(true, std::memory_order_release);
+		} };
+
+		const auto contiguous{ [](cr::nanoseconds step) {
+			return [step](const pingstats::IcmpEchoResult* results, std::size_t size) {
+				for (std::size_t i{ 1 }; i < size; ++i)
+				{
+					if (results[i].latency - results[i - 1].latency != step)
+					{
+						return false;
+					}
+				}
+
+				return true;
+			};
+		} };
+
+		std::size_t snapshots{};
+		std::size_t torn{};
+
+		while (!done.load(std::memory_order_acquire))
+		{
+			const auto stats{ data.loadStats() };
+
+			// Nothing published yet.
+			if (stats.pingResultCount == 0)
+			{
+				continue;
+			}
+
+			const auto k{ static_cast<double>(stats.lastResponder.addr4()) };
+
+			torn += stats.lastPing != k || stats.maxPing != k || 
+				stats.meanPing <= 0.0 || stats.meanPing > k ||
+				stats.lossPercentage != 0.0;
+			torn += !data.readPingResults(contiguous(cr::milliseconds{ 1 }));
+			torn += !data.readTraceResults(contiguous(cr::milliseconds{ 16 }));
+
+			++snapshots;
+		}
+
+		writer.join();
+
+		if (torn > 0)
+		{
+			throw std::runtime_error("PingData published " + std::to_string(torn) + 
+				" torn snapshots out of " + std::to_string(snapshots) + ".");
+		}
+
+		std::printf("ping data snapshots: %zu read during %u insertions, 0 torn\n", 
+			snapshots, RESULTS);
+	}
+
+	inline void addPingDataBenchmarks(Runner& runner)
+	{
+		verifyLatencyBandWindow();
+		verifyPingDataSnapshots();
+
+		const auto results{ std::make_shared<
+			std::vector<pingstats::IcmpEchoResult>>(makeEchoResults(4096)) };
+
+		const auto config{ std::make_shared<ut::TreeConfigNode>(nullptr, "root") };
+		const auto data{ std::make_shared<pingstats::PingData>(*config) };
+
+		runner.add("PingData::insertPingResult", 
+			[results, data, next = std::size_t{}](std::size_t iterations) mutable {
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					data->insertPingResult((*results)[next]);
+					next = (next + 1) % results->size();
+				}
+			}
+		);
+
+		runner.add("LatencyBandWindow::push 60 samples", 
+			[results, window = std::make_shared<pingstats::LatencyBandWindow>(60), 
+			next = std::size_t{}](std::size_t iterations) mutable {
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					window->push(ut::milliseconds_f64{ (*results)[next].latency }.count());
+					next = (next + 1) % results->size();
+				}
+
+				doNotOptimize(window->band());
+			}
+		);
+
+		const auto logResults{ std::make_shared<
+			std::vector<pingstats::IcmpEchoResult>>(makeEchoResults(256)) };
+
+		runner.add("makeLogString 256 results", [logResults](std::size_t iterations) {
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				doNotOptimize(pingstats::makeLogString(*logResults));
+			}
+		});
+	}
+}
@@ -0,0 +1,318 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "canvas_drawing.hpp"
+
+#include <cmath>
+
+// The floating point line rasterizer that drawPrettyLine replaced, kept
+// to check that the fixed point version produces the same output.
+
+namespace bench
+{
+	using pingstats::Canvas;
+	using pingstats::Color;
+	using pingstats::Rect;
+	using pingstats::Vertex;
+	using pingstats::fastround;
+	using pingstats::plot;
+	using pingstats::pxindex;
+
+	template <unsigned THICKNESS>
+	bool referenceDrawPrettyLine(
+		Canvas& canvas, 
+		const Rect& clip,
+		Color color, 
+		double x0, 
+		double y0, 
+		double x1, 
+		double y1,
+		bool prevSteep, 
+		bool isSteep, 
+		bool nextSteep, 
+		bool isFirst, 
+		bool isLast)
+	{
+		static_assert(THICKNESS <= 2, "Maximum thickness is 2.");
+
+		const auto fracpart{ [](double x) {
+			return x - static_cast<pxindex>(x);
+		} };
+
+		const auto drawEndpoint{ [=](
+			Canvas& canvas,
+			pxindex x,
+			double ry,
+			double xgap,
+			Color color)
+		{
+			switch (THICKNESS)
+			{
+			default:
+			{
+				const auto y{ fastround<pxindex>(ry) };
+
+				if (!isSteep)
+				{
+					plot(canvas, clip, x, y, color, xgap);
+				}
+				else
+				{
+					plot(canvas, clip, y, x, color, xgap);
+				}
+			}	break;
+
+			case 1:
+			{
+				const auto y{ static_cast<pxindex>(ry) };
+				const auto weight{ fracpart(ry) };
+
+				if (!isSteep)
+				{
+					plot(canvas, clip, x, y + 0, color, xgap * (1.0 - weight));
+					plot(canvas, clip, x, y + 1, color, xgap * weight);
+				}
+				else
+				{
+					plot(canvas, clip, y + 0, x, color, xgap * (1.0 - weight));
+					plot(canvas, clip, y + 1, x, color, xgap * weight);
+				}
+			}	break;
+
+			case 2:
+			{
+				const auto y{ fastround<pxindex>(ry) };
+				const auto weight{ fracpart(ry + 0.5) };
+
+				if (!isSteep)
+				{
+					plot(canvas, clip, x, y - 1, color, xgap * (1.0 - weight));
+					plot(canvas, clip, x, y + 0, color, xgap);
+					plot(canvas, clip, x, y + 1, color, xgap * weight);
+				}
+				else
+				{
+					plot(canvas, clip, y - 1, x, color, xgap * (1.0 - weight));
+					plot(canvas, clip, y + 0, x, color, xgap);
+					plot(canvas, clip, y + 1, x, color, xgap * weight);
+				}
+			}	break;
+			}
+		} };
+
+		if (isSteep)
+		{
+			std::swap(x0, y0);
+			std::swap(x1, y1);
+		}
+
+		const auto drawSwapped{ x0 > x1 };
+
+		if (drawSwapped)
+		{
+			std::swap(x0, x1);
+			std::swap(y0, y1);
+		}
+
+		bool isStartTransparent{ isFirst || prevSteep != isSteep };
+		bool isEndTransparent{ isLast || nextSteep != isSteep };
+		bool isStartSolid{ !isFirst && prevSteep == isSteep };
+		bool isEndSolid{ false };
+
+		if (drawSwapped)
+		{
+			std::swap(isStartTransparent, isEndTransparent);
+			std::swap(isStartSolid, isEndSolid);
+		}
+
+		const auto gradient{ (y1 - y0) / (x1 - x0) };
+		const auto xstart{ fastround<pxindex>(x0) };
+		const auto ystart{ y0 + gradient * (xstart - x0) };
+		const auto xend{ fastround<pxindex>(x1) };
+		const auto yend{ y1 + gradient * (xend - x1) };
+
+		if (isStartTransparent)
+		{
+			drawEndpoint(
+				canvas, 
+				xstart, 
+				ystart, 
+				1.0 - fracpart(x0 + 0.5), 
+				color);
+		}
+
+		if (isEndTransparent)
+		{
+			drawEndpoint(canvas, xend, yend, fracpart(x1 + 0.5), color);
+		}
+
+		const auto itstart{ xstart + !isStartSolid };
+		const auto itend{ xend + isEndSolid };
+		auto ry{ ystart + !isStartSolid * gradient };
+
+		if (!isSteep)
+		{
+			for (auto x{ itstart }; x < itend; ++x, ry += gradient)
+			{
+				switch (THICKNESS)
+				{
+				default:
+				{
+					plot(canvas, clip, x, fastround<pxindex>(ry), color, 1);
+				}	break;
+
+				case 1:
+				{
+					const auto y{ static_cast<pxindex>(ry) };
+					const auto weight{ fracpart(ry) };
+					plot(canvas, clip, x, y - 0, color, 1 - weight);
+					plot(canvas, clip, x, y + 1, color, weight);
+				}	break;
+
+				case 2:
+				{
+					const auto y{ fastround<pxindex>(ry) };
+					const auto weight{ fracpart(ry + 0.5) };
+					plot(canvas, clip, x, y - 1, color, 1 - weight);
+					plot(canvas, clip, x, y + 0, color, 1);
+					plot(canvas, clip, x, y + 1, color, weight);
+				}	break;
+				}
+			}
+		}
+		else
+		{
+			for (auto x{ itstart }; x < itend; ++x, ry += gradient)
+			{
+				switch (THICKNESS)
+				{
+				default:
+				{
+					plot(canvas, clip, fastround<pxindex>(ry), x, color, 1);
+				}	break;
+
+				case 1:
+				{
+					const auto y{ static_cast<pxindex>(ry) };
+					const auto weight{ fracpart(ry) };
+					plot(canvas, clip, y - 0, x, color, 1 - weight);
+					plot(canvas, clip, y + 1, x, color, weight);
+				}	break;
+
+				case 2:
+				{
+					const auto y{ fastround<pxindex>(ry) };
+					const auto weight{ fracpart(ry + 0.5) };
+					plot(canvas, clip, y - 1, x, color, 1 - weight);
+					plot(canvas, clip, y + 0, x, color, 1);
+					plot(canvas, clip, y + 1, x, color, weight);
+				}	break;
+				}
+			}
+		}
+
+		return isSteep;
+	}
+
+	template <unsigned THICKNESS>
+	void referenceDrawPrettyLines(Canvas& canvas, 
+		const Rect& clip, const Vertex* vertices, std::size_t nVertices)
+	{
+		if (nVertices >= 2)
+		{
+			bool prevSteep{ false };
+
+			for (std::size_t i{}; i + 1 < nVertices; ++i)
+			{
+				const auto x0{ vertices[i].x };
+				const auto y0{ vertices[i].y };
+				const auto x1{ vertices[i + 1].x };
+				const auto y1{ vertices[i + 1].y };
+
+				const auto isSteep{ std::abs(x1 - x0) < std::abs(y1 - y0) };
+				const auto nextSteep{ i + 2 >= nVertices ? false :
+					std::abs(vertices[i + 2].x - vertices[i + 1].x) < 
+					std::abs(vertices[i + 2].y - vertices[i + 1].y) };
+
+				referenceDrawPrettyLine<THICKNESS>(
+					canvas, clip, vertices[i + 1].color, 
+					x0, y0, x1, y1,
+					prevSteep, isSteep, nextSteep,
+					i == 0, i + 2 == nVertices);
+
+				prevSteep = isSteep;
+			}
+		}
+	}
+
+	// Brute force for drawThickLines: every pixel of the clip rect is
+	// measured against every segment. Ties in coverage go to the later 
+	// segment, as there.
+	inline void referenceDrawThickLines(Canvas& canvas, const Rect& clip, 
+		double thickness, const Vertex* vertices, std::size_t nVertices)
+	{
+		using pingstats::raster::fixed;
+
+		const auto radius{ thickness / 2.0 + 0.5 };
+
+		for (auto y{ clip.top }; y < clip.bottom; ++y)
+		{
+			for (auto x{ clip.left }; x < clip.right; ++x)
+			{
+				std::int32_t best{};
+				std::size_t bestIndex{};
+
+				for (std::size_t i{}; i + 1 < nVertices; ++i)
+				{
+					const auto& a{ vertices[i] };
+					const auto& b{ vertices[i + 1] };
+
+					const auto dx{ b.x - a.x };
+					const auto dy{ b.y - a.y };
+					const auto lengthSquared{ dx * dx + dy * dy };
+					const auto t{ lengthSquared > 0.0 ? std::clamp(
+						((x - a.x) * dx + (y - a.y) * dy) / lengthSquared, 0.0, 1.0) : 0.0 };
+
+					const auto ex{ x - (a.x + t * dx) };
+					const auto ey{ y - (a.y + t * dy) };
+					const auto weight{ pingstats::raster::thickLineWeight(
+						radius, std::sqrt(ex * ex + ey * ey)) };
+
+					if (weight > 0 && weight >= best)
+					{
+						best = weight;
+						bestIndex = i;
+					}
+				}
+
+				if (best > 0)
+				{
+					canvas(x, y) = pingstats::raster::blend(canvas(x, y), 
+						vertices[bestIndex + 1].color.value, fixed{ best } << 8);
+				}
+			}
+		}
+	}
+}
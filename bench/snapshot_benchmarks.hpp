@@ -0,0 +1,441 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/tree_config.hpp"
+#include "ping_data.hpp"
+#include "ping_plotter.hpp"
+#include "png_encoder.hpp"
+#include "snapshot_renderer.hpp"
+
+#include "benchmark.hpp"
+#include "ping_data_benchmarks.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	// Inflates a zlib stream made of fixed Huffman blocks, which is all 
+	// encodePng writes. Just enough to check the encoder round trips.
+	inline std::vector<std::uint8_t> inflateFixed(const std::uint8_t* data, std::size_t size)
+	{
+		static constexpr std::uint16_t LENGTH_BASE[29]{ 
+			3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 
+			35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static constexpr std::uint8_t LENGTH_EXTRA[29]{ 
+			0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 
+			3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static constexpr std::uint16_t DISTANCE_BASE[30]{ 
+			1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 
+			257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 
+			8193, 12289, 16385, 24577 };
+		static constexpr std::uint8_t DISTANCE_EXTRA[30]{ 
+			0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 
+			7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		const auto invalid{ [] { return std::runtime_error("inflateFixed: invalid stream"); } };
+
+		if (size < 6 || data[0] != 0x78 || ((data[0] << 8 | data[1]) % 31) != 0)
+		{
+			throw invalid();
+		}
+
+		std::size_t bit{ 16 };
+		const auto end{ (size - 4) * 8 };
+
+		const auto readBit{ [&] {
+			if (bit >= end)
+			{
+				throw invalid();
+			}
+
+			const auto value{ (data[bit / 8] >> (bit % 8)) & 1u };
+			++bit;
+			return value;
+		} };
+
+		const auto readBits{ [&](unsigned count) {
+			std::uint32_t value{};
+
+			for (unsigned i{}; i < count; ++i)
+			{
+				value |= readBit() << i;
+			}
+
+			return value;
+		} };
+
+		const auto readSymbol{ [&] {
+			std::uint32_t code{};
+
+			for (unsigned length{ 1 }; length <= 9; ++length)
+			{
+				code = code << 1 | readBit();
+
+				if (length == 7 && code <= 23)
+				{
+					return 256 + code;
+				}
+				else if (length == 8 && code >= 0x30 && code <= 0xBF)
+				{
+					return code - 0x30;
+				}
+				else if (length == 8 && code >= 0xC0 && code <= 0xC7)
+				{
+					return 280 + code - 0xC0;
+				}
+				else if (length == 9 && code >= 0x190)
+				{
+					return 144 + code - 0x190;
+				}
+			}
+
+			throw invalid();
+		} };
+
+		std::vector<std::uint8_t> out;
+
+		for (auto final{ 0u }; final == 0; )
+		{
+			final = readBit();
+
+			if (readBits(2) != 1)
+			{
+				throw invalid();
+			}
+
+			for (auto symbol{ readSymbol() }; symbol != 256; symbol = readSymbol())
+			{
+				if (symbol < 256)
+				{
+					out.push_back(static_cast<std::uint8_t>(symbol));
+					continue;
+				}
+
+				if (symbol > 285)
+				{
+					throw invalid();
+				}
+
+				const auto length{ LENGTH_BASE[symbol - 257] + readBits(LENGTH_EXTRA[symbol - 257]) };
+
+				std::uint32_t distanceSymbol{};
+
+				for (int i{}; i < 5; ++i)
+				{
+					distanceSymbol = distanceSymbol << 1 | readBit();
+				}
+
+				if (distanceSymbol >= 30)
+				{
+					throw invalid();
+				}
+
+				const auto distance{ DISTANCE_BASE[distanceSymbol] + 
+					readBits(DISTANCE_EXTRA[distanceSymbol]) };
+
+				if (distance > out.size())
+				{
+					throw invalid();
+				}
+
+				for (std::uint32_t i{}; i < length; ++i)
+				{
+					out.push_back(out[out.size() - distance]);
+				}
+			}
+		}
+
+		std::uint32_t adler{};
+
+		for (std::size_t i{ size - 4 }; i < size; ++i)
+		{
+			adler = adler << 8 | data[i];
+		}
+
+		if (adler != pingstats::png::adler32(1, out.data(), out.size()))
+		{
+			throw invalid();
+		}
+
+		return out;
+	}
+
+	inline std::uint32_t loadBigEndian(const std::uint8_t* data)
+	{
+		return static_cast<std::uint32_t>(data[0]) << 24 | data[1] << 16 | data[2] << 8 | data[3];
+	}
+
+	// Decodes the output of encodePng back to 0x00RRGGBB pixels.
+	inline std::vector<std::uint32_t> decodePng(
+		const std::vector<std::uint8_t>& png, std::size_t& width, std::size_t& height)
+	{
+		static constexpr std::uint8_t SIGNATURE[8]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+		const auto invalid{ [] { return std::runtime_error("decodePng: invalid file"); } };
+
+		if (png.size() < 8 || std::memcmp(png.data(), SIGNATURE, 8) != 0)
+		{
+			throw invalid();
+		}
+
+		std::vector<std::uint8_t> idat;
+		std::size_t offset{ 8 };
+		std::string lastChunk;
+
+		while (offset + 12 <= png.size())
+		{
+			const auto size{ loadBigEndian(png.data() + offset) };
+			const std::string type(reinterpret_cast<const char*>(png.data() + offset + 4), 4);
+
+			if (offset + 12 + size > png.size())
+			{
+				throw invalid();
+			}
+
+			const auto chunk{ png.data() + offset + 8 };
+
+			if (loadBigEndian(chunk + size) != pingstats::png::crc32(0, chunk - 4, size + 4))
+			{
+				throw std::runtime_error("decodePng: CRC mismatch in " + type);
+			}
+
+			if (type == "IHDR")
+			{
+				if (size != 13 || chunk[8] != 8 || chunk[9] != 2 || chunk[12] != 0)
+				{
+					throw invalid();
+				}
+
+				width = loadBigEndian(chunk);
+				height = loadBigEndian(chunk + 4);
+			}
+			else if (type == "IDAT")
+			{
+				idat.insert(idat.end(), chunk, chunk + size);
+			}
+
+			lastChunk = type;
+			offset += 12 + size;
+		}
+
+		if (offset != png.size() || lastChunk != "IEND")
+		{
+			throw invalid();
+		}
+
+		const auto raw{ inflateFixed(idat.data(), idat.size()) };
+		const auto rowSize{ 1 + 3 * width };
+
+		if (raw.size() != rowSize * height)
+		{
+			throw invalid();
+		}
+
+		std::vector<std::uint8_t> rgb(3 * width * height);
+
+		for (std::size_t y{}; y < height; ++y)
+		{
+			const auto filter{ raw[y * rowSize] };
+			const auto src{ raw.data() + y * rowSize + 1 };
+			const auto dest{ rgb.data() + y * 3 * width };
+
+			for (std::size_t i{}; i < 3 * width; ++i)
+			{
+				const auto left{ i >= 3 ? dest[i - 3] : 0 };
+				const auto up{ y > 0 ? dest[i - 3 * width] : 0 };
+
+				dest[i] = static_cast<std::uint8_t>(src[i] + 
+					(filter == 0 ? 0 : filter == 1 ? left : filter == 2 ? up : throw invalid()));
+			}
+		}
+
+		std::vector<std::uint32_t> pixels(width * height);
+
+		for (std::size_t i{}; i < pixels.size(); ++i)
+		{
+			pixels[i] = static_cast<std::uint32_t>(rgb[3 * i]) << 16 | rgb[3 * i + 1] << 8 | rgb[3 * i + 2];
+		}
+
+		return pixels;
+	}
+
+	inline void verifyPngEncoder()
+	{
+		using namespace pingstats;
+
+		const std::string check{ "123456789" };
+		const auto checkData{ reinterpret_cast<const std::uint8_t*>(check.data()) };
+
+		if (png::crc32(0, checkData, check.size()) != 0xCBF43926 ||
+			png::adler32(1, checkData, check.size()) != 0x091E01DE)
+		{
+			throw std::runtime_error("verifyPngEncoder: checksum mismatch");
+		}
+
+		// Noise, flat runs longer than 258 bytes, repeated rows and a stride
+		// wider than the image, in a size that doesn't fill whole words.
+		const std::size_t width{ 301 };
+		const std::size_t height{ 37 };
+		const std::size_t stride{ 320 };
+
+		std::vector<std::uint32_t> pixels(stride * height, 0xFFFFFFFF);
+		std::uint32_t state{ 12345 };
+
+		for (std::size_t y{}; y < height; ++y)
+		{
+			for (std::size_t x{}; x < width; ++x)
+			{
+				state = state * 1664525 + 1013904223;
+
+				pixels[y * stride + x] = 
+					y % 5 == 4 ? pixels[(y - 1) * stride + x] :
+					x > 100 && x < 250 ? 0x000A0B0C :
+					(state >> 8) & 0x00FFFFFF;
+			}
+		}
+
+		std::vector<std::uint8_t> out;
+		std::vector<std::uint8_t> scratch;
+		encodePng(out, scratch, pixels.data(), width, height, stride);
+
+		std::size_t decodedWidth{};
+		std::size_t decodedHeight{};
+		const auto decoded{ decodePng(out, decodedWidth, decodedHeight) };
+
+		if (decodedWidth != width || decodedHeight != height)
+		{
+			throw std::runtime_error("verifyPngEncoder: size mismatch");
+		}
+
+		for (std::size_t y{}; y < height; ++y)
+		{
+			for (std::size_t x{}; x < width; ++x)
+			{
+				if (decoded[y * width + x] != pixels[y * stride + x])
+				{
+					throw std::runtime_error("verifyPngEncoder: pixel mismatch at " + 
+						std::to_string(x) + ", " + std::to_string(y));
+				}
+			}
+		}
+
+		const auto allocations{ allocationCount.load() };
+		encodePng(out, scratch, pixels.data(), width, height, stride);
+
+		if (allocationCount.load() != allocations)
+		{
+			throw std::runtime_error("verifyPngEncoder: encoding allocated");
+		}
+	}
+
+	// A section with half an hour of results at 2 Hz, rendered as a 
+	// 480x320 snapshot.
+	class SnapshotFixture
+	{
+	public:
+		ut::TreeConfigNode config{ nullptr, "snapshot" };
+		pingstats::PingData data{ config };
+		pingstats::PingPlotter plotter{ config };
+		pingstats::SnapshotRenderer renderer;
+		cr::steady_clock::time_point now;
+
+		SnapshotFixture()
+		{
+			const auto results{ makeEchoResults(3600) };
+
+			for (auto& result : results)
+			{
+				data.insertPingResult(result);
+			}
+
+			now = results.back().sentTime + cr::seconds{ 1 };
+		}
+	};
+
+	inline void verifySnapshotRenderer()
+	{
+		SnapshotFixture fixture;
+
+		const auto& png{ fixture.renderer.render(fixture.plotter, fixture.data, 480, 320, fixture.now) };
+
+		std::size_t width{};
+		std::size_t height{};
+		const auto decoded{ decodePng(png, width, height) };
+
+		auto& canvas{ fixture.renderer.canvas() };
+
+		if (width != 480 || height != 320 || 
+			!std::equal(decoded.begin(), decoded.end(), canvas.pixelPtr(), 
+				[](std::uint32_t a, std::uint32_t b) { return a == (b & 0x00FFFFFF); }))
+		{
+			throw std::runtime_error("verifySnapshotRenderer: image doesn't match canvas");
+		}
+	}
+
+	inline void addSnapshotBenchmarks(Runner& runner)
+	{
+		using namespace pingstats;
+
+		verifyPngEncoder();
+		verifySnapshotRenderer();
+
+		const auto fixture{ std::make_shared<SnapshotFixture>() };
+
+		// Every snapshot advances the clock, so the plot scrolls and the 
+		// info panel changes like it would between alerts. It wraps around
+		// before the recorded results scroll out of view.
+		runner.add("SnapshotRenderer 480x320 render + PNG", 
+			[fixture, offset = cr::milliseconds{}](std::size_t iterations) mutable {
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					offset = (offset + cr::milliseconds{ 100 }) % cr::seconds{ 10 };
+
+					const auto& png{ fixture->renderer.render(fixture->plotter, 
+						fixture->data, 480, 320, fixture->now + offset) };
+					doNotOptimize(png.back());
+				}
+			}
+		);
+
+		runner.add("encodePng 480x320 section", 
+			[fixture, out = std::vector<std::uint8_t>{}, scratch = std::vector<std::uint8_t>{}]
+			(std::size_t iterations) mutable {
+				fixture->renderer.render(fixture->plotter, fixture->data, 480, 320, fixture->now);
+				auto& canvas{ fixture->renderer.canvas() };
+
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					encodePng(out, scratch, canvas.pixelPtr(), 480, 320, 480);
+					doNotOptimize(out.back());
+				}
+			}
+		);
+	}
+}
@@ -0,0 +1,333 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/base64.hpp"
+#include "utility/event_trace.hpp"
+#include "utility/fixed_string.hpp"
+#include "utility/tree_config.hpp"
+#include "render_profiler.hpp"
+
+#include "benchmark.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace bench
+{
+	inline std::string makeSampleConfig()
+	{
+		ut::TreeConfigNode root{ nullptr, "root" };
+
+		for (int i{}; i < 8; ++i)
+		{
+			auto& section{ *root.appendNode("section" + std::to_string(i)) };
+
+			section.storeValue("target", "192.168.0." + std::to_string(i));
+			section.storeValue("pingInterval", 500 + i);
+			section.storeValue("historySize", 7200);
+
+			auto& plotter{ *section.appendNode("plotter") };
+
+			plotter.storeValue("fontName", std::string{ "Consolas" });
+			plotter.storeValue("lineThickness", 2);
+			plotter.storeValue("pixelPerMs", 2.5);
+			plotter.storeValue("lineColor", std::string{ "0xFF80FF80" });
+		}
+
+		return ut::serializeTreeConfig(root);
+	}
+
+	inline void verifyFixedString()
+	{
+		std::mt19937 engine{ 11 };
+		std::uniform_real_distribution<double> magnitude{ -3.0, 5.0 };
+
+		for (int i{}; i < 100000; ++i)
+		{
+			const auto value{ std::pow(10.0, magnitude(engine)) * (i % 7 == 0 ? -1 : 1) };
+			const auto precision{ i % 4 };
+			const auto width{ static_cast<std::size_t>(i % 6) };
+
+			ut::FixedString<64> actual;
+			actual.appendFixed(value, precision, width).append(' ')
+				.appendInteger(i - 50000, width, i % 2 ? '0' : ' ');
+
+			char expected[64];
+			const auto size{ std::snprintf(expected, sizeof expected, 
+				i % 2 ? "%*.*f %0*d" : "%*.*f %*d", static_cast<int>(width), 
+				precision, value, static_cast<int>(width), i - 50000) };
+
+			// Ties may round differently, printf sees the exact binary value.
+			if (actual.view() != std::string_view{ expected, static_cast<std::size_t>(size) } &&
+				std::abs(std::abs(value) * std::pow(10.0, precision) - 
+					std::floor(std::abs(value) * std::pow(10.0, precision)) - 0.5) > 1e-6)
+			{
+				throw std::runtime_error("FixedString formatted \"" + 
+					std::string{ actual.view() } + "\" instead of \"" + expected + "\".");
+			}
+		}
+	}
+
+	inline void verifyRenderProfiler()
+	{
+		pingstats::RenderProfiler profiler{ { "section" } };
+		const auto channel{ pingstats::RenderProfiler::sectionChannel(0) };
+
+		for (int us{ 1 }; us <= 1000; ++us)
+		{
+			profiler.record(channel, cr::microseconds{ us });
+		}
+
+		// Only the last 512 samples (489 to 1000 us) are kept.
+		const auto summary{ profiler.summary(channel) };
+
+		if (summary.samples != pingstats::TimingRing::SIZE || 
+			summary.p50Us != 744.0 || summary.p99Us != 994.0 || summary.maxUs != 1000.0)
+		{
+			throw std::runtime_error("RenderProfiler summary is wrong.");
+		}
+
+		ut::FixedString<64> line;
+		profiler.formatLine(line, channel);
+
+		if (line.view() != "section           744.0    994.0   1000.0   512" ||
+			line.size() != pingstats::RenderProfiler::header().size())
+		{
+			throw std::runtime_error("RenderProfiler formatted \"" + 
+				std::string{ line.view() } + "\".");
+		}
+
+		if (profiler.summary(0).samples != 0)
+		{
+			throw std::runtime_error("RenderProfiler channels are not separate.");
+		}
+
+		profiler.countVertices(1000);
+		profiler.countVertices(234);
+		profiler.endFrame();
+		profiler.endFrame();
+
+		const auto vertices{ profiler.summary(profiler.vertexChannel()) };
+		profiler.formatLine(line, profiler.vertexChannel());
+
+		if (vertices.samples != 2 || vertices.maxUs != 1234.0 ||
+			line.view() != "vertices              0        0     1234     2")
+		{
+			throw std::runtime_error("RenderProfiler counted vertices as \"" + 
+				std::string{ line.view() } + "\".");
+		}
+	}
+
+	inline std::size_t countOccurrences(std::string_view s, std::string_view pattern)
+	{
+		std::size_t count{};
+
+		for (auto i{ s.find(pattern) }; i != s.npos; i = s.find(pattern, i + 1))
+		{
+			++count;
+		}
+
+		return count;
+	}
+
+	inline void verifyEventTrace()
+	{
+		auto& tracer{ ut::eventTracer() };
+		tracer.setEnabled(true);
+
+		std::thread first{ [] {
+			ut::eventTracer().setThreadName("verify \"first\"");
+			PINGSTATS_TRACE_SCOPE("verify scope", 7);
+			PINGSTATS_TRACE_INSTANT("verify instant", 8);
+
+			PINGSTATS_TRACE_SCOPE("verify sleep", 0);
+			std::this_thread::sleep_for(cr::milliseconds{ 5 });
+		} };
+
+		// Wraps the ring, only the newest CAPACITY events survive.
+		std::thread second{ [] {
+			ut::eventTracer().setThreadName("verify second");
+			PINGSTATS_TRACE_INSTANT("verify dropped", 0);
+
+			for (std::size_t i{}; i < ut::TraceBuffer::CAPACITY; ++i)
+			{
+				PINGSTATS_TRACE_INSTANT("verify kept", 0);
+			}
+		} };
+
+		first.join();
+		second.join();
+		tracer.setEnabled(false);
+
+		PINGSTATS_TRACE_INSTANT("verify disabled", 0);
+
+		const auto json{ tracer.toJson() };
+
+		if (json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) != 0 ||
+			countOccurrences(json, "{") != countOccurrences(json, "}") ||
+			countOccurrences(json, "\"verify \\\"first\\\"\"") != 1 ||
+			countOccurrences(json, "\"verify scope\",\"ph\":\"X\"") != 1 ||
+			countOccurrences(json, "\"verify instant\",\"ph\":\"i\"") != 1 ||
+			countOccurrences(json, "\"value\":7") != 1 ||
+			countOccurrences(json, "verify kept") != ut::TraceBuffer::CAPACITY ||
+			countOccurrences(json, "verify dropped") != 0 ||
+			countOccurrences(json, "verify disabled") != 0)
+		{
+			throw std::runtime_error("EventTracer produced a wrong trace.");
+		}
+
+		// Ticks are converted when dumping, the sleep has to come out as at least 5 ms.
+		const auto sleep{ json.find("\"dur\":", json.find("\"verify sleep\"")) };
+		const auto sleepUs{ sleep == json.npos ? 0.0 : std::strtod(&json[sleep + 6], nullptr) };
+
+		if (sleepUs < 5000.0 || sleepUs > 1e6)
+		{
+			throw std::runtime_error("EventTracer converted a 5 ms scope to " + 
+				std::to_string(sleepUs) + " us.");
+		}
+	}
+
+	inline void addUtilityBenchmarks(Runner& runner)
+	{
+		verifyFixedString();
+		verifyRenderProfiler();
+		verifyEventTrace();
+
+		const auto config{ std::make_shared<std::string>(makeSampleConfig()) };
+
+		runner.add("parseTreeConfig", [config](std::size_t iterations) {
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				ut::TreeConfigNode root{ nullptr, "root" };
+				ut::parseTreeConfig(root, config->c_str());
+				doNotOptimize(root);
+			}
+		});
+
+		const auto tree{ std::make_shared<ut::TreeConfigNode>(nullptr, "root") };
+		ut::parseTreeConfig(*tree, config->c_str());
+
+		runner.add("serializeTreeConfig", [tree](std::size_t iterations) {
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				doNotOptimize(ut::serializeTreeConfig(*tree));
+			}
+		});
+
+		constexpr std::size_t BYTES{ 3 * 1024 };
+
+		const auto binary{ std::make_shared<std::vector<std::uint8_t>>(BYTES) };
+		const auto text{ std::make_shared<std::string>(
+			base64::encodedLength(BYTES), '\0') };
+
+		std::mt19937 engine{ 42 };
+
+		for (auto& b : *binary)
+		{
+			b = static_cast<std::uint8_t>(engine());
+		}
+
+		base64::encode(&(*text)[0], binary->data(), binary->size());
+
+		runner.add("base64::encode 3 KiB", [binary, text](std::size_t iterations) {
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				base64::encode(&(*text)[0], binary->data(), binary->size());
+				doNotOptimize(*text);
+			}
+		});
+
+		runner.add("base64::decode 3 KiB", [binary, text](std::size_t iterations) {
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				base64::decode(binary->data(), text->data(), binary->size());
+				doNotOptimize(*binary);
+			}
+		});
+
+		const auto profiler{ std::make_shared<pingstats::RenderProfiler>(
+			std::vector<std::string>{}) };
+
+		for (const auto enabled : { false, true })
+		{
+			runner.add(enabled ? "ProfileScope enabled" : "ProfileScope disabled", 
+				[profiler, enabled](std::size_t iterations) {
+					const auto target{ enabled ? profiler.get() : nullptr };
+					doNotOptimize(target);
+
+					for (std::size_t i{}; i < iterations; ++i)
+					{
+						pingstats::ProfileScope scope{ target, pingstats::RenderPhase::PLOT };
+					}
+				}
+			);
+		}
+
+		for (const auto enabled : { false, true })
+		{
+			runner.add(enabled ? "trace scope enabled" : "trace scope disabled", 
+				[enabled](std::size_t iterations) {
+					ut::eventTracer().setEnabled(enabled);
+
+					for (std::size_t i{}; i < iterations; ++i)
+					{
+						PINGSTATS_TRACE_SCOPE("benchmark", i);
+					}
+
+					ut::eventTracer().setEnabled(false);
+				}
+			);
+		}
+
+		// One stamp instead of two, and what a stamp costs alone. Scopes
+		// cost about two stamps plus the instant's bookkeeping.
+		runner.add("trace instant enabled", [](std::size_t iterations) {
+			ut::eventTracer().setEnabled(true);
+
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				PINGSTATS_TRACE_INSTANT("benchmark", i);
+			}
+
+			ut::eventTracer().setEnabled(false);
+		});
+
+		runner.add("EventTracer::ticks", [](std::size_t iterations) {
+			for (std::size_t i{}; i < iterations; ++i)
+			{
+				doNotOptimize(ut::EventTracer::ticks());
+			}
+		});
+	}
+}
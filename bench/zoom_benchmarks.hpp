@@ -0,0 +1,238 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+#pragma once
+
+#include "utility/tree_config.hpp"
+#include "latency_pyramid.hpp"
+#include "ping_data.hpp"
+#include "ping_plotter.hpp"
+
+#include "benchmark.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	// Results every 500 ms with a latency that drifts over the day, a few
+	// losses and an hour long gap.
+	inline std::vector<pingstats::IcmpEchoResult> makeHistory(
+		cr::steady_clock::time_point end, cr::seconds duration)
+	{
+		std::mt19937 engine{ 7 };
+		std::normal_distribution<double> noise{ 0.0, 3.0 };
+
+		const auto count{ static_cast<std::size_t>(duration / cr::milliseconds{ 500 }) };
+		std::vector<pingstats::IcmpEchoResult> results;
+		results.reserve(count);
+
+		for (std::size_t i{}; i < count; ++i)
+		{
+			const auto sentTime{ end - duration + i * cr::milliseconds{ 500 } };
+
+			if (i % 20000 < 7200)
+			{
+				continue;
+			}
+
+			const auto hours{ i / 7200.0 };
+			const auto ms{ std::max(1.0, 30.0 + 10.0 * std::sin(hours * 0.26) + noise(engine)) };
+			const auto lost{ engine() % 200 == 0 };
+
+			pingstats::IcmpEchoResult result{};
+			result.sentTime = sentTime;
+			result.latency = cr::duration_cast<cr::nanoseconds>(ut::milliseconds_f64{ ms });
+			result.errorCode = lost ? 11010 : 0;
+			result.statusCode = result.errorCode;
+			results.push_back(result);
+		}
+
+		return results;
+	}
+
+	inline void verifyLatencyPyramid()
+	{
+		using pingstats::LatencyPyramid;
+		using pingstats::PyramidBucket;
+
+		const auto end{ cr::steady_clock::time_point{ cr::hours{ 1000 } } };
+		const auto results{ makeHistory(end, cr::hours{ 12 }) };
+
+		LatencyPyramid pyramid;
+
+		for (const auto& result : results)
+		{
+			pyramid.insert(result);
+		}
+
+		std::mt19937 engine{ 3 };
+		const auto endSeconds{ ut::seconds_f64{ end.time_since_epoch() }.count() };
+
+		for (int test{}; test < 200; ++test)
+		{
+			const auto level{ engine() % 16 };
+			const auto length{ std::ldexp(1.0, static_cast<int>(engine() % 17)) };
+			const auto begin{ endSeconds - 12 * 3600.0 + (engine() % (12 * 3600)) };
+
+			PyramidBucket sum{};
+			pyramid.forEach(level, begin, begin + length, 
+				[&](double, const PyramidBucket& bucket) { sum.add(bucket); });
+
+			// The buckets that start in the range cover it rounded to them.
+			const auto seconds{ LatencyPyramid::bucketSeconds(level) };
+			const auto first{ std::ceil(begin / seconds) * seconds };
+			const auto last{ std::ceil((begin + length) / seconds) * seconds };
+
+			PyramidBucket expected{};
+
+			for (const auto& result : results)
+			{
+				const auto t{ std::floor(ut::seconds_f64{ result.sentTime.time_since_epoch() }.count()) };
+
+				if (t >= first && t < last)
+				{
+					PyramidBucket one{};
+					const auto ms{ ut::milliseconds_f64{ result.latency }.count() };
+
+					if (result.errorCode == 0)
+					{
+						one = PyramidBucket{ static_cast<float>(ms), static_cast<float>(ms), ms, 1, 0 };
+					}
+					else
+					{
+						one.losses = 1;
+					}
+
+					expected.add(one);
+				}
+			}
+
+			if (sum.samples != expected.samples || sum.losses != expected.losses ||
+				sum.minMs != expected.minMs || sum.maxMs != expected.maxMs ||
+				std::abs(sum.sumMs - expected.sumMs) > 1e-6 * expected.sumMs)
+			{
+				throw std::runtime_error("LatencyPyramid level " + std::to_string(level) + 
+					" disagrees with the results it was built from.");
+			}
+		}
+
+		// Between one and two hours before the last result are kept.
+		LatencyPyramid small{ 3600 };
+
+		for (const auto& result : results)
+		{
+			small.insert(result);
+		}
+
+		const auto last{ results.back().sentTime };
+
+		if (small.oldest() < last - cr::hours{ 2 } || small.oldest() > last - cr::hours{ 1 })
+		{
+			throw std::runtime_error("LatencyPyramid keeps the wrong range.");
+		}
+	}
+
+	// A week of results at 2 Hz in one section.
+	class WeekFixture
+	{
+	public:
+		ut::TreeConfigNode config{ nullptr, "week" };
+		pingstats::PingData data{ config };
+		pingstats::PingPlotter plotter{ config };
+		pingstats::Canvas canvas{ 1920, 1080 };
+		cr::steady_clock::time_point now{ cr::steady_clock::now() };
+
+		WeekFixture()
+		{
+			for (const auto& result : makeHistory(now, cr::hours{ 7 * 24 }))
+			{
+				data.insertPingResult(result);
+			}
+		}
+
+		void draw()
+		{
+			plotter.redraw(canvas, pingstats::Rect{ 0, 0, canvas.width(), canvas.height() }, 
+				data, now, now, false);
+		}
+	};
+
+	inline void addZoomBenchmarks(Runner& runner)
+	{
+		verifyLatencyPyramid();
+
+		runner.add("LatencyPyramid::insert", [pyramid = std::make_shared<pingstats::LatencyPyramid>(), 
+			results = std::make_shared<std::vector<pingstats::IcmpEchoResult>>(
+				makeHistory(cr::steady_clock::time_point{ cr::hours{ 1000 } }, cr::hours{ 24 }))]
+			(std::size_t iterations) {
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					pyramid->insert((*results)[i % results->size()]);
+				}
+			}
+		);
+
+		// Every frame zooms by a wheel notch, from the native scale out 
+		// to the whole week and back in, and draws it all again.
+		const auto week{ std::make_shared<WeekFixture>() };
+
+		runner.add("PingPlotter zoom through a week 1920x1080", 
+			[week, step = 0](std::size_t iterations) mutable {
+				constexpr auto STEPS{ 48 };
+
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					week->plotter.zoom(step < STEPS ? 1.25 : 0.8, 0.0, week->now);
+					week->draw();
+					doNotOptimize(*week->canvas.pixelPtr());
+
+					step = (step + 1) % (2 * STEPS);
+				}
+			}
+		);
+
+		runner.add("PingPlotter pan a zoomed week 1920x1080", 
+			[week, step = 0](std::size_t iterations) mutable {
+				for (std::size_t i{}; i < iterations; ++i)
+				{
+					if (step == 0)
+					{
+						week->plotter.resetView();
+						week->plotter.zoom(256.0, 0.0, week->now);
+					}
+
+					week->plotter.pan(step < 100 ? 40.0 : -40.0, week->now);
+					week->draw();
+					doNotOptimize(*week->canvas.pixelPtr());
+
+					step = (step + 1) % 200;
+				}
+			}
+		);
+	}
+}
@@ -0,0 +1,113 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+// Renders one section of a result trace (see recordResultTrace) into a 
+// PNG, the same way the window draws it but without a window or GDI.
+//
+//   snapshot <trace file> <section> <png file> [width] [height]
+
+#include "utility/tree_config.hpp"
+#include "ping_data.hpp"
+#include "ping_plotter.hpp"
+#include "result_trace.hpp"
+#include "snapshot_renderer.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char** argv) try
+{
+	namespace ps = pingstats;
+	namespace ut = utility;
+
+	if (argc < 4)
+	{
+		std::fprintf(stderr, "Usage: %s <trace file> <section> <png file> [width] [height]\n", argv[0]);
+		return 2;
+	}
+
+	const auto trace{ ps::readResultTrace(argv[1]) };
+	const std::string sectionName{ argv[2] };
+	const auto width{ argc > 4 ? std::atoi(argv[4]) : 480 };
+	const auto height{ argc > 5 ? std::atoi(argv[5]) : 320 };
+
+	std::size_t section{};
+
+	while (section < trace.sectionNames.size() && trace.sectionNames[section] != sectionName)
+	{
+		++section;
+	}
+
+	if (section == trace.sectionNames.size())
+	{
+		throw std::runtime_error("No section \"" + sectionName + "\" in trace.");
+	}
+
+	if (width <= 0 || height <= 0)
+	{
+		throw std::runtime_error("Invalid image size.");
+	}
+
+	ut::TreeConfigNode config{ nullptr, sectionName };
+	ps::PingData pingData{ config };
+	ps::PingPlotter plotter{ config };
+
+	const auto start{ std::chrono::steady_clock::now() };
+
+	for (auto& record : trace.records)
+	{
+		if (record.section != section)
+		{
+			continue;
+		}
+
+		const auto result{ ps::ResultTrace::makeResult(record, start) };
+
+		if (record.kind == ps::ResultKind::PING)
+		{
+			pingData.insertPingResult(result);
+		}
+		else
+		{
+			pingData.insertTraceResult(result);
+		}
+	}
+
+	ps::SnapshotRenderer renderer;
+	const auto& png{ renderer.render(plotter, pingData, width, height, start + trace.duration()) };
+
+	ut::FileHandle file{ std::fopen(argv[3], "wb") };
+
+	if (file == nullptr || std::fwrite(png.data(), 1, png.size(), file.get()) != png.size())
+	{
+		throw std::runtime_error(std::string{ "Unable to write \"" } + argv[3] + "\".");
+	}
+
+	return 0;
+}
+catch (std::exception& e)
+{
+	std::fprintf(stderr, "Error: %s\n", e.what());
+	return 1;
+}
@@ -0,0 +1,102 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+// Minimal consumer of the shared stats segment published by pingstats.
+// Maps the segment once and then polls it without any system calls.
+//
+//   Windows: cl /std:c++latest /EHsc /I..\src stats_reader.cpp
+//   Linux:   g++ -std=c++17 -O2 -I../src stats_reader.cpp -o stats_reader -lrt
+
+#include "stats_segment.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+int main(int argc, char** argv) try
+{
+	const std::string name{ argc > 1 ? argv[1] : "pingstats-stats" };
+
+	pingstats::StatsSegmentReader reader{ name };
+
+	std::vector<pingstats::StatsSegmentSample> samples(16);
+
+	for (;;)
+	{
+		for (std::size_t i{}; i < reader.sectionCount(); ++i)
+		{
+			try
+			{
+				const auto summary{ reader.loadSummary(i) };
+
+				if (summary.name[0] == '\0')
+				{
+					continue;
+				}
+
+				const auto ip{ reinterpret_cast<const unsigned char*>(&summary.responderIpv4) };
+
+				std::printf("%-24s %3u.%3u.%3u.%3u | ping %7.2f ms | mean %7.2f ms"
+					" | jttr %6.2f ms | loss %6.2f %%\n",
+					summary.name, ip[0], ip[1], ip[2], ip[3],
+					summary.lastPing, summary.meanPing,
+					summary.jitter, summary.lossPercentage);
+
+				const auto n{ reader.loadRecentSamples(i, samples.data(), samples.size()) };
+
+				std::printf("%24s", "");
+
+				for (std::size_t j{}; j < n; ++j)
+				{
+					const auto& sample{ samples[j] };
+					const auto lost{ sample.errorCode != 0 || sample.statusCode != 0 };
+
+					if (lost)
+					{
+						std::printf("   lost");
+					}
+					else
+					{
+						std::printf(" %6.1f", sample.latencyNs / 1e6);
+					}
+				}
+
+				std::printf("\n");
+			}
+			catch (pingstats::StaleStatsSegmentError&)
+			{
+				// Readable again once a new writer takes the segment over.
+				std::printf("section %zu is stale\n", i);
+			}
+		}
+
+		std::printf("\n");
+		std::this_thread::sleep_for(std::chrono::seconds{ 1 });
+	}
+}
+catch (std::exception& e)
+{
+	std::fprintf(stderr, "Error: %s\n", e.what());
+	return 1;
+}
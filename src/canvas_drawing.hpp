@@ -26,18 +26,43 @@
 #include "utility/utility.hpp"
 #include "utility/tree_config.hpp"
 
+#if defined _WIN32
 #include "winapi/utility.hpp"
+#endif
 
+#include "canvas_kernels.hpp"
+#include "canvas_pool.hpp"
+#include "pixel_canvas.hpp"
 #include "utility.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 namespace pingstats // export
 {
 	using namespace utility::literals;
 
 	namespace ut = utility;
+
+	using pxindex = std::int32_t;
+
+#if defined _WIN32
 	namespace wa = winapi;
 
-	using pxindex = LONG;
+	// Rendering goes straight into the DIB section that gets blitted.
+	using Canvas = wa::MemoryCanvas;
+#else
+	using Canvas = PixelCanvas;
+#endif
+
+	using CanvasPool = BasicCanvasPool<Canvas>;
+
+	CanvasPool& canvasPool()
+	{
+		static CanvasPool pool;
+		return pool;
+	}
 
 	struct Rect
 	{
@@ -57,6 +82,8 @@ namespace pingstats // export
 		}
 	};
 
+	// 8 bits per channel, alpha is opacity. Canvas pixels are opaque; 
+	// alpha only matters to blendCanvasRect and blendCanvasMask.
 	struct Color
 	{
 		std::uint32_t value;
@@ -71,7 +98,7 @@ namespace pingstats // export
 			std::uint8_t r, 
 			std::uint8_t g, 
 			std::uint8_t b, 
-			std::uint8_t a = { 0 })
+			std::uint8_t a = { 255 })
 			: value{ 
 				(static_cast<std::uint32_t>(r) << 16) | 
 				(static_cast<std::uint32_t>(g) << 8) |
@@ -99,10 +126,27 @@ namespace pingstats // export
 			return static_cast<std::uint8_t>((value >> 24) & 0xFF);
 		}
 
+		constexpr Color withAlpha(std::uint8_t alpha) const
+		{
+			return Color{ r(), g(), b(), alpha };
+		}
+
+		// Channels scaled by alpha, the form the blend kernels take.
+		constexpr Color premultiplied() const
+		{
+			return Color{
+				static_cast<std::uint8_t>(kernels::multiply255(r(), a())),
+				static_cast<std::uint8_t>(kernels::multiply255(g(), a())),
+				static_cast<std::uint8_t>(kernels::multiply255(b(), a())),
+				a() };
+		}
+
+#if defined _WIN32
 		constexpr auto toColorRef() const
 		{
 			return RGB(r(), g(), b());
 		}
+#endif
 	};
 
 	struct Vertex
@@ -112,9 +156,10 @@ namespace pingstats // export
 		Color color;
 	};
 
-	constexpr Color mergeColors(Color c0, Color c1, double weight)
+	// Weight in 1/256, for callers that have it as an integer already.
+	constexpr Color mergeColors(Color c0, Color c1, std::uint32_t weight)
 	{
-		const auto w{ fastround<uintptr_t>(weight * 256.0) };
+		const auto w{ weight };
 		const auto rw{ 256 - w };
 
 		return Color{
@@ -123,6 +168,11 @@ namespace pingstats // export
 			static_cast<uint8_t>(((c0.b() * rw) >> 8) + ((c1.b() * w) >> 8)) };
 	}
 
+	constexpr Color mergeColors(Color c0, Color c1, double weight)
+	{
+		return mergeColors(c0, c1, fastround<std::uint32_t>(weight * 256.0));
+	}
+
 	//constexpr Color mergeColors(Color c0, Color c1, double weight)
 	//{
 	//	const auto w{ weight };
@@ -134,10 +184,19 @@ namespace pingstats // export
 	//		static_cast<std::uint8_t>(c0.b() * rw + c1.b() * w) };
 	//}
 
-	void resizeCanvasPredictive(wa::MemoryCanvas& canvas, LONG width, LONG height)
+	// Gives the canvas another size, with storage from the canvas pool.
+	void resizeCanvas(Canvas& canvas, pxindex width, pxindex height)
+	{
+		if (canvas.width() != width || canvas.height() != height)
+		{
+			canvasPool().resize(canvas, width, height);
+		}
+	}
+
+	void resizeCanvasPredictive(Canvas& canvas, pxindex width, pxindex height)
 	{
 		const auto roundUp{ [](auto x) { 
-			return static_cast<LONG>(~15 & (x + 16));
+			return static_cast<pxindex>(~15 & (x + 16));
 		} };
 
 		if (canvas.width() == 0 ||
@@ -145,22 +204,28 @@ namespace pingstats // export
 			canvas.width() > width * 5 / 4 ||
 			canvas.height() > height * 5 / 4)
 		{
-			canvas = wa::MemoryCanvas{ roundUp(width), roundUp(height) };
+			canvasPool().resize(canvas, roundUp(width), roundUp(height));
 		}
 		else if (canvas.width() < width || canvas.height() < height)
 		{
 			width = width * 5 / 4;
 			height = height * 5 / 4;
 
-			canvas = wa::MemoryCanvas{ roundUp(width), roundUp(height) };
+			canvasPool().resize(canvas, roundUp(width), roundUp(height));
 		}
 	}
 
-	void clearCanvas(wa::MemoryCanvas& canvas, Color color)
+	void clearCanvas(Canvas& canvas, Color color)
 	{
 		const auto ptr{ canvas.pixelPtr() };
 		const auto size{ canvas.size() };
 
+		if (4 * size > streamFillThreshold())
+		{
+			canvasKernels().streamFill(ptr, size, size, 1, color.value);
+			return;
+		}
+
 		// Generates rep stos, don't change to fill/fill_n.
 		for (std::size_t i{}; i < size; ++i)
 		{
@@ -168,7 +233,7 @@ namespace pingstats // export
 		}
 	}
 
-	void fillCanvasRect(wa::MemoryCanvas& canvas, const Rect& rect, Color color)
+	void fillCanvasRect(Canvas& canvas, const Rect& rect, Color color)
 	{
 		const auto ptr{ canvas.pixelPtr() };
 		const auto width{ static_cast<std::size_t>(rect.width()) };
@@ -176,7 +241,12 @@ namespace pingstats // export
 		const auto x{ static_cast<std::size_t>(rect.left) };
 		const auto y{ static_cast<std::size_t>(rect.top) };
 		const auto w{ static_cast<std::size_t>(canvas.width()) };
-		const auto h{ static_cast<std::size_t>(canvas.height()) };
+
+		if (4 * width * height > streamFillThreshold())
+		{
+			canvasKernels().streamFill(&ptr[x + y * w], w, width, height, color.value);
+			return;
+		}
 
 		for (std::size_t j{}; j < height; ++j)
 		{
@@ -190,15 +260,39 @@ namespace pingstats // export
 		}
 	}
 
-	void copyCanvasRect(wa::MemoryCanvas& dest, wa::MemoryCanvas& source,
+	// Composites color over the rect with its alpha.
+	void blendCanvasRect(Canvas& canvas, const Rect& rect, Color color)
+	{
+		const auto x{ static_cast<std::size_t>(rect.left) };
+		const auto y{ static_cast<std::size_t>(rect.top) };
+		const auto w{ static_cast<std::size_t>(canvas.width()) };
+
+		canvasKernels().blend(&canvas.pixelPtr()[x + y * w], w, 
+			static_cast<std::size_t>(rect.width()), static_cast<std::size_t>(rect.height()), 
+			color.premultiplied().value, nullptr, 0);
+	}
+
+	// Same, with the alpha of each pixel scaled by a coverage mask of 
+	// rect's size whose rows are maskStride bytes apart.
+	void blendCanvasMask(Canvas& canvas, const Rect& rect, Color color, 
+		const std::uint8_t* mask, std::size_t maskStride)
+	{
+		const auto x{ static_cast<std::size_t>(rect.left) };
+		const auto y{ static_cast<std::size_t>(rect.top) };
+		const auto w{ static_cast<std::size_t>(canvas.width()) };
+
+		canvasKernels().blend(&canvas.pixelPtr()[x + y * w], w, 
+			static_cast<std::size_t>(rect.width()), static_cast<std::size_t>(rect.height()), 
+			color.premultiplied().value, mask, maskStride);
+	}
+
+	void copyCanvasRect(Canvas& dest, Canvas& source,
 		const Rect& destRect, std::size_t sourceX, std::size_t sourceY)
 	{
 		const auto sptr{ source.pixelPtr() };
 		const auto dptr{ dest.pixelPtr() };
 		const auto width{ static_cast<std::size_t>(destRect.width()) };
 		const auto height{ static_cast<std::size_t>(destRect.height()) };
-		const auto sx{ sourceX };
-		const auto sy{ sourceY };
 		const auto dx{ static_cast<std::size_t>(destRect.left) };
 		const auto dy{ static_cast<std::size_t>(destRect.top) };
 		const auto sw{ static_cast<std::size_t>(source.width()) };
@@ -207,13 +301,28 @@ namespace pingstats // export
 		for (std::size_t j{}; j < height; ++j)
 		{
 			const auto dline{ &dptr[dx + (dy + j) * dw] };
-			const auto sline{ &sptr[sx + (sy + j) * sw] };
+			const auto sline{ &sptr[sourceX + (sourceY + j) * sw] };
 
 			std::memcpy(dline, sline, 4 * width);
 		}
 	}
 
-	void plot(wa::MemoryCanvas& canvas, const Rect& clip, 
+	// Moves the contents of rect left by distance pixels. The exposed strip
+	// at the right keeps its previous contents.
+	void scrollCanvasRectLeft(Canvas& canvas, const Rect& rect, pxindex distance)
+	{
+		const auto ptr{ canvas.pixelPtr() };
+		const auto w{ static_cast<std::size_t>(canvas.width()) };
+		const auto count{ static_cast<std::size_t>(rect.width() - distance) };
+
+		for (auto y{ rect.top }; y < rect.bottom; ++y)
+		{
+			const auto line{ &ptr[rect.left + y * w] };
+			std::memmove(line, line + distance, 4 * count);
+		}
+	}
+
+	void plot(Canvas& canvas, const Rect& clip, 
 		pxindex x, pxindex y, Color color, double weight)
 	{
 		if (x >= clip.left && 
@@ -225,7 +334,7 @@ namespace pingstats // export
 		}
 	}
 
-	void plot(wa::MemoryCanvas& canvas, 
+	void plot(Canvas& canvas, 
 		const Rect& clip, pxindex x, pxindex y, Color color)
 	{
 		if (x >= clip.left &&
@@ -237,7 +346,7 @@ namespace pingstats // export
 		}
 	}
 
-	void drawHorizontalLine(wa::MemoryCanvas& canvas, 
+	void drawHorizontalLine(Canvas& canvas, 
 		const Rect& clip, Color color, pxindex y, pxindex x0, pxindex x1)
 	{
 		if (y >= clip.top && y < clip.bottom)
@@ -264,7 +373,7 @@ namespace pingstats // export
 		}
 	}
 
-	void drawVerticalLine(wa::MemoryCanvas& canvas, 
+	void drawVerticalLine(Canvas& canvas, 
 		const Rect& clip, Color color, pxindex x, pxindex y0, pxindex y1)
 	{
 		if (x >= clip.left && x < clip.right)
@@ -291,87 +400,854 @@ namespace pingstats // export
 		}
 	}
 
-	template <unsigned THICKNESS>
-	bool drawPrettyLine(
-		wa::MemoryCanvas& canvas, 
-		const Rect& clip,
-		Color color, 
-		double x0, 
-		double y0, 
-		double x1, 
-		double y1,
-		bool prevSteep, 
-		bool isSteep, 
-		bool nextSteep, 
-		bool isFirst, 
-		bool isLast)
+	namespace raster
 	{
-		static_assert(THICKNESS <= 2, "Maximum thickness is 2.");
+		// Line rasterization works on 16.16 fixed point numbers, stored 
+		// in 64 bits so vertices far outside the canvas can't overflow.
+		using fixed = std::int64_t;
 
-		const auto fracpart{ [](double x) {
-			return x - static_cast<pxindex>(x);
-		} };
+		constexpr int FIXED_SHIFT{ 16 };
+		constexpr fixed FIXED_ONE{ fixed{ 1 } << FIXED_SHIFT };
+		constexpr fixed FIXED_HALF{ FIXED_ONE / 2 };
+
+		// Precision of the minor axis accumulator.
+		constexpr int PRECISE_SHIFT{ 32 };
+		constexpr fixed PRECISE_ONE{ fixed{ 1 } << PRECISE_SHIFT };
+		constexpr fixed PRECISE_HALF{ PRECISE_ONE / 2 };
+
+		constexpr fixed toFixed(double value)
+		{
+			return fastround<fixed>(value * FIXED_ONE);
+		}
+
+		constexpr pxindex floorToInt(fixed value)
+		{
+			// Arithmetic shift, rounds towards negative infinity.
+			return static_cast<pxindex>(value >> FIXED_SHIFT);
+		}
+
+		constexpr pxindex roundToInt(fixed value)
+		{
+			return floorToInt(value + FIXED_HALF);
+		}
+
+		constexpr fixed fraction(fixed value)
+		{
+			return value & (FIXED_ONE - 1);
+		}
+
+		constexpr fixed multiply(fixed a, fixed b)
+		{
+			return (a * b) >> FIXED_SHIFT;
+		}
+
+		constexpr fixed floorDiv(fixed a, fixed b)
+		{
+			return a / b - (a % b != 0 && (a < 0) != (b < 0));
+		}
+
+		constexpr fixed ceilDiv(fixed a, fixed b)
+		{
+			return a / b + (a % b != 0 && (a < 0) == (b < 0));
+		}
 
-		const auto drawEndpoint{ [=](
-			MemoryCanvas& canvas,
-			pxindex x,
-			double ry,
-			double xgap,
-			Color color)
+		// Same result as mergeColors with a weight of coverage / FIXED_ONE, 
+		// red and blue are blended together in one multiplication. The 
+		// result is opaque.
+		constexpr std::uint32_t blend(
+			std::uint32_t dest, std::uint32_t color, fixed coverage)
 		{
-			switch (THICKNESS)
+			const auto w{ static_cast<std::uint32_t>(
+				std::clamp<fixed>((coverage + 128) >> 8, 0, 256)) };
+			const auto rw{ 256 - w };
+
+			const auto rb{ 
+				((((dest & 0xFF00FF) * rw) >> 8) & 0xFF00FF) + 
+				((((color & 0xFF00FF) * w) >> 8) & 0xFF00FF) };
+
+			const auto g{ 
+				((((dest & 0x00FF00) * rw) >> 8) & 0x00FF00) + 
+				((((color & 0x00FF00) * w) >> 8) & 0x00FF00) };
+
+			return rb | g | 0xFF000000;
+		}
+
+		// Draws a line whose major axis is x. With STEEP set, x and y are
+		// swapped on the canvas. Only the columns inside the clip rect are
+		// visited, and only those whose pixels can cross the clip border
+		// are bounds checked.
+		template <unsigned THICKNESS, bool STEEP>
+		void drawLine(
+			Canvas& canvas, 
+			const Rect& clip, 
+			Color color,
+			fixed x0, 
+			fixed y0, 
+			fixed x1, 
+			fixed y1,
+			bool isStartTransparent, 
+			bool isEndTransparent,
+			bool isStartSolid, 
+			bool isEndSolid)
+		{
+			const auto majorMin{ STEEP ? clip.top : clip.left };
+			const auto majorMax{ STEEP ? clip.bottom : clip.right };
+			const auto minorMin{ STEEP ? clip.left : clip.top };
+			const auto minorMax{ STEEP ? clip.right : clip.bottom };
+
+			const auto ptr{ canvas.pixelPtr() };
+			const auto stride{ static_cast<std::ptrdiff_t>(canvas.width()) };
+
+			// Minor axis pixels of a column relative to its base row,
+			// which is ry rounded (or floored for THICKNESS 1).
+			constexpr pxindex lowOffset{ THICKNESS == 2 ? -1 : 0 };
+			constexpr pxindex highOffset{ THICKNESS == 0 ? 0 : 1 };
+			constexpr fixed baseBias{ THICKNESS == 1 ? 0 : PRECISE_HALF };
+
+			const auto plot{ [=](pxindex major, pxindex minor, fixed coverage) {
+				auto& pixel{ STEEP ? 
+					ptr[minor + major * stride] : 
+					ptr[major + minor * stride] };
+
+				pixel = blend(pixel, color.value, coverage);
+			} };
+
+			const auto plotChecked{ [=](pxindex major, pxindex minor, fixed coverage) {
+				if (major >= majorMin && major < majorMax && 
+					minor >= minorMin && minor < minorMax)
+				{
+					plot(major, minor, coverage);
+				}
+			} };
+
+			// ry is stepped with 32 fractional bits, otherwise the error of a
+			// 16 bit gradient adds up to visible differences on long lines.
+			const auto drawColumn{ [=](auto& plot, pxindex x, fixed ry, fixed coverage) {
+				const auto y{ static_cast<pxindex>((ry + baseBias) >> PRECISE_SHIFT) };
+
+				switch (THICKNESS)
+				{
+				default:
+				{
+					plot(x, y, coverage);
+				}	break;
+
+				case 1:
+				{
+					const auto weight{ fraction(ry >> FIXED_SHIFT) };
+					plot(x, y + 0, multiply(coverage, FIXED_ONE - weight));
+					plot(x, y + 1, multiply(coverage, weight));
+				}	break;
+
+				case 2:
+				{
+					const auto weight{ fraction((ry + PRECISE_HALF) >> FIXED_SHIFT) };
+					plot(x, y - 1, multiply(coverage, FIXED_ONE - weight));
+					plot(x, y + 0, coverage);
+					plot(x, y + 1, multiply(coverage, weight));
+				}	break;
+				}
+			} };
+
+			const auto gradient{ x1 == x0 ? fixed{} : fastround<fixed>(
+				static_cast<double>(y1 - y0) / (x1 - x0) * PRECISE_ONE) };
+
+			const auto xstart{ roundToInt(x0) };
+			const auto ystart{ y0 * FIXED_ONE + 
+				((gradient * (xstart * FIXED_ONE - x0)) >> FIXED_SHIFT) };
+			const auto xend{ roundToInt(x1) };
+			const auto yend{ y1 * FIXED_ONE + 
+				((gradient * (xend * FIXED_ONE - x1)) >> FIXED_SHIFT) };
+
+			if (isStartTransparent)
 			{
-			default:
+				drawColumn(plotChecked, xstart, ystart, 
+					FIXED_ONE - fraction(x0 + FIXED_HALF));
+			}
+
+			if (isEndTransparent)
+			{
+				drawColumn(plotChecked, xend, yend, fraction(x1 + FIXED_HALF));
+			}
+
+			const auto itstart{ xstart + !isStartSolid };
+			const auto itend{ xend + isEndSolid };
+			const auto first{ std::max(itstart, majorMin) };
+			const auto last{ std::min(itend, majorMax) };
+
+			if (first >= last)
 			{
-				const auto y{ fastround<pxindex>(ry) };
+				return;
+			}
+
+			auto ry{ ystart + (first - itstart + !isStartSolid) * gradient };
+
+			// Columns [first + kmin, first + kmax] lie entirely inside
+			// the minor axis range of the clip rect.
+			const auto lowest{ (minorMin - lowOffset) * PRECISE_ONE - baseBias };
+			const auto highest{ (minorMax - highOffset) * PRECISE_ONE - baseBias - 1 };
+			const fixed count{ last - first };
+
+			const auto ryLast{ ry + (count - 1) * gradient };
+
+			auto kmin{ count };
+			auto kmax{ fixed{ -1 } };
 
-				if (!isSteep)
+			if (std::min(ry, ryLast) >= lowest && std::max(ry, ryLast) <= highest)
+			{
+				// The common case, no need to divide.
+				kmin = 0;
+				kmax = count - 1;
+			}
+			else if (gradient > 0)
+			{
+				kmin = ceilDiv(lowest - ry, gradient);
+				kmax = floorDiv(highest - ry, gradient);
+			}
+			else if (gradient < 0)
+			{
+				kmin = ceilDiv(highest - ry, gradient);
+				kmax = floorDiv(lowest - ry, gradient);
+			}
+
+			kmin = std::max<fixed>(kmin, 0);
+			kmax = std::min<fixed>(kmax, count - 1);
+
+			const auto safeBegin{ kmin <= kmax ? first + static_cast<pxindex>(kmin) : last };
+			const auto safeEnd{ kmin <= kmax ? first + static_cast<pxindex>(kmax) + 1 : last };
+
+			auto x{ first };
+
+			for (; x < safeBegin; ++x, ry += gradient)
+			{
+				drawColumn(plotChecked, x, ry, FIXED_ONE);
+			}
+
+			for (; x < safeEnd; ++x, ry += gradient)
+			{
+				drawColumn(plot, x, ry, FIXED_ONE);
+			}
+
+			for (; x < last; ++x, ry += gradient)
+			{
+				drawColumn(plotChecked, x, ry, FIXED_ONE);
+			}
+		}
+
+		constexpr pxindex floorToPixel(double value)
+		{
+			const auto i{ static_cast<pxindex>(value) };
+			return i - (value < i);
+		}
+
+		constexpr pxindex ceilToPixel(double value)
+		{
+			const auto i{ static_cast<pxindex>(value) };
+			return i + (value > i);
+		}
+
+		// A segment of a thick polyline, with what its row spans and pixel 
+		// distances need set up once. The round cap at its end is left to 
+		// the next segment, which starts with the same one, so only the 
+		// last segment has both.
+		struct ThickSegment
+		{
+			double x0;
+			double y0;
+
+			// Unit direction and length, a point has any direction.
+			double ux;
+			double uy;
+			double length;
+
+			// Scales how far a pixel projects beyond the end; without the 
+			// end cap that puts all of them out of reach.
+			double endScale;
+
+			// The columns and rows a pixel within reach can be in, clipped.
+			pxindex columnMin;
+			pxindex columnMax;
+
+			pxindex top;
+			pxindex bottom;
+			std::uint32_t index;
+
+			// Chunks of four columns any row's pixels fall into at most.
+			pxindex chunksPerRow;
+
+			// The band within radius of the centre line, relative to
+			// column origin, of the next row. Stepped with 32 fractional
+			// bits like the minor axis of drawLine, so rows are spanned
+			// with integers only.
+			pxindex origin;
+			fixed centre;
+			fixed centreStep;
+			fixed halfWidth;
+
+			ThickSegment(const Vertex& v0, const Vertex& v1, double radius, 
+				const Rect& clip, std::uint32_t index, bool hasEndCap)
+				: x0{ v0.x }
+				, y0{ v0.y }
+				, ux{ 1.0 }
+				, uy{ 0.0 }
+				, length{ std::sqrt((v1.x - v0.x) * (v1.x - v0.x) + (v1.y - v0.y) * (v1.y - v0.y)) }
+				, endScale{ hasEndCap ? 1.0 : 1e9 }
+				, columnMin{}
+				, columnMax{}
+				, top{}
+				, bottom{}
+				, index{ index }
+				, chunksPerRow{}
+				, origin{ floorToPixel(v0.x) }
+				, centre{}
+				, centreStep{}
+				, halfWidth{}
+			{
+				const auto dx{ v1.x - v0.x };
+				const auto dy{ v1.y - v0.y };
+
+				if (length > 0.0)
 				{
-					plot(canvas, clip, x, y, color, xgap);
+					ux = dx / length;
+					uy = dy / length;
 				}
-				else
+
+				// Within radius of the start, and of the body, which ends
+				// square unless there's an end cap.
+				const auto columnReach{ hasEndCap ? radius : radius * std::abs(uy) };
+				const auto rowReach{ hasEndCap ? radius : radius * std::abs(ux) };
+
+				columnMin = std::max(clip.left, ceilToPixel(std::min(v0.x - radius, v1.x - columnReach)));
+				columnMax = std::min(clip.right - 1, floorToPixel(std::max(v0.x + radius, v1.x + columnReach)));
+				top = std::max(clip.top, ceilToPixel(std::min(v0.y - radius, v1.y - rowReach)));
+				bottom = std::min(clip.bottom - 1, floorToPixel(std::max(v0.y + radius, v1.y + rowReach)));
+
+				// A level segment's band is its x extent in every row, as
+				// is a nearly level one's, whose band would move too far
+				// per row to step.
+				auto bandSlope{ 0.0 };
+				auto bandHalfWidth{ radius + std::abs(dx) };
+
+				if (std::abs(dy) * 65536.0 > std::abs(dx))
 				{
-					plot(canvas, clip, y, x, color, xgap);
+					bandSlope = dx / dy;
+					bandHalfWidth = radius * length / std::abs(dy);
 				}
-			}	break;
 
-			case 1:
+				centre = fastround<fixed>((x0 - origin + (top - y0) * bandSlope) * PRECISE_ONE);
+				centreStep = fastround<fixed>(bandSlope * PRECISE_ONE);
+				halfWidth = fastround<fixed>(bandHalfWidth * PRECISE_ONE);
+
+				const auto pixels{ std::min(static_cast<double>(columnMax - columnMin), 
+					2.0 * bandHalfWidth) + 1.0 };
+				chunksPerRow = static_cast<pxindex>(pixels + 6.0) / 4;
+			}
+
+			bool visible() const
+			{
+				return top <= bottom && columnMin <= columnMax;
+			}
+
+			// Pixels [first, last] of the next row that may be closer than
+			// radius, empty if first > last.
+			void nextSpan(pxindex& first, pxindex& last)
 			{
-				const auto y{ static_cast<pxindex>(ry) };
-				const auto weight{ fracpart(ry) };
+				first = std::max(columnMin, origin + static_cast<pxindex>(
+					(centre - halfWidth + PRECISE_ONE - 1) >> PRECISE_SHIFT));
+				last = std::min(columnMax, origin + static_cast<pxindex>(
+					(centre + halfWidth) >> PRECISE_SHIFT));
+
+				centre += centreStep;
+			}
+		};
 
-				if (!isSteep)
+		constexpr int INDEX_BITS{ 22 };
+
+		// Blend weight, 0 to 256, of a pixel at distance from a line.
+		constexpr std::int32_t thickLineWeight(double radius, double distance)
+		{
+			return std::clamp(fastround<std::int32_t>((radius - distance) * 256.0), 0, 256);
+		}
+
+		// Blends a covered pixel with the colour of its segment.
+		void blendThickPixel(std::uint32_t& pixel, std::int32_t& best, const Vertex* vertices)
+		{
+			const auto weight{ best >> INDEX_BITS };
+
+			if (weight != 0)
+			{
+				pixel = blend(pixel, vertices[(best & ((1 << INDEX_BITS) - 1)) + 1].color.value, 
+					fixed{ weight } << 8);
+			}
+
+			best = 0;
+		}
+
+		// Sets the bits of chunks [first, last].
+		void markThickChunks(std::uint64_t* chunks, pxindex first, pxindex last)
+		{
+			for (auto word{ first >> 6 }; word <= last >> 6; ++word)
+			{
+				const auto from{ std::max(first, word * 64) & 63 };
+				const auto to{ std::min(last, word * 64 + 63) & 63 };
+
+				chunks[word] |= (~std::uint64_t{} >> (63 - to)) & (~std::uint64_t{} << from);
+			}
+		}
+
+#if defined _M_X64 || defined __x86_64__
+		inline int lowestBit(std::uint64_t bits)
+		{
+#if defined _MSC_VER
+			unsigned long index;
+			_BitScanForward64(&index, bits);
+			return static_cast<int>(index);
+#else
+			return __builtin_ctzll(bits);
+#endif
+		}
+
+		// Covers the rows of a segment one after another, four columns at
+		// a time. The distance of a pixel is to where it projects onto the
+		// segment, pushed out by how far that falls beyond either end.
+		// Along a row all of it is linear, in four lanes of floats it needs
+		// no branches at all.
+		class ThickRowCover
+		{
+		public:
+			ThickRowCover(ThickSegment& segment, double radius)
+				: _segment{ &segment }
+				, _laneAlong{ _mm_mul_ps(LANES, _mm_set1_ps(static_cast<float>(segment.ux))) }
+				, _laneAcross{ _mm_mul_ps(LANES, _mm_set1_ps(static_cast<float>(segment.uy))) }
+				, _stepAlong{ _mm_set1_ps(static_cast<float>(4.0 * segment.ux)) }
+				, _stepAcross{ _mm_set1_ps(static_cast<float>(4.0 * segment.uy)) }
+				, _far{ _mm_set1_ps(static_cast<float>(radius + 1.0)) }
+				, _endScale{ _mm_set1_ps(static_cast<float>(segment.endScale)) }
+				, _reach{ _mm_set1_ps(static_cast<float>(radius * 256.0 + 0.5)) }
+				, _index{ _mm_set1_epi32(static_cast<std::int32_t>(segment.index)) }
+				, _ends{}
+				, _across{}
+				, _endsPerRow{ _mm_setr_pd(-segment.uy, segment.uy) }
+				, _endsPerColumn{ _mm_setr_pd(-segment.ux, segment.ux) }
+				, _acrossPerRow{ _mm_set1_pd(-segment.ux) }
+				, _acrossPerColumn{ _mm_set1_pd(segment.uy) }
+			{
+				const auto px{ -segment.x0 };
+				const auto py{ segment.top - segment.y0 };
+				const auto along{ px * segment.ux + py * segment.uy };
+
+				_ends = _mm_setr_pd(-along, along - segment.length);
+				_across = _mm_set1_pd(px * segment.uy - py * segment.ux);
+			}
+
+			pxindex bottom() const
+			{
+				return _segment->bottom;
+			}
+
+			// Covers the next row. Row holds the coverage of the columns
+			// from base, which is a multiple of four, chunks has a bit for
+			// each four of them. Both have room for chunksPerRow past the
+			// last column.
+			void operator()(std::int32_t* row, std::uint64_t* chunks, pxindex base)
+			{
+				auto& s{ *_segment };
+
+				pxindex first, last;
+				s.nextSpan(first, last);
+
+				const auto ends{ _ends };
+				const auto acrossRow{ _across };
+
+				_ends = _mm_add_pd(_ends, _endsPerRow);
+				_across = _mm_add_pd(_across, _acrossPerRow);
+
+				if (first > last)
 				{
-					plot(canvas, clip, x, y + 0, color, xgap * (1.0 - weight));
-					plot(canvas, clip, x, y + 1, color, xgap * weight);
+					return;
 				}
-				else
+
+				// The same number of chunks every row, so the loop is 
+				// predictable. What's outside the span isn't covered.
+				const auto chunkFirst{ (first - base) >> 2 };
+				const auto chunkEnd{ chunkFirst + s.chunksPerRow };
+
+				// Each end measured from itself in doubles, so floats stay
+				// precise there.
+				const auto column{ _mm_cvtepi32_pd(_mm_set1_epi32(base + chunkFirst * 4)) };
+				const auto endsAt{ _mm_cvtpd_ps(_mm_add_pd(ends, _mm_mul_pd(column, _endsPerColumn))) };
+				const auto acrossAt{ _mm_cvtpd_ps(_mm_add_pd(acrossRow, _mm_mul_pd(column, _acrossPerColumn))) };
+
+				auto before{ _mm_sub_ps(_mm_shuffle_ps(endsAt, endsAt, 0x00), _laneAlong) };
+				auto after{ _mm_add_ps(_mm_shuffle_ps(endsAt, endsAt, 0x55), _laneAlong) };
+				auto across{ _mm_add_ps(_mm_shuffle_ps(acrossAt, acrossAt, 0x00), _laneAcross) };
+
+				auto columns{ _mm_add_epi32(_mm_set1_epi32(base + chunkFirst * 4), _mm_setr_epi32(0, 1, 2, 3)) };
+				const auto low{ _mm_set1_epi32(first - 1) };
+				const auto high{ _mm_set1_epi32(last + 1) };
+
+				const auto zero{ _mm_setzero_ps() };
+				const auto full{ _mm_set1_ps(256.0f) };
+
+				for (auto chunk{ chunkFirst }; chunk < chunkEnd; ++chunk)
 				{
-					plot(canvas, clip, y + 0, x, color, xgap * (1.0 - weight));
-					plot(canvas, clip, y + 1, x, color, xgap * weight);
+					const auto beyond{ _mm_add_ps(_mm_max_ps(before, zero), 
+						_mm_min_ps(_mm_mul_ps(_mm_max_ps(after, zero), _endScale), _far)) };
+					const auto distance{ _mm_sqrt_ps(_mm_add_ps(
+						_mm_mul_ps(across, across), _mm_mul_ps(beyond, beyond))) };
+					const auto weight{ _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(
+						_mm_sub_ps(_reach, _mm_mul_ps(distance, full)), zero), full)) };
+
+					// Lanes outside the span stay zero, which leaves them be.
+					const auto covered{ _mm_and_si128(_mm_cmpgt_epi32(weight, _mm_setzero_si128()), 
+						_mm_and_si128(_mm_cmpgt_epi32(columns, low), _mm_cmplt_epi32(columns, high))) };
+					const auto value{ _mm_and_si128(covered, 
+						_mm_or_si128(_mm_slli_epi32(weight, INDEX_BITS), _index)) };
+
+					const auto p{ reinterpret_cast<__m128i*>(row + chunk * 4) };
+					const auto old{ _mm_loadu_si128(p) };
+					const auto greater{ _mm_cmpgt_epi32(value, old) };
+
+					_mm_storeu_si128(p, _mm_or_si128(
+						_mm_and_si128(greater, value), _mm_andnot_si128(greater, old)));
+
+					before = _mm_sub_ps(before, _stepAlong);
+					after = _mm_add_ps(after, _stepAlong);
+					across = _mm_add_ps(across, _stepAcross);
+					columns = _mm_add_epi32(columns, _mm_set1_epi32(4));
 				}
-			}	break;
 
-			case 2:
+				markThickChunks(chunks, (first - base) >> 2, (last - base) >> 2);
+			}
+
+		private:
+			inline static const __m128 LANES{ _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f) };
+
+			ThickSegment* _segment;
+
+			__m128 _laneAlong;
+			__m128 _laneAcross;
+			__m128 _stepAlong;
+			__m128 _stepAcross;
+			__m128 _far;
+			__m128 _endScale;
+			__m128 _reach;
+			__m128i _index;
+
+			// Both ends and the distance across of column 0 of the next
+			// row, and how they change per row and column.
+			__m128d _ends;
+			__m128d _across;
+			__m128d _endsPerRow;
+			__m128d _endsPerColumn;
+			__m128d _acrossPerRow;
+			__m128d _acrossPerColumn;
+		};
+
+		// Blends four covered pixels with the colours of their segments, 
+		// to the bit what blend does, and clears their coverage.
+		void blendThickChunk(std::uint32_t* pixels, std::int32_t* coverage, const Vertex* vertices)
+		{
+			const auto zero{ _mm_setzero_si128() };
+
+			const auto best{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(coverage)) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(coverage), zero);
+
+			alignas(16) std::int32_t indices[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(indices), 
+				_mm_and_si128(best, _mm_set1_epi32((1 << INDEX_BITS) - 1)));
+
+			const auto colors{ _mm_setr_epi32(
+				static_cast<std::int32_t>(vertices[indices[0] + 1].color.value),
+				static_cast<std::int32_t>(vertices[indices[1] + 1].color.value),
+				static_cast<std::int32_t>(vertices[indices[2] + 1].color.value),
+				static_cast<std::int32_t>(vertices[indices[3] + 1].color.value)) };
+
+			// Every channel of a pixel gets its weight, in 16 bits.
+			const auto weight{ _mm_srli_epi32(best, INDEX_BITS) };
+			const auto pairs{ _mm_or_si128(weight, _mm_slli_epi32(weight, 16)) };
+			const auto weightLo{ _mm_unpacklo_epi32(pairs, pairs) };
+			const auto weightHi{ _mm_unpackhi_epi32(pairs, pairs) };
+			const auto inverseLo{ _mm_sub_epi16(_mm_set1_epi16(256), weightLo) };
+			const auto inverseHi{ _mm_sub_epi16(_mm_set1_epi16(256), weightHi) };
+
+			const auto dest{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels)) };
+
+			const auto lo{ _mm_add_epi16(
+				_mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(dest, zero), inverseLo), 8),
+				_mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(colors, zero), weightLo), 8)) };
+			const auto hi{ _mm_add_epi16(
+				_mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dest, zero), inverseHi), 8),
+				_mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(colors, zero), weightHi), 8)) };
+
+			const auto blended{ _mm_or_si128(_mm_packus_epi16(lo, hi), 
+				_mm_set1_epi32(static_cast<std::int32_t>(0xFF000000))) };
+
+			// Uncovered pixels are left as they are.
+			const auto uncovered{ _mm_cmpeq_epi32(weight, zero) };
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels), _mm_or_si128(
+				_mm_and_si128(uncovered, dest), _mm_andnot_si128(uncovered, blended)));
+		}
+#else
+		inline int lowestBit(std::uint64_t bits)
+		{
+			auto index{ 0 };
+
+			for (; (bits & 1) == 0; bits >>= 1)
 			{
-				const auto y{ fastround<pxindex>(ry) };
-				const auto weight{ fracpart(ry + 0.5) };
+				++index;
+			}
 
-				if (!isSteep)
+			return index;
+		}
+
+		class ThickRowCover
+		{
+		public:
+			ThickRowCover(ThickSegment& segment, double radius)
+				: _segment{ &segment }
+				, _radius{ radius }
+				, _y{ segment.top }
+			{}
+
+			pxindex bottom() const
+			{
+				return _segment->bottom;
+			}
+
+			void operator()(std::int32_t* row, std::uint64_t* chunks, pxindex base)
+			{
+				auto& s{ *_segment };
+
+				pxindex first, last;
+				s.nextSpan(first, last);
+
+				const auto py{ _y++ - s.y0 };
+
+				if (first > last)
 				{
-					plot(canvas, clip, x, y - 1, color, xgap * (1.0 - weight));
-					plot(canvas, clip, x, y + 0, color, xgap);
-					plot(canvas, clip, x, y + 1, color, xgap * weight);
+					return;
 				}
-				else
+
+				for (auto x{ first }; x <= last; ++x)
 				{
-					plot(canvas, clip, y - 1, x, color, xgap * (1.0 - weight));
-					plot(canvas, clip, y + 0, x, color, xgap);
-					plot(canvas, clip, y + 1, x, color, xgap * weight);
+					const auto px{ x - s.x0 };
+					const auto along{ px * s.ux + py * s.uy };
+					const auto across{ px * s.uy - py * s.ux };
+					const auto beyond{ std::max(-along, 0.0) + std::min(
+						std::max(along - s.length, 0.0) * s.endScale, _radius + 1.0) };
+
+					const auto weight{ thickLineWeight(_radius, 
+						std::sqrt(across * across + beyond * beyond)) };
+
+					if (weight > 0)
+					{
+						auto& best{ row[x - base] };
+						best = std::max(best, weight << INDEX_BITS | static_cast<std::int32_t>(s.index));
+					}
 				}
-			}	break;
+
+				markThickChunks(chunks, (first - base) >> 2, (last - base) >> 2);
 			}
-		} };
+
+		private:
+			ThickSegment* _segment;
+			double _radius;
+			pxindex _y;
+		};
+
+		void blendThickChunk(std::uint32_t* pixels, std::int32_t* coverage, const Vertex* vertices)
+		{
+			for (auto i{ 0 }; i < 4; ++i)
+			{
+				blendThickPixel(pixels[i], coverage[i], vertices);
+			}
+		}
+#endif
+
+		// Reused between calls, so drawing doesn't allocate.
+		struct ThickLineScratch
+		{
+			std::vector<ThickSegment> segments;
+			std::vector<ThickSegment*> order;
+			std::vector<ThickRowCover> active;
+
+			// Per pixel of the row being swept, the best coverage so far
+			// (0 to 256) in the high bits and the index of the segment 
+			// that has it in the low INDEX_BITS. Zero between rows.
+			std::vector<std::int32_t> coverage;
+
+			// A bit for each chunk of four columns of the row that was
+			// covered. Zero between rows.
+			std::vector<std::uint64_t> chunks;
+		};
+
+		// Coverage of each pixel is radius minus its centre's distance to 
+		// the nearest segment, clamped to [0, 1]. Rows are swept top to
+		// bottom: every segment that reaches a row steps its span there
+		// and covers it, then the row is blended once, so a pixel keeps
+		// the highest coverage of any segment and joins come out round
+		// without the overlap being blended twice. Coverage is kept and
+		// blended in chunks of four columns.
+		void drawThickLineRun(
+			ThickLineScratch& scratch,
+			Canvas& canvas, 
+			const Rect& clip, 
+			double radius,
+			const Vertex* vertices, 
+			std::size_t nVertices)
+		{
+			auto& segments{ scratch.segments };
+			auto& order{ scratch.order };
+			auto& active{ scratch.active };
+			auto& coverage{ scratch.coverage };
+			auto& chunks{ scratch.chunks };
+
+			// Chunks line up with the canvas, columns [base, base + pitch).
+			const auto base{ clip.left - (clip.left & 3) };
+			const auto pitch{ (clip.right - base + 3) & ~3 };
+			const auto chunkWords{ static_cast<std::size_t>(pitch / 4 + 63) / 64 };
+
+			// Rows are covered a fixed number of chunks at a time, which
+			// may run past the last one.
+			pxindex slack{};
+
+			segments.clear();
+			active.clear();
+
+			for (std::size_t i{}; i + 1 < nVertices; ++i)
+			{
+				const ThickSegment segment{ vertices[i], vertices[i + 1], radius, 
+					clip, static_cast<std::uint32_t>(i), i + 2 == nVertices };
+
+				if (segment.visible())
+				{
+					segments.push_back(segment);
+					slack = std::max(slack, segment.chunksPerRow * 4);
+				}
+			}
+
+			coverage.resize(static_cast<std::size_t>(pitch + slack));
+			chunks.resize(chunkWords);
+
+			order.clear();
+
+			for (auto& segment : segments)
+			{
+				order.push_back(&segment);
+			}
+
+			std::sort(order.begin(), order.end(), 
+				[](const ThickSegment* a, const ThickSegment* b) { return a->top < b->top; });
+
+			const auto ptr{ canvas.pixelPtr() };
+			const auto canvasWidth{ static_cast<pxindex>(canvas.width()) };
+			const auto stride{ static_cast<std::ptrdiff_t>(canvas.width()) };
+
+			auto next{ order.begin() };
+			auto y{ order.empty() ? clip.bottom : order.front()->top };
+
+			for (; y < clip.bottom && (next != order.end() || !active.empty()); ++y)
+			{
+				if (active.empty() && (*next)->top > y)
+				{
+					y = (*next)->top;
+				}
+
+				for (; next != order.end() && (*next)->top == y; ++next)
+				{
+					active.emplace_back(**next, radius);
+				}
+
+				for (std::size_t i{}; i < active.size(); )
+				{
+					active[i](coverage.data(), chunks.data(), base);
+
+					if (active[i].bottom() == y)
+					{
+						active[i] = active.back();
+						active.pop_back();
+					}
+					else
+					{
+						++i;
+					}
+				}
+
+				// Every chunk once, however many segments covered it.
+				const auto line{ ptr + y * stride };
+
+				for (std::size_t w{}; w < chunkWords; ++w)
+				{
+					for (auto bits{ chunks[w] }; bits != 0; bits &= bits - 1)
+					{
+						const auto offset{ static_cast<pxindex>(w * 64 + lowestBit(bits)) * 4 };
+						const auto x{ base + offset };
+
+						if (x >= 0 && x + 4 <= canvasWidth)
+						{
+							blendThickChunk(line + x, coverage.data() + offset, vertices);
+						}
+						else
+						{
+							for (auto i{ 0 }; i < 4; ++i)
+							{
+								if (x + i >= clip.left && x + i < clip.right)
+								{
+									blendThickPixel(line[x + i], coverage[offset + i], vertices);
+								}
+							}
+						}
+					}
+
+					chunks[w] = 0;
+				}
+			}
+		}
+
+		void drawThickLines(
+			Canvas& canvas, 
+			const Rect& clip, 
+			double thickness,
+			const Vertex* vertices, 
+			std::size_t nVertices)
+		{
+			static thread_local ThickLineScratch scratch;
+
+			constexpr std::size_t RUN_SEGMENTS{ std::size_t{ 1 } << INDEX_BITS };
+
+			if (clip.left >= clip.right || clip.top >= clip.bottom)
+			{
+				return;
+			}
+
+			// Segment indices have to fit next to the coverage, longer 
+			// lines are drawn in runs that share a vertex.
+			for (std::size_t i{}; i + 1 < nVertices; i += RUN_SEGMENTS)
+			{
+				drawThickLineRun(scratch, canvas, clip, thickness / 2.0 + 0.5, 
+					vertices + i, std::min(nVertices - i, RUN_SEGMENTS + 1));
+			}
+		}
+	}
+
+	template <unsigned THICKNESS>
+	bool drawPrettyLine(
+		Canvas& canvas, 
+		const Rect& clip,
+		Color color, 
+		double x0, 
+		double y0, 
+		double x1, 
+		double y1,
+		bool prevSteep, 
+		bool isSteep, 
+		bool nextSteep, 
+		bool isFirst, 
+		bool isLast)
+	{
+		static_assert(THICKNESS <= 2, "Maximum thickness is 2.");
 
 		if (isSteep)
 		{
@@ -398,97 +1274,27 @@ namespace pingstats // export
 			std::swap(isStartSolid, isEndSolid);
 		}
 
-		const auto gradient{ (y1 - y0) / (x1 - x0) };
-		const auto xstart{ fastround<pxindex>(x0) };
-		const auto ystart{ y0 + gradient * (xstart - x0) };
-		const auto xend{ fastround<pxindex>(x1) };
-		const auto yend{ y1 + gradient * (xend - x1) };
-
-		if (isStartTransparent)
-		{
-			drawEndpoint(
-				canvas, 
-				xstart, 
-				ystart, 
-				1.0 - fracpart(x0 + 0.5), 
-				color);
-		}
+		const auto fx0{ raster::toFixed(x0) };
+		const auto fy0{ raster::toFixed(y0) };
+		const auto fx1{ raster::toFixed(x1) };
+		const auto fy1{ raster::toFixed(y1) };
 
-		if (isEndTransparent)
-		{
-			drawEndpoint(canvas, xend, yend, fracpart(x1 + 0.5), color);
-		}
-
-		const auto itstart{ xstart + !isStartSolid };
-		const auto itend{ xend + isEndSolid };
-		auto ry{ ystart + !isStartSolid * gradient };
-
-		if (!isSteep)
+		if (isSteep)
 		{
-			for (auto x{ itstart }; x < itend; ++x, ry += gradient)
-			{
-				switch (THICKNESS)
-				{
-				default:
-				{
-					plot(canvas, clip, x, fastround<pxindex>(ry), color, 1);
-				}	break;
-
-				case 1:
-				{
-					const auto y{ static_cast<pxindex>(ry) };
-					const auto weight{ fracpart(ry) };
-					plot(canvas, clip, x, y - 0, color, 1 - weight);
-					plot(canvas, clip, x, y + 1, color, weight);
-				}	break;
-
-				case 2:
-				{
-					const auto y{ fastround<pxindex>(ry) };
-					const auto weight{ fracpart(ry + 0.5) };
-					plot(canvas, clip, x, y - 1, color, 1 - weight);
-					plot(canvas, clip, x, y + 0, color, 1);
-					plot(canvas, clip, x, y + 1, color, weight);
-				}	break;
-				}
-			}
+			raster::drawLine<THICKNESS, true>(canvas, clip, color, fx0, fy0, fx1, fy1,
+				isStartTransparent, isEndTransparent, isStartSolid, isEndSolid);
 		}
 		else
 		{
-			for (auto x{ itstart }; x < itend; ++x, ry += gradient)
-			{
-				switch (THICKNESS)
-				{
-				default:
-				{
-					plot(canvas, clip, fastround<pxindex>(ry), x, color, 1);
-				}	break;
-
-				case 1:
-				{
-					const auto y{ static_cast<pxindex>(ry) };
-					const auto weight{ fracpart(ry) };
-					plot(canvas, clip, y - 0, x, color, 1 - weight);
-					plot(canvas, clip, y + 1, x, color, weight);
-				}	break;
-
-				case 2:
-				{
-					const auto y{ fastround<pxindex>(ry) };
-					const auto weight{ fracpart(ry + 0.5) };
-					plot(canvas, clip, y - 1, x, color, 1 - weight);
-					plot(canvas, clip, y + 0, x, color, 1);
-					plot(canvas, clip, y + 1, x, color, weight);
-				}	break;
-				}
-			}
+			raster::drawLine<THICKNESS, false>(canvas, clip, color, fx0, fy0, fx1, fy1,
+				isStartTransparent, isEndTransparent, isStartSolid, isEndSolid);
 		}
 
 		return isSteep;
 	}
 
 	template <unsigned THICKNESS>
-	void drawPrettyLines(wa::MemoryCanvas& canvas, 
+	void drawPrettyLines(Canvas& canvas, 
 		const Rect& clip, const Vertex* vertices, std::size_t nVertices)
 	{
 		if (nVertices >= 2)
@@ -519,7 +1325,7 @@ namespace pingstats // export
 	}
 
 	void drawSawLines(
-		wa::MemoryCanvas& canvas, const Rect& clip, 
+		Canvas& canvas, const Rect& clip, 
 		const Vertex* vertices, std::size_t nVertices)
 	{
 		for (size_t i = 0; i + 1 < nVertices; ++i)
@@ -537,9 +1343,15 @@ namespace pingstats // export
 	}
 
 	void drawPrettyLines(
-		wa::MemoryCanvas& canvas, const Rect& clip, int thickness, 
+		Canvas& canvas, const Rect& clip, int thickness, 
 		const Vertex* vertices, std::size_t nVertices)
 	{
+		if (thickness > 2)
+		{
+			raster::drawThickLines(canvas, clip, thickness, vertices, nVertices);
+			return;
+		}
+
 		switch (thickness)
 		{
 		default:
@@ -572,14 +1384,15 @@ namespace utility
 	{
 		static bool loadValue(pingstats::Color& var, const std::string& value)
 		{
-			unsigned r, g, b;
+			unsigned r, g, b, a{ 255 };
 
-			if (std::sscanf(value.c_str(), "%u,%u,%u", &r, &g, &b) == 3)
+			if (std::sscanf(value.c_str(), "%u,%u,%u,%u", &r, &g, &b, &a) >= 3)
 			{
 				var = pingstats::Color{
 					static_cast<std::uint8_t>(r), 
 					static_cast<std::uint8_t>(g),
-					static_cast<std::uint8_t>(b) };
+					static_cast<std::uint8_t>(b),
+					static_cast<std::uint8_t>(a) };
 
 				return true;
 			}
@@ -587,8 +1400,14 @@ namespace utility
 			return false;
 		}
 
+		// Alpha is only written when it isn't opaque.
 		static std::string storeValue(const pingstats::Color& value)
 		{
+			if (value.a() != 255)
+			{
+				return formatString("%u, %u, %u, %u", value.r(), value.g(), value.b(), value.a());
+			}
+
 			return formatString("%u, %u, %u", value.r(), value.g(), value.b());
 		}
 	};
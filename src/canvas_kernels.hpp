@@ -0,0 +1,536 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined _M_X64 || defined _M_IX86 || defined __x86_64__ || defined __i386__
+#define PINGSTATS_X86
+#endif
+
+#if defined PINGSTATS_X86
+#include <immintrin.h>
+#if defined _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined __GNUC__
+#define PINGSTATS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PINGSTATS_TARGET(isa)
+#endif
+
+namespace pingstats // export
+{
+	// Pixel kernels behind clearCanvas, fillCanvasRect, blendCanvasRect and
+	// blendCanvasMask. Rows are addressed by pointer and stride (in pixels), 
+	// so the kernels don't care what kind of canvas they're working on.
+	//
+	// streamFill fills with non-temporal stores, which skip reading the
+	// destination into the cache first. That only pays off for fills larger 
+	// than the core's own caches, smaller ones stay plain loops. Streaming
+	// is bound by memory bandwidth, wider vectors measured no faster than 
+	// SSE2, and copies measured no faster streamed at all.
+	//
+	// blend composites a premultiplied colour over the rect (source over).
+	// A mask scales the colour per pixel by mask / 255, its rows are 
+	// maskStride bytes apart. All sets round the same way, so they give 
+	// the same result as the scalar one to the bit.
+
+	struct CanvasKernels
+	{
+		const char* name;
+
+		void (*streamFill)(std::uint32_t* dest, std::size_t destStride, 
+			std::size_t width, std::size_t height, std::uint32_t value);
+
+		void (*blend)(std::uint32_t* dest, std::size_t destStride, 
+			std::size_t width, std::size_t height, std::uint32_t color,
+			const std::uint8_t* mask, std::size_t maskStride);
+	};
+
+	namespace kernels
+	{
+		// x * y / 255 rounded to nearest, exact for 8 bit x and y. The 
+		// vector kernels do the same in 16 bit lanes.
+		constexpr std::uint32_t multiply255(std::uint32_t x, std::uint32_t y)
+		{
+			const auto t{ x * y + 128 };
+			return (t + (t >> 8)) >> 8;
+		}
+
+		using BlendTable = std::array<std::array<std::uint8_t, 256>, 256>;
+
+		// multiply255 for every pair, the scalar kernel looks channels up.
+		const BlendTable& blendTable()
+		{
+			static const auto table{ [] {
+				auto table{ std::make_unique<BlendTable>() };
+
+				for (std::uint32_t a{}; a < 256; ++a)
+				{
+					for (std::uint32_t c{}; c < 256; ++c)
+					{
+						(*table)[a][c] = static_cast<std::uint8_t>(multiply255(a, c));
+					}
+				}
+
+				return table;
+			}() };
+
+			return *table;
+		}
+
+		// All four channels of pixel scaled by row, a row of the table.
+		std::uint32_t scalePixel(std::uint32_t pixel, const std::uint8_t* row)
+		{
+			return 
+				static_cast<std::uint32_t>(row[pixel & 0xFF]) |
+				static_cast<std::uint32_t>(row[(pixel >> 8) & 0xFF]) << 8 |
+				static_cast<std::uint32_t>(row[(pixel >> 16) & 0xFF]) << 16 |
+				static_cast<std::uint32_t>(row[pixel >> 24]) << 24;
+		}
+
+		// Premultiplied channels never exceed alpha, so no channel of the
+		// sum can carry into the next.
+		std::uint32_t blendPixel(
+			const BlendTable& table, std::uint32_t dest, std::uint32_t color, std::uint8_t mask)
+		{
+			const auto scaled{ scalePixel(color, table[mask].data()) };
+			return scaled + scalePixel(dest, table[255 - (scaled >> 24)].data());
+		}
+
+		// Without streaming stores, the same loop as fillCanvasRect.
+		void fillScalar(std::uint32_t* dest, std::size_t destStride, 
+			std::size_t width, std::size_t height, std::uint32_t value)
+		{
+			for (std::size_t j{}; j < height; ++j, dest += destStride)
+			{
+				// Generates rep stos, don't change to fill/fill_n.
+				for (std::size_t i{}; i < width; ++i)
+				{
+					dest[i] = value;
+				}
+			}
+		}
+
+		void blendScalar(std::uint32_t* dest, std::size_t destStride, 
+			std::size_t width, std::size_t height, std::uint32_t color,
+			const std::uint8_t* mask, std::size_t maskStride)
+		{
+			const auto& table{ blendTable() };
+			const auto inverse{ table[255 - (color >> 24)].data() };
+
+			for (std::size_t j{}; j < height; ++j, dest += destStride)
+			{
+				if (mask == nullptr)
+				{
+					for (std::size_t i{}; i < width; ++i)
+					{
+						dest[i] = color + scalePixel(dest[i], inverse);
+					}
+				}
+				else
+				{
+					for (std::size_t i{}; i < width; ++i)
+					{
+						dest[i] = blendPixel(table, dest[i], color, mask[i]);
+					}
+
+					mask += maskStride;
+				}
+			}
+		}
+
+#if defined PINGSTATS_X86
+		// Number of leading pixels to handle one by one until dest 
+		// is aligned to ALIGNMENT bytes, clamped to the row width.
+		template <std::size_t ALIGNMENT>
+		std::size_t alignmentHead(const std::uint32_t* dest, std::size_t width)
+		{
+			const auto misalignment{ reinterpret_cast<std::uintptr_t>(dest) % ALIGNMENT };
+			const auto head{ misalignment == 0 ? 0 : (ALIGNMENT - misalignment) / 4 };
+			return head < width ? head : width;
+		}
+
+		PINGSTATS_TARGET("sse2")
+		void streamFillSse2(std::uint32_t* dest, std::size_t destStride, 
+			std::size_t width, std::size_t height, std::uint32_t value)
+		{
+			const auto v{ _mm_set1_epi32(static_cast<int>(value)) };
+
+			for (std::size_t j{}; j < height; ++j, dest += destStride)
+			{
+				const auto head{ alignmentHead<64>(dest, width) };
+				std::size_t i{};
+
+				for (; i < head; ++i)
+				{
+					dest[i] = value;
+				}
+
+				// Whole cache lines only, mixing streamed and cached stores 
+				// to one line flushes the write combining buffer early.
+				for (; i + 16 <= width; i += 16)
+				{
+					_mm_stream_si128(reinterpret_cast<__m128i*>(dest + i), v);
+					_mm_stream_si128(reinterpret_cast<__m128i*>(dest + i + 4), v);
+					_mm_stream_si128(reinterpret_cast<__m128i*>(dest + i + 8), v);
+					_mm_stream_si128(reinterpret_cast<__m128i*>(dest + i + 12), v);
+				}
+
+				for (; i < width; ++i)
+				{
+					dest[i] = value;
+				}
+			}
+
+			// Streaming stores are weakly ordered.
+			_mm_sfence();
+		}
+
+		// multiply255 on 16 bit lanes.
+		PINGSTATS_TARGET("sse2")
+		__m128i multiply255Sse2(__m128i x, __m128i y)
+		{
+			const auto t{ _mm_add_epi16(_mm_mullo_epi16(x, y), _mm_set1_epi16(128)) };
+			return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+		}
+
+		// Four pixels, the colour and inverse alpha of the first two in 
+		// the lo halves, of the last two in the hi halves.
+		PINGSTATS_TARGET("sse2")
+		__m128i blendSse2(__m128i dest, 
+			__m128i colorLo, __m128i colorHi, __m128i inverseLo, __m128i inverseHi)
+		{
+			const auto zero{ _mm_setzero_si128() };
+			const auto lo{ multiply255Sse2(_mm_unpacklo_epi8(dest, zero), inverseLo) };
+			const auto hi{ multiply255Sse2(_mm_unpackhi_epi8(dest, zero), inverseHi) };
+
+			return _mm_packus_epi16(_mm_add_epi16(lo, colorLo), _mm_add_epi16(hi, colorHi));
+		}
+
+		PINGSTATS_TARGET("sse2")
+		__m128i inverseAlphaSse2(__m128i color)
+		{
+			const auto alpha{ _mm_shufflehi_epi16(_mm_shufflelo_epi16(color, 0xFF), 0xFF) };
+			return _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+		}
+
+		PINGSTATS_TARGET("sse2")
+		void blendSse2(std::uint32_t* dest, std::size_t destStride, 
+			std::size_t width, std::size_t height, std::uint32_t color,
+			const std::uint8_t* mask, std::size_t maskStride)
+		{
+			const auto& table{ blendTable() };
+			const auto zero{ _mm_setzero_si128() };
+			const auto color16{ _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color)), zero) };
+			const auto inverse16{ inverseAlphaSse2(color16) };
+
+			for (std::size_t j{}; j < height; ++j, dest += destStride)
+			{
+				std::size_t i{};
+
+				if (mask == nullptr)
+				{
+					for (; i + 4 <= width; i += 4)
+					{
+						const auto d{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i)) };
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), 
+							blendSse2(d, color16, color16, inverse16, inverse16));
+					}
+
+					for (; i < width; ++i)
+					{
+						dest[i] = blendPixel(table, dest[i], color, 255);
+					}
+				}
+				else
+				{
+					for (; i + 4 <= width; i += 4)
+					{
+						std::uint32_t m;
+						std::memcpy(&m, mask + i, sizeof m);
+
+						// Each mask byte spread over the channels of its pixel.
+						auto spread{ _mm_cvtsi32_si128(static_cast<int>(m)) };
+						spread = _mm_unpacklo_epi8(spread, spread);
+						spread = _mm_unpacklo_epi16(spread, spread);
+
+						const auto colorLo{ multiply255Sse2(color16, _mm_unpacklo_epi8(spread, zero)) };
+						const auto colorHi{ multiply255Sse2(color16, _mm_unpackhi_epi8(spread, zero)) };
+
+						const auto d{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i)) };
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), blendSse2(d, 
+							colorLo, colorHi, inverseAlphaSse2(colorLo), inverseAlphaSse2(colorHi)));
+					}
+
+					for (; i < width; ++i)
+					{
+						dest[i] = blendPixel(table, dest[i], color, mask[i]);
+					}
+
+					mask += maskStride;
+				}
+			}
+		}
+
+		PINGSTATS_TARGET("avx2")
+		__m256i multiply255Avx2(__m256i x, __m256i y)
+		{
+			const auto t{ _mm256_add_epi16(_mm256_mullo_epi16(x, y), _mm256_set1_epi16(128)) };
+			return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+		}
+
+		// Eight pixels, unpacking works within 128 bit lanes, so the lo 
+		// halves hold pixels 0, 1, 4 and 5.
+		PINGSTATS_TARGET("avx2")
+		__m256i blendAvx2(__m256i dest, 
+			__m256i colorLo, __m256i colorHi, __m256i inverseLo, __m256i inverseHi)
+		{
+			const auto zero{ _mm256_setzero_si256() };
+			const auto lo{ multiply255Avx2(_mm256_unpacklo_epi8(dest, zero), inverseLo) };
+			const auto hi{ multiply255Avx2(_mm256_unpackhi_epi8(dest, zero), inverseHi) };
+
+			return _mm256_packus_epi16(_mm256_add_epi16(lo, colorLo), _mm256_add_epi16(hi, colorHi));
+		}
+
+		PINGSTATS_TARGET("avx2")
+		__m256i inverseAlphaAvx2(__m256i color)
+		{
+			const auto alpha{ _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(color, 0xFF), 0xFF) };
+			return _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+		}
+
+		PINGSTATS_TARGET("avx2")
+		void blendAvx2(std::uint32_t* dest, std::size_t destStride, 
+			std::size_t width, std::size_t height, std::uint32_t color,
+			const std::uint8_t* mask, std::size_t maskStride)
+		{
+			const auto& table{ blendTable() };
+			const auto zero{ _mm256_setzero_si256() };
+			const auto color16{ _mm256_unpacklo_epi8(_mm256_set1_epi32(static_cast<int>(color)), zero) };
+			const auto inverse16{ inverseAlphaAvx2(color16) };
+
+			for (std::size_t j{}; j < height; ++j, dest += destStride)
+			{
+				std::size_t i{};
+
+				if (mask == nullptr)
+				{
+					for (; i + 8 <= width; i += 8)
+					{
+						const auto d{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dest + i)) };
+						_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), 
+							blendAvx2(d, color16, color16, inverse16, inverse16));
+					}
+
+					for (; i < width; ++i)
+					{
+						dest[i] = blendPixel(table, dest[i], color, 255);
+					}
+				}
+				else
+				{
+					for (; i + 8 <= width; i += 8)
+					{
+						const auto m{ _mm_loadl_epi64(reinterpret_cast<const __m128i*>(mask + i)) };
+						const auto bytes{ _mm_unpacklo_epi8(m, m) };
+						const auto spread{ _mm256_inserti128_si256(
+							_mm256_castsi128_si256(_mm_unpacklo_epi16(bytes, bytes)), 
+							_mm_unpackhi_epi16(bytes, bytes), 1) };
+
+						const auto colorLo{ multiply255Avx2(color16, _mm256_unpacklo_epi8(spread, zero)) };
+						const auto colorHi{ multiply255Avx2(color16, _mm256_unpackhi_epi8(spread, zero)) };
+
+						const auto d{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dest + i)) };
+						_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), blendAvx2(d, 
+							colorLo, colorHi, inverseAlphaAvx2(colorLo), inverseAlphaAvx2(colorHi)));
+					}
+
+					for (; i < width; ++i)
+					{
+						dest[i] = blendPixel(table, dest[i], color, mask[i]);
+					}
+
+					mask += maskStride;
+				}
+			}
+		}
+
+		struct CpuidRegisters
+		{
+			std::uint32_t eax, ebx, ecx, edx;
+		};
+
+		CpuidRegisters cpuid(std::uint32_t leaf, std::uint32_t subleaf = 0)
+		{
+			CpuidRegisters r{};
+#if defined _MSC_VER
+			int info[4];
+			__cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+			r = { static_cast<std::uint32_t>(info[0]), static_cast<std::uint32_t>(info[1]),
+				static_cast<std::uint32_t>(info[2]), static_cast<std::uint32_t>(info[3]) };
+#else
+			__cpuid_count(leaf, subleaf, r.eax, r.ebx, r.ecx, r.edx);
+#endif
+			return r;
+		}
+
+		std::uint64_t xgetbv0()
+		{
+#if defined _MSC_VER
+			return _xgetbv(0);
+#else
+			std::uint32_t lo, hi;
+			asm volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+			return (static_cast<std::uint64_t>(hi) << 32) | lo;
+#endif
+		}
+
+		// Size of the largest first or second level data or unified cache, 
+		// from the deterministic cache parameter leaf (4 on Intel, 0x8000001D 
+		// on AMD). Those belong to one core, the last level is shared, and
+		// VMs often report the whole host's as their own.
+		std::size_t queryCoreCacheSize()
+		{
+			std::size_t largest{};
+
+			const auto scan{ [&](std::uint32_t leaf) {
+				for (std::uint32_t i{}; i < 16; ++i)
+				{
+					const auto r{ cpuid(leaf, i) };
+					const auto type{ r.eax & 0x1F };
+					const auto level{ (r.eax >> 5) & 0x7 };
+
+					if (type == 0)
+					{
+						break;
+					}
+
+					if (type != 2 && level <= 2) // not an instruction cache
+					{
+						const std::size_t ways{ ((r.ebx >> 22) & 0x3FF) + 1u };
+						const std::size_t partitions{ ((r.ebx >> 12) & 0x3FF) + 1u };
+						const std::size_t lineSize{ (r.ebx & 0xFFF) + 1u };
+						const std::size_t sets{ r.ecx + 1u };
+
+						largest = std::max(largest, ways * partitions * lineSize * sets);
+					}
+				}
+			} };
+
+			const auto maxLeaf{ cpuid(0).eax };
+			const auto maxExtendedLeaf{ cpuid(0x80000000).eax };
+
+			if (maxLeaf >= 4)
+			{
+				scan(4);
+			}
+
+			if (largest == 0 && maxExtendedLeaf >= 0x8000001D)
+			{
+				scan(0x8000001D);
+			}
+
+			return largest;
+		}
+#endif
+	}
+
+	const CanvasKernels& scalarCanvasKernels()
+	{
+		static constexpr CanvasKernels scalar{ 
+			"scalar", kernels::fillScalar, kernels::blendScalar };
+
+		return scalar;
+	}
+
+	// All kernel sets the running CPU supports, slowest first.
+	const std::vector<const CanvasKernels*>& supportedCanvasKernels()
+	{
+		static const auto supported{ [] {
+			std::vector<const CanvasKernels*> result{ &scalarCanvasKernels() };
+
+#if defined PINGSTATS_X86
+			static constexpr CanvasKernels sse2{ 
+				"sse2", kernels::streamFillSse2, kernels::blendSse2 };
+			static constexpr CanvasKernels avx2{ 
+				"avx2", kernels::streamFillSse2, kernels::blendAvx2 };
+
+			const auto leaf1{ kernels::cpuid(1) };
+			const auto leaf7{ kernels::cpuid(0).eax >= 7 ? 
+				kernels::cpuid(7) : kernels::CpuidRegisters{} };
+
+			// AVX state has to be enabled by the OS as well (XCR0).
+			const auto osxsave{ (leaf1.ecx & (1u << 27)) != 0 };
+			const auto xcr0{ osxsave ? kernels::xgetbv0() : 0 };
+			const auto ymmEnabled{ (xcr0 & 0x06) == 0x06 };
+
+			if (leaf1.edx & (1u << 26))
+			{
+				result.push_back(&sse2);
+			}
+
+			if (ymmEnabled && (leaf7.ebx & (1u << 5)))
+			{
+				result.push_back(&avx2);
+			}
+#endif
+
+			return result;
+		}() };
+
+		return supported;
+	}
+
+	const CanvasKernels& canvasKernels()
+	{
+		static const auto& selected{ *supportedCanvasKernels().back() };
+		return selected;
+	}
+
+	// Fills of more bytes than this use streamFill.
+	std::size_t streamFillThreshold()
+	{
+		static const auto size{ [] {
+			std::size_t size{};
+#if defined PINGSTATS_X86
+			size = kernels::queryCoreCacheSize();
+#endif
+			return size != 0 ? size : std::size_t{ 1 } << 20;
+		}() };
+
+		return size;
+	}
+}
@@ -0,0 +1,150 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace pingstats // export
+{
+	// Keeps the pixel storage of released canvases, so resizing a canvas
+	// back and forth reuses memory that is already committed instead of
+	// allocating (and faulting in) a new buffer every time. Capacities are
+	// rounded to quarter octaves, so nearby sizes share storage. Used from
+	// the render workers, hence the lock; it's only taken on resize.
+	template <class CanvasType>
+	class BasicCanvasPool
+	{
+	public:
+		using Storage = typename CanvasType::Storage;
+
+		// Released storage beyond this is freed, oldest first.
+		static constexpr std::size_t MAX_POOLED_PIXELS{ std::size_t{ 16 } << 20 };
+
+	private:
+		std::mutex _mutex;
+		std::vector<Storage> _pooled;
+		std::size_t _pooledPixels{};
+		std::size_t _allocations{};
+
+	public:
+		static std::size_t roundCapacity(std::size_t pixels)
+		{
+			std::size_t step{ 1 };
+
+			while (step * 8 <= pixels)
+			{
+				step <<= 1;
+			}
+
+			return (pixels + step - 1) & ~(step - 1);
+		}
+
+		CanvasType acquire(std::int32_t width, std::int32_t height)
+		{
+			const auto pixels{ static_cast<std::size_t>(width) * static_cast<std::size_t>(height) };
+
+			if (pixels == 0)
+			{
+				return CanvasType{ width, height };
+			}
+
+			const auto capacity{ roundCapacity(pixels) };
+
+			std::unique_lock<std::mutex> lock{ _mutex };
+
+			// Best fit, but don't let a small canvas pin a much larger buffer.
+			auto best{ _pooled.end() };
+
+			for (auto it{ _pooled.begin() }; it != _pooled.end(); ++it)
+			{
+				if (it->capacity() >= pixels && 
+					it->capacity() <= 2 * capacity &&
+					(best == _pooled.end() || it->capacity() < best->capacity()))
+				{
+					best = it;
+				}
+			}
+
+			if (best != _pooled.end())
+			{
+				auto storage{ std::move(*best) };
+				_pooledPixels -= storage.capacity();
+				_pooled.erase(best);
+				lock.unlock();
+
+				return CanvasType{ width, height, std::move(storage) };
+			}
+
+			++_allocations;
+			lock.unlock();
+
+			return CanvasType{ width, height, Storage::allocate(capacity) };
+		}
+
+		// Leaves the canvas empty.
+		void release(CanvasType& canvas)
+		{
+			auto storage{ canvas.releaseStorage() };
+			const auto capacity{ storage.capacity() };
+
+			if (capacity == 0 || capacity > MAX_POOLED_PIXELS)
+			{
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock{ _mutex };
+
+			_pooled.push_back(std::move(storage));
+			_pooledPixels += capacity;
+
+			auto evicted{ _pooled.begin() };
+
+			while (_pooledPixels > MAX_POOLED_PIXELS)
+			{
+				_pooledPixels -= evicted->capacity();
+				++evicted;
+			}
+
+			_pooled.erase(_pooled.begin(), evicted);
+		}
+
+		void resize(CanvasType& canvas, std::int32_t width, std::int32_t height)
+		{
+			release(canvas);
+			canvas = acquire(width, height);
+		}
+
+		// Number of storages the pool had to allocate so far.
+		std::size_t allocations()
+		{
+			std::lock_guard<std::mutex> lock{ _mutex };
+			return _allocations;
+		}
+	};
+}
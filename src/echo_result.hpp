@@ -0,0 +1,143 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/utility.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined _WIN32
+#include <Ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+namespace pingstats // export
+{
+	using namespace utility::literals;
+
+	namespace cr = std::chrono;
+
+#if !defined _WIN32
+	using IPAddr = std::uint32_t;
+#endif
+
+	class IpEndPoint
+	{
+		IPAddr _ipv4Addr;
+
+	public:
+		constexpr IpEndPoint()
+			: IpEndPoint{ INADDR_ANY }
+		{}
+
+		constexpr explicit IpEndPoint(IPAddr ipv4Addr)
+			: _ipv4Addr{ ipv4Addr }
+		{}
+
+		constexpr bool operator == (const IpEndPoint& rhs) const
+		{
+			return _ipv4Addr == rhs._ipv4Addr;
+		}
+
+		constexpr bool operator != (const IpEndPoint& rhs) const
+		{
+			return _ipv4Addr != rhs._ipv4Addr;
+		}
+
+		constexpr auto addr4() const
+		{
+			return _ipv4Addr;
+		}
+
+		bool isPublicAddress() const
+		{
+			return 
+				!((_ipv4Addr & htonl(0xFF000000)) == htonl(0x0A000000)) && 
+				!((_ipv4Addr & htonl(0xFFF00000)) == htonl(0xAC100000)) && 
+				!((_ipv4Addr & htonl(0xFFFF0000)) == htonl(0xC0A80000));
+		}
+
+		std::string name() const
+		{
+			char buffer[512];
+
+			if (inet_ntop(AF_INET, &_ipv4Addr, buffer, sizeof buffer) == nullptr)
+			{
+				throw std::runtime_error("Generating name for IP failed.");
+			}
+
+			return buffer;
+		}
+
+		static IpEndPoint fromHostname(const char* targetname)
+		{
+			struct AddrInfo
+			{
+				addrinfo* addr{};
+
+				~AddrInfo()
+				{
+					freeaddrinfo(addr);
+				}
+			};
+
+			AddrInfo info;
+			
+			int ec{ getaddrinfo(targetname, nullptr, nullptr, &info.addr) };
+
+			if (!ec)
+			{
+				for (auto addr{ info.addr }; addr != nullptr; addr = addr->ai_next)
+				{
+					if (addr->ai_family == AF_INET)
+					{
+						auto addr_in{ reinterpret_cast<sockaddr_in*>(addr->ai_addr) };
+						return IpEndPoint{ addr_in->sin_addr.s_addr };
+					}
+				}
+			}
+
+			throw std::runtime_error(
+				"Unable to resolve hostname \""s + targetname + 
+				"\".\r\nCode: " + std::to_string(ec));
+		}
+	};
+
+	class IcmpEchoResult
+	{
+	public:
+		cr::steady_clock::time_point sentTime;
+		cr::nanoseconds latency;
+		std::uint32_t errorCode;
+		std::uint32_t statusCode;
+		IpEndPoint responder;
+		std::uint32_t sysLatency;
+	};
+}
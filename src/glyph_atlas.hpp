@@ -0,0 +1,325 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "canvas_drawing.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace pingstats // export
+{
+	class FontSpacing
+	{
+	public:
+		pxindex fontWidth{ 8 };
+		pxindex fontHeight{ 16 };
+		pxindex fontLineSpacing{ 16 };
+	};
+
+	// Coverage masks for the printable ASCII range, one fontWidth x fontHeight
+	// cell per glyph. Text is composited by mixing the clear and the text 
+	// colour by coverage, so drawing costs the same no matter how often the 
+	// strings change and never allocates. Each glyph has its own advance, 
+	// and an ink width which may reach past it into the next glyph.
+	class GlyphAtlas
+	{
+	public:
+		static constexpr unsigned char FIRST_GLYPH{ 0x20 };
+		static constexpr unsigned char LAST_GLYPH{ 0x7E };
+		static constexpr std::size_t GLYPH_COUNT{ LAST_GLYPH - FIRST_GLYPH + 1 };
+
+	private:
+		FontSpacing _spacing{};
+		std::vector<std::uint8_t> _masks;
+		std::array<pxindex, GLYPH_COUNT> _advances{};
+		std::array<pxindex, GLYPH_COUNT> _widths{};
+
+	public:
+		GlyphAtlas() = default;
+
+		explicit GlyphAtlas(const FontSpacing& spacing)
+			: _spacing{ spacing }
+			, _masks(GLYPH_COUNT * static_cast<std::size_t>(
+				spacing.fontWidth) * static_cast<std::size_t>(spacing.fontHeight))
+		{
+			_advances.fill(spacing.fontWidth);
+			_widths.fill(spacing.fontWidth);
+		}
+
+		auto& getFontSpacing() const
+		{
+			return _spacing;
+		}
+
+		// Characters outside the atlas are drawn as '?'.
+		static std::size_t glyphIndex(char c)
+		{
+			auto index{ static_cast<unsigned char>(c) };
+
+			if (index < FIRST_GLYPH || index > LAST_GLYPH)
+			{
+				index = '?';
+			}
+
+			return index - FIRST_GLYPH;
+		}
+
+		std::uint8_t* glyph(char c)
+		{
+			return &_masks[glyphIndex(c) * static_cast<std::size_t>(
+				_spacing.fontWidth) * static_cast<std::size_t>(_spacing.fontHeight)];
+		}
+
+		const std::uint8_t* glyph(char c) const
+		{
+			return const_cast<GlyphAtlas&>(*this).glyph(c);
+		}
+
+		pxindex advance(char c) const
+		{
+			return _advances[glyphIndex(c)];
+		}
+
+		// Both are clamped to the cell, the ink width to at least the advance.
+		void setAdvance(char c, pxindex advance, pxindex width)
+		{
+			const auto index{ glyphIndex(c) };
+
+			_advances[index] = std::clamp(advance, pxindex{}, _spacing.fontWidth);
+			_widths[index] = std::clamp(width, _advances[index], _spacing.fontWidth);
+		}
+
+		// The width draw() covers: the advances up to the last glyph, and its ink.
+		pxindex textWidth(std::string_view s) const
+		{
+			pxindex width{};
+
+			for (std::size_t i{}; i + 1 < s.size(); ++i)
+			{
+				width += advance(s[i]);
+			}
+
+			return s.empty() ? width : width + _widths[glyphIndex(s.back())];
+		}
+
+		void draw(
+			Canvas& canvas, 
+			Color clearColor, 
+			Color textColor, 
+			pxindex x, pxindex y, 
+			std::string_view s) const
+		{
+			const auto cellWidth{ _spacing.fontWidth };
+			const auto cellHeight{ _spacing.fontHeight };
+			const auto canvasWidth{ static_cast<pxindex>(canvas.width()) };
+			const auto canvasHeight{ static_cast<pxindex>(canvas.height()) };
+
+			const auto top{ std::max(y, pxindex{}) };
+			const auto bottom{ std::min(y + cellHeight, canvasHeight) };
+
+			// Every pixel is written once. Where the ink of the previous glyph 
+			// reaches into this one the two are merged, the last glyph covers 
+			// its whole ink.
+			const std::uint8_t* previousMask{};
+			pxindex previousX{};
+			pxindex previousEnd{};
+
+			for (std::size_t n{}; n < s.size(); ++n)
+			{
+				const auto index{ glyphIndex(s[n]) };
+				const auto width{ n + 1 < s.size() ? _advances[index] : _widths[index] };
+
+				const auto left{ std::max(x, pxindex{}) };
+				const auto right{ std::min(x + width, canvasWidth) };
+				const auto overlapEnd{ std::min(previousEnd, right) };
+				const auto mask{ glyph(s[n]) };
+
+				for (auto py{ top }; py < bottom && left < right; ++py)
+				{
+					const auto maskRow{ &mask[(py - y) * cellWidth + (left - x)] };
+					const auto pixelRow{ &canvas(left, py) };
+
+					for (pxindex i{}; i < right - left; ++i)
+					{
+						auto coverage{ maskRow[i] };
+
+						if (left + i < overlapEnd)
+						{
+							coverage = std::max(coverage, 
+								previousMask[(py - y) * cellWidth + (left + i - previousX)]);
+						}
+
+						// Coverage * 0x101 maps 0xFF to (almost) FIXED_ONE.
+						pixelRow[i] = coverage == 0 ? clearColor.value :
+							coverage == 0xFF ? textColor.value : 
+							raster::blend(clearColor.value, textColor.value, 
+								raster::fixed{ coverage } * 0x101);
+					}
+				}
+
+				previousMask = mask;
+				previousX = x;
+				previousEnd = x + _widths[index];
+
+				x += _advances[index];
+			}
+		}
+	};
+
+	// A 5x8 bitmap font, drawn by hand, one byte per row with the leftmost 
+	// pixel in bit 4. Rows 0 to 6 sit above the baseline, row 7 holds 
+	// descenders. Used where no system font is available.
+	GlyphAtlas makeBuiltinGlyphAtlas(pxindex scale = 1)
+	{
+		static constexpr pxindex GLYPH_WIDTH{ 5 };
+		static constexpr pxindex GLYPH_HEIGHT{ 8 };
+
+		static constexpr std::uint8_t GLYPHS[GlyphAtlas::GLYPH_COUNT][GLYPH_HEIGHT]{
+			{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // space
+			{ 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04, 0x00 }, // !
+			{ 0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "
+			{ 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A, 0x00 }, // #
+			{ 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04, 0x00 }, // $
+			{ 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03, 0x00 }, // %
+			{ 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D, 0x00 }, // &
+			{ 0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '
+			{ 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02, 0x00 }, // (
+			{ 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08, 0x00 }, // )
+			{ 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00, 0x00 }, // *
+			{ 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00, 0x00 }, // +
+			{ 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08, 0x00 }, // ,
+			{ 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00, 0x00 }, // -
+			{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // .
+			{ 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00, 0x00 }, // /
+			{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E, 0x00 }, // 0
+			{ 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00 }, // 1
+			{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F, 0x00 }, // 2
+			{ 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E, 0x00 }, // 3
+			{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02, 0x00 }, // 4
+			{ 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E, 0x00 }, // 5
+			{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E, 0x00 }, // 6
+			{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08, 0x00 }, // 7
+			{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E, 0x00 }, // 8
+			{ 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C, 0x00 }, // 9
+			{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00, 0x00 }, // :
+			{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08, 0x00 }, // ;
+			{ 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02, 0x00 }, // <
+			{ 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00, 0x00 }, // =
+			{ 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08, 0x00 }, // >
+			{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04, 0x00 }, // ?
+			{ 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E, 0x00 }, // @
+			{ 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11, 0x00 }, // A
+			{ 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E, 0x00 }, // B
+			{ 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E, 0x00 }, // C
+			{ 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C, 0x00 }, // D
+			{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F, 0x00 }, // E
+			{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10, 0x00 }, // F
+			{ 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F, 0x00 }, // G
+			{ 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11, 0x00 }, // H
+			{ 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00 }, // I
+			{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C, 0x00 }, // J
+			{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11, 0x00 }, // K
+			{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F, 0x00 }, // L
+			{ 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11, 0x00 }, // M
+			{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11, 0x00 }, // N
+			{ 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00 }, // O
+			{ 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10, 0x00 }, // P
+			{ 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D, 0x00 }, // Q
+			{ 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11, 0x00 }, // R
+			{ 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E, 0x00 }, // S
+			{ 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00 }, // T
+			{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00 }, // U
+			{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04, 0x00 }, // V
+			{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A, 0x00 }, // W
+			{ 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11, 0x00 }, // X
+			{ 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x00 }, // Y
+			{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F, 0x00 }, // Z
+			{ 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E, 0x00 }, // [
+			{ 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00, 0x00 }, // backslash
+			{ 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E, 0x00 }, // ]
+			{ 0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ^
+			{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x00 }, // _
+			{ 0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 }, // `
+			{ 0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00 }, // a
+			{ 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E, 0x00 }, // b
+			{ 0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E, 0x00 }, // c
+			{ 0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F, 0x00 }, // d
+			{ 0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 }, // e
+			{ 0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08, 0x00 }, // f
+			{ 0x00, 0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E }, // g
+			{ 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00 }, // h
+			{ 0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E, 0x00 }, // i
+			{ 0x02, 0x00, 0x06, 0x02, 0x02, 0x02, 0x12, 0x0C }, // j
+			{ 0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12, 0x00 }, // k
+			{ 0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00 }, // l
+			{ 0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11, 0x00 }, // m
+			{ 0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00 }, // n
+			{ 0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00 }, // o
+			{ 0x00, 0x00, 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10 }, // p
+			{ 0x00, 0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x01 }, // q
+			{ 0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10, 0x00 }, // r
+			{ 0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E, 0x00 }, // s
+			{ 0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06, 0x00 }, // t
+			{ 0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D, 0x00 }, // u
+			{ 0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04, 0x00 }, // v
+			{ 0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A, 0x00 }, // w
+			{ 0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x00 }, // x
+			{ 0x00, 0x00, 0x11, 0x11, 0x11, 0x0F, 0x01, 0x0E }, // y
+			{ 0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F, 0x00 }, // z
+			{ 0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02, 0x00 }, // {
+			{ 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00 }, // |
+			{ 0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08, 0x00 }, // }
+			{ 0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00, 0x00 }, // ~
+		};
+
+		scale = std::max(scale, pxindex{ 1 });
+
+		FontSpacing spacing;
+		spacing.fontWidth = (GLYPH_WIDTH + 1) * scale;
+		spacing.fontHeight = (GLYPH_HEIGHT + 1) * scale;
+		spacing.fontLineSpacing = (GLYPH_HEIGHT + 2) * scale;
+
+		GlyphAtlas atlas{ spacing };
+
+		for (std::size_t i{}; i < GlyphAtlas::GLYPH_COUNT; ++i)
+		{
+			const auto mask{ atlas.glyph(static_cast<char>(GlyphAtlas::FIRST_GLYPH + i)) };
+
+			for (pxindex y{}; y < GLYPH_HEIGHT * scale; ++y)
+			{
+				for (pxindex x{}; x < GLYPH_WIDTH * scale; ++x)
+				{
+					const auto bit{ (GLYPHS[i][y / scale] >> (GLYPH_WIDTH - 1 - x / scale)) & 1 };
+					mask[x + y * spacing.fontWidth] = bit ? 0xFF : 0x00;
+				}
+			}
+		}
+
+		return atlas;
+	}
+}
@@ -24,9 +24,11 @@
 #pragma once
 
 #include "utility/utility.hpp"
+#include "utility/event_trace.hpp"
 #include "winapi/utility.hpp"
 
 #include "window_messages.hpp"
+#include "echo_result.hpp"
 
 #include <array>
 #include <functional>
@@ -68,99 +70,6 @@ namespace pingstats // export
 	using IcmpFileHandle = std::unique_ptr<
 		std::remove_pointer<HANDLE>::type, IcmpCloseHandleType>;
 
-	class IpEndPoint
-	{
-		IPAddr _ipv4Addr;
-
-	public:
-		constexpr IpEndPoint()
-			: IpEndPoint{ INADDR_ANY }
-		{}
-
-		constexpr explicit IpEndPoint(IPAddr ipv4Addr)
-			: _ipv4Addr{ ipv4Addr }
-		{}
-
-		constexpr bool operator == (const IpEndPoint& rhs) const
-		{
-			return _ipv4Addr == rhs._ipv4Addr;
-		}
-
-		constexpr bool operator != (const IpEndPoint& rhs) const
-		{
-			return _ipv4Addr != rhs._ipv4Addr;
-		}
-
-		constexpr auto addr4() const
-		{
-			return _ipv4Addr;
-		}
-
-		bool isPublicAddress() const
-		{
-			return 
-				!((_ipv4Addr & htonl(0xFF000000)) == htonl(0x0A000000)) && 
-				!((_ipv4Addr & htonl(0xFFF00000)) == htonl(0xAC100000)) && 
-				!((_ipv4Addr & htonl(0xFFFF0000)) == htonl(0xC0A80000));
-		}
-
-		std::string name() const
-		{
-			char buffer[512];
-
-			if (inet_ntop(AF_INET, &_ipv4Addr, buffer, sizeof buffer) == nullptr)
-			{
-				throw std::runtime_error("Generating name for IP failed.");
-			}
-
-			return buffer;
-		}
-
-		static IpEndPoint fromHostname(const char* targetname)
-		{
-			struct AddrInfo
-			{
-				addrinfo* addr{};
-
-				~AddrInfo()
-				{
-					freeaddrinfo(addr);
-				}
-			};
-
-			AddrInfo info;
-			
-			int ec{ getaddrinfo(targetname, nullptr, nullptr, &info.addr) };
-
-			if (!ec)
-			{
-				for (auto addr{ info.addr }; addr != nullptr; addr = addr->ai_next)
-				{
-					if (addr->ai_family == AF_INET)
-					{
-						auto addr_in{ reinterpret_cast<sockaddr_in*>(addr->ai_addr) };
-						return IpEndPoint{ addr_in->sin_addr.s_addr };
-					}
-				}
-			}
-
-			throw std::runtime_error(
-				"Unable to resolve hostname \""s + targetname + 
-				"\".\r\nCode: " + std::to_string(ec));
-		}
-	};
-
-	class IcmpEchoResult
-	{
-	public:
-		cr::steady_clock::time_point sentTime;
-		cr::nanoseconds latency;
-		std::uint32_t errorCode;
-		std::uint32_t statusCode;
-		IpEndPoint responder;
-		std::uint32_t sysLatency;
-	};
-
 	class IcmpEchoContext
 	{
 	public:
@@ -170,7 +79,7 @@ namespace pingstats // export
 		alignas(8) std::array<char, 96> buffer{};
 		wa::HandlePtr event{ wa::HandlePtr{ CreateEventW(nullptr, false, false, nullptr) } };
 
-		IcmpFileHandle file{ IcmpCreateFile() };
+		IcmpFileHandle file;
 		cr::steady_clock::time_point sentTime{};
 		DWORD timoutMs{};
 		DWORD errorCode{};
@@ -240,6 +149,7 @@ namespace pingstats // export
 		static_assert(RECV_BYTES <= BUFFER_SIZE);
 
 		auto context{ std::make_unique<IcmpEchoContext>() };
+		context->file.reset(IcmpCreateFile());
 
 		IpOptionInformationType options{};
 		options.Ttl = ttl;
@@ -264,7 +174,55 @@ namespace pingstats // export
 		return context;
 	}
 
+	// Everything that sends echo requests goes through an IcmpTransport,
+	// so the engine can be driven by a simulated network as well.
+	class IcmpTransport
+	{
+	public:
+		virtual ~IcmpTransport() = default;
+
+		virtual std::unique_ptr<IcmpEchoContext> asyncSendEcho(
+			IpEndPoint target,
+			IpEndPoint source,
+			DWORD timeoutMs,
+			UCHAR ttl) = 0;
+
+		virtual IcmpEchoResult makeResult(
+			const IcmpEchoContext& context,
+			cr::steady_clock::time_point replyTime) = 0;
+
+		// Called instead of makeResult for contexts the caller stops waiting for.
+		virtual void abandon(const IcmpEchoContext&) {}
+	};
+
+	class SystemIcmpTransport : public IcmpTransport
+	{
+	public:
+		std::unique_ptr<IcmpEchoContext> asyncSendEcho(
+			IpEndPoint target,
+			IpEndPoint source,
+			DWORD timeoutMs,
+			UCHAR ttl) override
+		{
+			return asyncSendIcmpEcho(target, source, timeoutMs, ttl);
+		}
+
+		IcmpEchoResult makeResult(
+			const IcmpEchoContext& context,
+			cr::steady_clock::time_point replyTime) override
+		{
+			return makeIcmpPingResult(context, replyTime);
+		}
+	};
+
+	IcmpTransport& systemIcmpTransport()
+	{
+		static SystemIcmpTransport transport;
+		return transport;
+	}
+
 	bool sendIcmpEcho(
+		IcmpTransport& transport,
 		IcmpEchoResult& result, 
 		IpEndPoint target, 
 		IpEndPoint source, 
@@ -272,7 +230,9 @@ namespace pingstats // export
 		UCHAR ttl, 
 		HANDLE stopEvent)
 	{
-		auto context{ asyncSendIcmpEcho(target, source, timeoutMs, ttl) };
+		PINGSTATS_TRACE_SCOPE("trace probe", ttl);
+
+		auto context{ transport.asyncSendEcho(target, source, timeoutMs, ttl) };
 		auto replyTime{ cr::steady_clock::now() };
 
 		if (context->errorCode == ERROR_IO_PENDING)
@@ -287,16 +247,18 @@ namespace pingstats // export
 			// Waiting suspended by external stop event.
 			if (reason - WAIT_OBJECT_0 == 0)
 			{
+				transport.abandon(*context);
 				return false;
 			}
 		}
 		
-		result = makeIcmpPingResult(*context, replyTime);
+		result = transport.makeResult(*context, replyTime);
 
 		return true;
 	}
 
 	bool traceRoute(
+		IcmpTransport& transport,
 		IpEndPoint& traceResult, 
 		TraceType traceType, 
 		HANDLE stopEvent,
@@ -311,10 +273,11 @@ namespace pingstats // export
 				resultTag, reinterpret_cast<LPARAM>(&result));
 		} };
 
-		const auto sendEcho{ [source, timeout, stopEvent]
+		const auto sendEcho{ [&transport, source, timeout, stopEvent]
 			(IcmpEchoResult& result, IpEndPoint target, UCHAR ttl, DWORD waitTime) {
 			return WaitForSingleObject(stopEvent, waitTime) == WAIT_TIMEOUT
 				&& sendIcmpEcho(
+					transport,
 					result,
 					target,
 					source,
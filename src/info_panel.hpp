@@ -0,0 +1,206 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/fixed_string.hpp"
+
+#include "canvas_drawing.hpp"
+#include "glyph_atlas.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace pingstats // export
+{
+	namespace ut = utility;
+
+	// Text lines below a plot, kept in their own layer. Lines are rebuilt
+	// every frame in fixed buffers, but only the ones whose text, colour 
+	// or position changed are drawn again.
+	class InfoPanel
+	{
+	public:
+		static constexpr std::size_t MAX_LINES{ 9 };
+		static constexpr std::size_t LINE_CAPACITY{ 128 };
+
+		using Line = ut::FixedString<LINE_CAPACITY>;
+
+	private:
+		class Entry
+		{
+		public:
+			Line text;
+			Color color{ 0, 0, 0 };
+			pxindex x{};
+			pxindex y{};
+
+			bool operator == (const Entry& rhs) const
+			{
+				return text == rhs.text 
+					&& color.value == rhs.color.value 
+					&& x == rhs.x 
+					&& y == rhs.y;
+			}
+		};
+
+		std::array<Entry, MAX_LINES> _shown{};
+		std::array<Entry, MAX_LINES> _pending{};
+
+		Canvas _layer;
+		Color _layerClearColor{ 0, 0, 0 };
+		pxindex _layerFontWidth{};
+		bool _layerValid{};
+		std::size_t _linesDrawn{};
+
+	public:
+		// Starts a line at (x, y) relative to the panel. Lines that are not
+		// set in a frame stay empty.
+		Line& line(std::size_t index, Color color, pxindex x, pxindex y)
+		{
+			auto& entry{ _pending[index] };
+			entry.text.clear();
+			entry.color = color;
+			entry.x = x;
+			entry.y = y;
+			return entry.text;
+		}
+
+		void clearLines()
+		{
+			for (auto& entry : _pending)
+			{
+				entry.text.clear();
+			}
+		}
+
+		// Number of lines that had to be drawn again in the last frame.
+		auto linesDrawn() const
+		{
+			return _linesDrawn;
+		}
+
+		void draw(
+			Canvas& canvas, 
+			const Rect& rect, 
+			const GlyphAtlas& atlas, 
+			Color clearColor)
+		{
+			const auto& spacing{ atlas.getFontSpacing() };
+
+			if (_layer.width() != rect.width() || 
+				_layer.height() != rect.height())
+			{
+				resizeCanvas(_layer, rect.width(), rect.height());
+				_layerValid = false;
+			}
+
+			if (!_layerValid || 
+				_layerClearColor.value != clearColor.value || 
+				_layerFontWidth != spacing.fontWidth)
+			{
+				clearCanvas(_layer, clearColor);
+
+				_shown = {};
+				_layerClearColor = clearColor;
+				_layerFontWidth = spacing.fontWidth;
+				_layerValid = true;
+			}
+
+			_linesDrawn = 0;
+
+			// Old text is cleared before anything is drawn, it may overlap 
+			// a line that moved or came back. Unchanged lines under it 
+			// have to be drawn again as well.
+			std::array<bool, MAX_LINES> redraw{};
+
+			for (std::size_t i{}; i < MAX_LINES; ++i)
+			{
+				if (_shown[i] == _pending[i])
+				{
+					continue;
+				}
+
+				const auto oldRect{ clipRect(textRect(_shown[i], atlas)) };
+
+				if (oldRect.width() > 0 && oldRect.height() > 0)
+				{
+					fillCanvasRect(_layer, oldRect, clearColor);
+
+					for (std::size_t j{}; j < MAX_LINES; ++j)
+					{
+						redraw[j] = redraw[j] || intersects(oldRect, textRect(_shown[j], atlas));
+					}
+				}
+
+				redraw[i] = true;
+			}
+
+			for (std::size_t i{}; i < MAX_LINES; ++i)
+			{
+				auto& shown{ _shown[i] };
+				const auto& pending{ _pending[i] };
+
+				if (!redraw[i])
+				{
+					continue;
+				}
+
+				atlas.draw(_layer, clearColor, pending.color, 
+					pending.x, pending.y, pending.text.view());
+
+				shown = pending;
+				_linesDrawn += !pending.text.empty();
+			}
+
+			copyCanvasRect(canvas, _layer, rect, 0, 0);
+		}
+
+	private:
+		static Rect textRect(const Entry& entry, const GlyphAtlas& atlas)
+		{
+			return { 
+				entry.x, 
+				entry.y, 
+				entry.x + atlas.textWidth(entry.text.view()),
+				entry.y + atlas.getFontSpacing().fontHeight 
+			};
+		}
+
+		static bool intersects(const Rect& a, const Rect& b)
+		{
+			return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+		}
+
+		Rect clipRect(const Rect& rect) const
+		{
+			return { 
+				std::max(rect.left, pxindex{}), 
+				std::max(rect.top, pxindex{}), 
+				std::min(rect.right, static_cast<pxindex>(_layer.width())), 
+				std::min(rect.bottom, static_cast<pxindex>(_layer.height())) 
+			};
+		}
+	};
+}
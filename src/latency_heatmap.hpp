@@ -0,0 +1,315 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+#pragma once
+
+#include "utility/utility.hpp"
+
+#include "canvas_drawing.hpp"
+#include "utility.hpp"
+#include "vertical_scale.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace pingstats // export
+{
+	// Latency histograms by time column for the heatmap plot. Buckets are
+	// log-linear: BUCKETS_PER_OCTAVE equal steps per doubling of latency,
+	// so every bucket is about as wide relative to its latency. Samples 
+	// are binned once when they arrive, a frame only reads back the 
+	// bucket levels through the palette.
+	class LatencyHeatmap
+	{
+	public:
+		static constexpr std::size_t BUCKETS{ 64 };
+		static constexpr std::size_t BUCKETS_PER_OCTAVE{ 4 };
+		static constexpr double MIN_MS{ 0.125 };
+
+		// Losses are drawn as a band along the top of the plot.
+		static constexpr pxindex LOSS_ROWS{ 3 };
+
+	private:
+		struct Column
+		{
+			std::int64_t index{ std::numeric_limits<std::int64_t>::min() };
+			std::uint32_t samples{};
+			std::uint32_t losses{};
+			std::uint8_t lossLevel{};
+
+			// Share of the column's samples per bucket as palette index,
+			// 0 if the bucket is empty.
+			std::array<std::uint8_t, BUCKETS> levels{};
+			std::array<std::uint32_t, BUCKETS> counts{};
+		};
+
+		struct RowBuckets
+		{
+			std::uint8_t first;
+			std::uint8_t last;
+		};
+
+		// Column i lives in slot i % capacity, newer columns evict older.
+		std::vector<Column> _columns;
+
+		// Buckets in each pixel row of the plot, first > last if none.
+		std::vector<RowBuckets> _rows;
+
+		std::array<Color, 256> _palette{};
+		std::array<Color, 256> _lossPalette{};
+
+		// Scratch for draw, the column shown in each pixel column.
+		std::vector<const Column*> _stripColumns;
+
+	public:
+		static std::size_t bucket(double ms)
+		{
+			if (!(ms >= MIN_MS))
+			{
+				return 0;
+			}
+
+			// ms / MIN_MS is in [2^(exponent - 1), 2^exponent).
+			int exponent;
+			const auto mantissa{ std::frexp(ms / MIN_MS, &exponent) };
+			const auto step{ static_cast<std::size_t>((mantissa * 2.0 - 1.0) * BUCKETS_PER_OCTAVE) };
+
+			return std::min(BUCKETS - 1, 
+				static_cast<std::size_t>(exponent - 1) * BUCKETS_PER_OCTAVE + step);
+		}
+
+		static double bucketLowerMs(std::size_t bucket)
+		{
+			const auto step{ static_cast<double>(bucket % BUCKETS_PER_OCTAVE) };
+
+			return std::ldexp(MIN_MS * (1.0 + step / BUCKETS_PER_OCTAVE), 
+				static_cast<int>(bucket / BUCKETS_PER_OCTAVE));
+		}
+
+		auto capacity() const
+		{
+			return _columns.size();
+		}
+
+		// Drops all samples.
+		void reset(std::size_t capacity)
+		{
+			_columns.assign(capacity, Column{});
+		}
+
+		void insert(std::int64_t column, double latencyMs)
+		{
+			if (const auto c{ findOrEvict(column) })
+			{
+				c->counts[bucket(latencyMs)] += 1;
+				c->samples += 1;
+
+				const auto scale{ 255.0 / c->samples };
+
+				for (std::size_t i{}; i < BUCKETS; ++i)
+				{
+					c->levels[i] = c->counts[i] == 0 ? 0 : static_cast<std::uint8_t>(
+						std::max(1.0, c->counts[i] * scale));
+				}
+
+				updateLossLevel(*c);
+			}
+		}
+
+		void insertLoss(std::int64_t column)
+		{
+			if (const auto c{ findOrEvict(column) })
+			{
+				c->losses += 1;
+				updateLossLevel(*c);
+			}
+		}
+
+		// Sample count of a column, for tests.
+		std::uint32_t samples(std::int64_t column) const
+		{
+			const auto c{ find(column) };
+			return c != nullptr ? c->samples : 0;
+		}
+
+		// Maps the pixel rows of a plot of the given height to buckets, 
+		// with the same scale as the line plot.
+		void setRows(pxindex height, const VerticalScale& scale)
+		{
+			const auto maxMs{ bucketLowerMs(BUCKETS) };
+
+			_rows.resize(static_cast<std::size_t>(std::max(height, 0)));
+
+			for (pxindex y{}; y < height; ++y)
+			{
+				const auto highMs{ scale.latency(height - y) };
+				const auto lowMs{ y + 1 == height && scale.mode() == ScaleMode::LOG ? 
+					0.0 : scale.latency(height - y - 1) };
+
+				auto& row{ _rows[static_cast<std::size_t>(y)] };
+
+				if (highMs <= 0.0 || lowMs >= maxMs)
+				{
+					row = RowBuckets{ 1, 0 };
+				}
+				else
+				{
+					row = RowBuckets{ 
+						static_cast<std::uint8_t>(bucket(lowMs)), 
+						static_cast<std::uint8_t>(bucket(highMs)) };
+				}
+			}
+		}
+
+		// The square root spreads the low shares, a single outlier in a 
+		// busy column would be invisible otherwise.
+		void setPalette(Color clear, Color cold, Color hot, Color loss)
+		{
+			const auto dim{ mergeColors(clear, cold, 0.25) };
+			const auto dimLoss{ mergeColors(clear, loss, 0.25) };
+
+			_palette[0] = clear;
+			_lossPalette[0] = clear;
+
+			for (std::size_t i{ 1 }; i < _palette.size(); ++i)
+			{
+				const auto t{ std::sqrt(i / 255.0) };
+
+				_palette[i] = t < 0.5 ? 
+					mergeColors(dim, cold, t * 2.0) : 
+					mergeColors(cold, hot, t * 2.0 - 1.0);
+
+				_lossPalette[i] = mergeColors(dimLoss, loss, t);
+			}
+		}
+
+		// Pixel column x of rect shows histogram column 
+		// (firstPixel + x - rect.left) / cellWidth, rect.top is row 0 of 
+		// setRows. Empty cells are left alone, so the grid shows through.
+		void draw(Canvas& canvas, const Rect& rect, std::int64_t firstPixel, pxindex cellWidth)
+		{
+			const auto width{ static_cast<std::size_t>(std::max(rect.width(), 0)) };
+			const auto height{ std::min(rect.height(), static_cast<pxindex>(_rows.size())) };
+			const auto stride{ static_cast<std::size_t>(canvas.width()) };
+
+			_stripColumns.resize(width);
+
+			for (std::size_t x{}; x < width; ++x)
+			{
+				_stripColumns[x] = find(
+					floorDiv(firstPixel + static_cast<std::int64_t>(x), cellWidth));
+			}
+
+			for (pxindex y{}; y < height; ++y)
+			{
+				const auto row{ _rows[static_cast<std::size_t>(y)] };
+				const auto line{ &canvas.pixelPtr()[static_cast<std::size_t>(rect.top + y) * 
+					stride + static_cast<std::size_t>(rect.left)] };
+
+				if (y < LOSS_ROWS)
+				{
+					for (std::size_t x{}; x < width; ++x)
+					{
+						const auto c{ _stripColumns[x] };
+
+						if (c != nullptr && c->lossLevel != 0)
+						{
+							line[x] = _lossPalette[c->lossLevel].value;
+						}
+					}
+				}
+
+				if (row.first > row.last)
+				{
+					continue;
+				}
+
+				for (std::size_t x{}; x < width; ++x)
+				{
+					const auto c{ _stripColumns[x] };
+
+					if (c != nullptr && (y >= LOSS_ROWS || c->lossLevel == 0))
+					{
+						auto level{ c->levels[row.first] };
+
+						for (auto b{ row.first + 1 }; b <= row.last; ++b)
+						{
+							level = std::max(level, c->levels[b]);
+						}
+
+						if (level != 0)
+						{
+							line[x] = _palette[level].value;
+						}
+					}
+				}
+			}
+		}
+
+	private:
+		std::size_t slotOf(std::int64_t column) const
+		{
+			const auto size{ static_cast<std::int64_t>(_columns.size()) };
+			return static_cast<std::size_t>((column % size + size) % size);
+		}
+
+		const Column* find(std::int64_t column) const
+		{
+			if (_columns.empty())
+			{
+				return nullptr;
+			}
+
+			const auto& c{ _columns[slotOf(column)] };
+			return c.index == column ? &c : nullptr;
+		}
+
+		// nullptr if the column is too old to be kept.
+		Column* findOrEvict(std::int64_t column)
+		{
+			if (_columns.empty())
+			{
+				return nullptr;
+			}
+
+			auto& c{ _columns[slotOf(column)] };
+
+			if (c.index < column)
+			{
+				c = Column{};
+				c.index = column;
+			}
+
+			return c.index == column ? &c : nullptr;
+		}
+
+		static void updateLossLevel(Column& c)
+		{
+			c.lossLevel = c.losses == 0 ? 0 : static_cast<std::uint8_t>(
+				std::max(1.0, 255.0 * c.losses / (c.samples + c.losses)));
+		}
+	};
+}
@@ -0,0 +1,221 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+#pragma once
+
+#include "utility/utility.hpp"
+#include "utility/stopwatch.hpp"
+
+#include "echo_result.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace pingstats // export
+{
+	namespace cr = std::chrono;
+	namespace ut = utility;
+
+	struct PyramidBucket
+	{
+		float minMs{ std::numeric_limits<float>::max() };
+		float maxMs{ std::numeric_limits<float>::lowest() };
+		double sumMs{};
+		std::uint32_t samples{};
+		std::uint32_t losses{};
+
+		double meanMs() const
+		{
+			return sumMs / samples;
+		}
+
+		void add(const PyramidBucket& rhs)
+		{
+			minMs = std::min(minMs, rhs.minMs);
+			maxMs = std::max(maxMs, rhs.maxMs);
+			sumMs += rhs.sumMs;
+			samples += rhs.samples;
+			losses += rhs.losses;
+		}
+	};
+
+	// Min, max and mean latency in time buckets of 1 s, 2 s, 4 s and so 
+	// on, so any stretch of history can be drawn from about as many 
+	// buckets as it has pixels. A result updates one bucket per level.
+	// Buckets are aligned to the clock's epoch, so a level's bucket i 
+	// covers level 0 buckets [i << level, (i + 1) << level).
+	class LatencyPyramid
+	{
+	public:
+		static constexpr std::size_t LEVELS{ 21 };
+
+	private:
+		struct Level
+		{
+			std::int64_t first{};
+			std::vector<PyramidBucket> buckets;
+		};
+
+		std::array<Level, LEVELS> _levels;
+
+		// Level 0 buckets kept, higher levels keep proportionally fewer.
+		std::size_t _capacity;
+		std::uint64_t _version{};
+
+	public:
+		explicit LatencyPyramid(std::size_t capacity = 7 * 24 * 3600)
+			: _capacity{ std::max<std::size_t>(capacity, 1) }
+		{}
+
+		static double bucketSeconds(std::size_t level)
+		{
+			return std::ldexp(1.0, static_cast<int>(level));
+		}
+
+		// The coarsest level whose buckets are no longer than given.
+		static std::size_t levelFor(double seconds)
+		{
+			if (!(seconds > 1.0))
+			{
+				return 0;
+			}
+
+			int exponent;
+			std::frexp(seconds, &exponent);
+
+			return std::min(LEVELS - 1, static_cast<std::size_t>(exponent - 1));
+		}
+
+		// Changes whenever a result is inserted.
+		auto version() const
+		{
+			return _version;
+		}
+
+		bool empty() const
+		{
+			return _levels[0].buckets.empty();
+		}
+
+		// Start of the oldest bucket that is kept.
+		cr::steady_clock::time_point oldest() const
+		{
+			return cr::steady_clock::time_point{ cr::seconds{ _levels[0].first } };
+		}
+
+		void insert(const IcmpEchoResult& result)
+		{
+			PyramidBucket sample{};
+
+			if (result.errorCode == 0 && result.statusCode == 0)
+			{
+				const auto ms{ ut::milliseconds_f64{ result.latency }.count() };
+
+				sample.minMs = static_cast<float>(ms);
+				sample.maxMs = static_cast<float>(ms);
+				sample.sumMs = ms;
+				sample.samples = 1;
+			}
+			else
+			{
+				sample.losses = 1;
+			}
+
+			const auto index{ cr::floor<cr::seconds>(result.sentTime.time_since_epoch()).count() };
+
+			for (std::size_t level{}; level < LEVELS; ++level)
+			{
+				if (const auto bucket{ findOrAppend(level, index >> level) })
+				{
+					bucket->add(sample);
+				}
+			}
+
+			_version += 1;
+		}
+
+		// Calls f(startSeconds, bucket) for the buckets of a level that 
+		// start in [begin, end), in order. Seconds are since the epoch.
+		template <typename F>
+		void forEach(std::size_t level, double begin, double end, F&& f) const
+		{
+			const auto& l{ _levels[level] };
+			const auto seconds{ bucketSeconds(level) };
+			const auto size{ static_cast<std::int64_t>(l.buckets.size()) };
+
+			const auto first{ std::max(std::int64_t{}, 
+				static_cast<std::int64_t>(std::ceil(begin / seconds)) - l.first) };
+			const auto last{ std::min(size, 
+				static_cast<std::int64_t>(std::ceil(end / seconds)) - l.first) };
+
+			for (auto i{ first }; i < last; ++i)
+			{
+				f((l.first + i) * seconds, l.buckets[static_cast<std::size_t>(i)]);
+			}
+		}
+
+	private:
+		// nullptr if index is older than what is kept.
+		PyramidBucket* findOrAppend(std::size_t level, std::int64_t index)
+		{
+			auto& l{ _levels[level] };
+			const auto capacity{ std::max<std::size_t>(_capacity >> level, 1) };
+
+			if (l.buckets.empty())
+			{
+				l.first = index;
+			}
+
+			if (index < l.first)
+			{
+				return nullptr;
+			}
+
+			// Trimmed in halves like the result histories, so appending
+			// stays amortized constant. After a long gap the whole level 
+			// may go.
+			if (index - l.first >= static_cast<std::int64_t>(2 * capacity))
+			{
+				const auto first{ index - static_cast<std::int64_t>(capacity) + 1 };
+				const auto drop{ std::min(l.buckets.size(), 
+					static_cast<std::size_t>(first - l.first)) };
+
+				l.buckets.erase(l.buckets.begin(), l.buckets.begin() + drop);
+				l.first = first;
+			}
+
+			const auto offset{ static_cast<std::size_t>(index - l.first) };
+
+			if (offset >= l.buckets.size())
+			{
+				l.buckets.resize(offset + 1);
+			}
+
+			return &l.buckets[static_cast<std::size_t>(index - l.first)];
+		}
+	};
+}
@@ -27,8 +27,12 @@
 #include "utility/utility.hpp"
 #include "winapi/utility.hpp"
 #include "main_window.hpp"
+#include "simulation_benchmark.hpp"
+#include "replay_benchmark.hpp"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #pragma comment(lib, "Winmm.lib") // timeBeginPeriod
 
@@ -58,6 +62,66 @@ namespace
 		TimePeriod(TimePeriod&&) = delete;
 	};
 
+	std::vector<std::string> parseCommandLine()
+	{
+		int argc{};
+		const auto argv{ CommandLineToArgvW(GetCommandLineW(), &argc) };
+
+		std::vector<std::string> args;
+
+		for (int i{ 1 }; argv != nullptr && i < argc; ++i)
+		{
+			args.push_back(utf8(argv[i]));
+		}
+
+		LocalFree(argv);
+
+		return args;
+	}
+
+	void loadBenchmarkConfig(TreeConfigNode& config)
+	{
+		auto configFile{ readFileAs<std::string>("pingstats.cfg") };
+
+		if (configFile.size() > 0 && !parseTreeConfig(config, configFile.c_str()))
+		{
+			showMessageBox("Warning", "Error while parsing config.");
+		}
+	}
+
+	void writeBenchmarkReport(const char* filename, 
+		const char* title, const std::string& report)
+	{
+		FileHandle file{ std::fopen(filename, "wb") };
+
+		if (file.get() != nullptr)
+		{
+			std::fwrite(report.data(), 1, report.size(), file.get());
+		}
+
+		showMessageBox(title, report);
+	}
+
+	void runSimulationBenchmark()
+	{
+		TreeConfigNode config{ nullptr, "config" };
+		loadBenchmarkConfig(config);
+
+		writeBenchmarkReport("pingstats-simulation.txt", 
+			"Simulation benchmark", SimulationBenchmark{}.run(config));
+	}
+
+	void runReplayBenchmark(const std::string& traceFilename, double speed)
+	{
+		TreeConfigNode config{ nullptr, "config" };
+		loadBenchmarkConfig(config);
+
+		const auto trace{ readResultTrace(traceFilename) };
+
+		writeBenchmarkReport("pingstats-replay.txt", 
+			"Replay benchmark", ReplayBenchmark{}.run(config, trace, speed));
+	}
+
 	LRESULT CALLBACK windowProc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) try
 	{
 		auto window{ reinterpret_cast<MainWindow*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA)) };
@@ -152,6 +216,21 @@ int WINAPI wWinMain(HINSTANCE hinstance, HINSTANCE, LPWSTR, int show) try
 	// Prevents Windows memory leak https://support.microsoft.com/en-us/kb/2384321
 	IcmpFileHandle icmpDummy{ IcmpCreateFile() };
 
+	const auto args{ parseCommandLine() };
+
+	if (args.size() >= 1 && args[0] == "--simulation-benchmark")
+	{
+		runSimulationBenchmark();
+		return 0;
+	}
+
+	// --replay-benchmark <trace file> [speed, 0 replays as fast as possible]
+	if (args.size() >= 2 && args[0] == "--replay-benchmark")
+	{
+		runReplayBenchmark(args[1], args.size() >= 3 ? std::stod(args[2]) : 0.0);
+		return 0;
+	}
+
 	static constexpr wchar_t WND_CLASSNAME[]{ L"MainWindowClass" };
 	static constexpr wchar_t WND_TITLE[]{ L"pingstats v2.0.4" };
 
@@ -26,25 +26,39 @@
 #include "resource.h"
 
 #include "utility/utility.hpp"
+#include "utility/event_trace.hpp"
 #include "utility/read_file.hpp"
-#include "utility/scoped_thread.hpp"
 #include "utility/tree_config.hpp"
-#include "utility/waitable_flag.hpp"
+#include "utility/worker_pool.hpp"
 
 #include "winapi/utility.hpp"
 #include "window_messages.hpp"
+#include "glyph_atlas.hpp"
+#include "network_simulator.hpp"
 #include "ping_monitor.hpp"
 #include "ping_data.hpp"
 #include "ping_plotter.hpp"
+#include "redraw_scheduler.hpp"
+#include "render_profiler.hpp"
+#include "result_trace.hpp"
+#include "stats_segment.hpp"
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <cmath>
+#include <cstdint>
 #include <future>
 #include <random>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
+#include <dwmapi.h>
+
+#pragma comment(lib, "Dwmapi.lib")
+
 namespace pingstats // export
 {
 	using namespace utility::literals;
@@ -71,16 +85,18 @@ namespace pingstats // export
 
 		Section(Section&&) = delete;
 
-		Section(ut::TreeConfigNode& config, HWND resultHandler, WPARAM resultTag)
+		Section(ut::TreeConfigNode& config, HWND resultHandler, 
+			WPARAM resultTag, IcmpTransport& transport)
 			: data{ config }
 			, plotter{ config }
-			, monitor{ config, resultHandler, resultTag }
+			, monitor{ config, resultHandler, resultTag, transport }
 		{}
 	};
 
 	class MainWindow
 	{
 		static constexpr char CONFIG_FILEPATH[14]{ "pingstats.cfg" };
+		static constexpr UINT_PTR REDRAW_TIMER_ID{ 1 };
 
 		HWND _windowHandle;
 		std::unique_ptr<wa::NotifyIcon> _notifyIcon;
@@ -89,7 +105,33 @@ namespace pingstats // export
 		wa::DeviceContext _deviceContext;
 		wa::MemoryCanvas _backBuffer;
 
+		// Has to outlive the sections, their monitors might use it.
+		std::unique_ptr<SimulatedNetwork> _simulatedNetwork;
+
 		std::vector<std::unique_ptr<Section>> _sections;
+		std::unique_ptr<StatsSegmentWriter> _statsSegment;
+		std::unique_ptr<ResultTraceWriter> _resultTrace;
+
+		// Sections have disjoint rects and own all their render state,
+		// so they are drawn into the back buffer in parallel.
+		std::unique_ptr<ut::WorkerPool> _renderPool;
+
+		// Frames are drawn when something changed rather than at a fixed 
+		// rate, and only the sections that changed are rendered. Nothing 
+		// is drawn while the window is hidden.
+		std::unique_ptr<RedrawScheduler> _redrawScheduler;
+		std::vector<std::uint8_t> _drawSection;
+		bool _backBufferValid{};
+
+		// Render timings, drawn over the top left corner when shown. The
+		// plotters only get the profiler while it is, so hidden timings 
+		// cost a pointer test per phase.
+		std::unique_ptr<RenderProfiler> _renderProfiler;
+		bool _showRenderTimings{};
+		GlyphAtlas _overlayAtlas{ makeBuiltinGlyphAtlas() };
+		wa::MemoryCanvas _overlayCanvas;
+		wa::DeviceContext _overlayContext;
+		RECT _overlayRect{};
 
 		int _sectionWidth{ 480 };
 		int _sectionHeight{ 320 };
@@ -105,15 +147,24 @@ namespace pingstats // export
 		cr::steady_clock::time_point _selectionTime;
 		bool _alwaysOnTop{ false };
 
-		ut::WaitableFlag _stopFlag;
-		ut::AutojoinThread _tickThread;
+		// Dragging with the middle button pans.
+		bool _panning{};
+		std::int32_t _panX{};
 
 		std::vector<std::future<void>> _writeOperations;
 
+		// Tracing is on from the start and dumped here on exit if set.
+		std::string _eventTracePath;
+
 	public:
 		~MainWindow()
 		{
-			_stopFlag.set();
+			KillTimer(_windowHandle, REDRAW_TIMER_ID);
+
+			if (!_eventTracePath.empty())
+			{
+				ut::eventTracer().writeJson(_eventTracePath);
+			}
 
 			for (auto& op : _writeOperations)
 			{
@@ -125,6 +176,7 @@ namespace pingstats // export
 			: _windowHandle{ windowHandle }
 			, _taskbarCreatedMessage{ RegisterWindowMessageW(L"TaskbarCreated") }
 			, _deviceContext{ CreateCompatibleDC(nullptr) }
+			, _overlayContext{ CreateCompatibleDC(nullptr) }
 		{
 			auto configFile{ ut::readFileAs<std::string>(CONFIG_FILEPATH) };
 
@@ -136,6 +188,21 @@ namespace pingstats // export
 			}
 
 			config.loadOrStore("clearColor", _clearColor);
+			config.loadOrStore("eventTracePath", _eventTracePath);
+
+			ut::eventTracer().setThreadName("ui");
+			ut::eventTracer().setEnabled(!_eventTracePath.empty());
+
+			auto& simcfg{ *config.findOrAppendNode("simulation") };
+
+			if (simcfg.loadOrStoreIndirect("enabled", false))
+			{
+				_simulatedNetwork = std::make_unique<SimulatedNetwork>(
+					SimulatedPathConfig{ *simcfg.findOrAppendNode("path") });
+			}
+
+			auto& transport{ _simulatedNetwork != nullptr ? 
+				static_cast<IcmpTransport&>(*_simulatedNetwork) : systemIcmpTransport() };
 
 			auto& hosts{ *config.findOrAppendNode("hosts") };
 
@@ -157,7 +224,7 @@ namespace pingstats // export
 					if (strpos == "auto")
 					{
 						_sections.push_back(std::make_unique<Section>(
-							*host, _windowHandle, _sections.size()));
+							*host, _windowHandle, _sections.size(), transport));
 					}
 					else
 					{
@@ -168,7 +235,8 @@ namespace pingstats // export
 							_sections.resize(1 + i);
 						}
 
-						_sections[i] = std::make_unique<Section>(*host, _windowHandle, i);
+						_sections[i] = std::make_unique<Section>(
+							*host, _windowHandle, i, transport);
 					}
 				}
 			}
@@ -205,19 +273,71 @@ namespace pingstats // export
 				_columns = size / _rows + (size % _rows > 0 ? 1 : 0);
 			}
 
+			auto statsSegmentName{ "pingstats-stats"s };
+			config.loadOrStore("statsSegmentName", statsSegmentName);
+
+			if (statsSegmentName.size() > 0)
+			{
+				createStatsSegment(statsSegmentName);
+			}
+
+			std::vector<std::string> sectionNames;
+
+			for (auto& section : _sections)
+			{
+				sectionNames.push_back(section != nullptr ? section->plotter.name() : "");
+			}
+
+			auto resultTracePath{ ""s };
+			config.loadOrStore("recordResultTrace", resultTracePath);
+
+			if (resultTracePath.size() > 0)
+			{
+				// Recording is optional, pinging goes on without it.
+				try
+				{
+					_resultTrace = std::make_unique<ResultTraceWriter>(resultTracePath, sectionNames);
+				}
+				catch (std::exception& e)
+				{
+					wa::showMessageBox("Warning", 
+						e.what() + " Continuing without recording results."s);
+				}
+			}
+
 			config.loadOrStore("sectionWidth", _sectionWidth);
 			config.loadOrStore("sectionHeight", _sectionHeight);
 			config.loadOrStore("alwaysOnTop", _alwaysOnTop);
 
-			remakeNotifyIcon();
-			resizeWindowToDefaultSize();
-			setAlwaysOnTop(_alwaysOnTop);
+			// 0 uses one thread per core, but never more than sections.
+			auto renderThreads{ 0 };
+			config.loadOrStore("renderThreads", renderThreads);
+
+			const auto threads{ renderThreads > 0 ? 
+				static_cast<std::size_t>(renderThreads) : 
+				static_cast<std::size_t>(std::thread::hardware_concurrency()) };
 
+			_renderPool = std::make_unique<ut::WorkerPool>(
+				std::max<std::size_t>(1, std::min(threads, _sections.size())));
+
+			// Upper bound, frames are only drawn when something changed.
 			auto refreshRate{ 30 };
 			config.loadOrStore("refreshRate", refreshRate);
 
 			refreshRate = std::min(240, std::max(1, refreshRate));
 
+			_redrawScheduler = std::make_unique<RedrawScheduler>(_sections.size(), refreshRate);
+			_drawSection.resize(_sections.size());
+
+			_renderProfiler = std::make_unique<RenderProfiler>(sectionNames);
+
+			config.loadOrStore("showRenderTimings", _showRenderTimings);
+			showRenderTimings(_showRenderTimings);
+
+			remakeNotifyIcon();
+			resizeWindowToDefaultSize();
+			setAlwaysOnTop(_alwaysOnTop);
+
 			ut::FileHandle file{ std::fopen(CONFIG_FILEPATH, "wt") };
 
 			if (file.get() != nullptr)
@@ -225,18 +345,79 @@ namespace pingstats // export
 				auto cfgstr{ serializeTreeConfig(config) };
 				std::fwrite(cfgstr.data(), 1, cfgstr.size(), file.get());
 			}
+		}
 
-			_tickThread = std::thread([this, refreshRate]
+		void createStatsSegment(const std::string& name)
+		{
+			try
+			{
+				_statsSegment = std::make_unique<StatsSegmentWriter>(name, _sections.size());
+			}
+			catch (std::exception& e)
 			{
-				const auto refreshInterval{ 
-					cr::duration_cast<cr::nanoseconds>(1.0_sf64 / refreshRate) };
+				// Most likely another instance owns the segment already.
+				// Publishing is optional, pinging goes on without it.
+				wa::showMessageBox("Warning", e.what() + 
+					" Continuing without publishing stats, an empty statsSegmentName turns it off."s);
+				return;
+			}
 
-				for (auto time{ cr::steady_clock::now() }; 
-					!_stopFlag.waitUntil(time); time += refreshInterval)
+			for (std::size_t i{}; i < _sections.size(); ++i)
+			{
+				if (_sections[i] != nullptr)
 				{
-					PostMessageW(_windowHandle, WM_REDRAW, 0, 0);
+					_statsSegment->setSectionName(i, _sections[i]->plotter.name());
 				}
-			});
+			}
+		}
+
+		// The stats are read through PingData's thread-safe interface, so 
+		// publishing doesn't depend on running on the thread that inserts.
+		void publishPingResult(std::size_t index, const IcmpEchoResult& result)
+		{
+			if (_statsSegment != nullptr)
+			{
+				const auto stats{ _sections[index]->data.loadStats() };
+
+				_statsSegment->writeSection(index, [&](StatsSegmentSection& section) {
+					storeSummary(section, stats);
+					StatsSegmentWriter::appendSample(section, makeSample(result));
+				});
+			}
+		}
+
+		void publishTraceResult(std::size_t index, const IcmpEchoResult& result)
+		{
+			if (_statsSegment != nullptr)
+			{
+				const auto stats{ _sections[index]->data.loadStats() };
+
+				_statsSegment->writeSection(index, [&](StatsSegmentSection& section) {
+					storeSummary(section, stats);
+					StatsSegmentWriter::appendTraceSample(section, makeSample(result));
+				});
+			}
+		}
+
+		static void storeSummary(StatsSegmentSection& section, const PingStats& stats)
+		{
+			section.responderIpv4 = static_cast<std::uint32_t>(stats.lastResponder.addr4());
+			section.pingResultCount = stats.pingResultCount;
+			section.lastPing = stats.lastPing;
+			section.meanPing = stats.meanPing;
+			section.maxPing = stats.maxPing;
+			section.jitter = stats.jitter;
+			section.lossPercentage = stats.lossPercentage;
+		}
+
+		static StatsSegmentSample makeSample(const IcmpEchoResult& result)
+		{
+			return StatsSegmentSample{
+				cr::duration_cast<cr::nanoseconds>(result.sentTime.time_since_epoch()).count(),
+				cr::duration_cast<cr::nanoseconds>(result.latency).count(),
+				result.errorCode,
+				result.statusCode,
+				static_cast<std::uint32_t>(result.responder.addr4()) };
 		}
 
 		void remakeNotifyIcon()
@@ -279,7 +460,7 @@ namespace pingstats // export
 			RECT rect;
 			GetClientRect(_windowHandle, &rect);
 
-			static constexpr LONG BORDER_WIDTH{ 8 };
+			static constexpr pxindex BORDER_WIDTH{ 8 };
 
 			const auto clientWidth{ rect.right - rect.left };
 			const auto clientHeight{ rect.bottom - rect.top };
@@ -295,22 +476,26 @@ namespace pingstats // export
 					const auto row{ static_cast<std::int32_t>(i % _rows) };
 					const auto col{ static_cast<std::int32_t>(i / _rows) };
 
-					const auto left{ fastround<LONG>(
+					const auto left{ fastround<pxindex>(
 						col * sectWidth + (1 + col) * BORDER_WIDTH) };
 
-					const auto top{ fastround<LONG>(
+					const auto top{ fastround<pxindex>(
 						row * sectHeight + (1 + row) * BORDER_WIDTH) };
 
-					const auto right{ left + static_cast<LONG>(sectWidth) };
-					const auto bottom{ top + static_cast<LONG>(sectHeight) };
+					const auto right{ left + static_cast<pxindex>(sectWidth) };
+					const auto bottom{ top + static_cast<pxindex>(sectHeight) };
 
 					_sections[i]->rect = Rect{ left, top, right, bottom };
 				}
 			}
 
+			// A bitmap that is still selected can't be deleted, which would 
+			// keep the old view of the pooled storage mapped.
+			_deviceContext.selectDefaults();
 			resizeCanvasPredictive(_backBuffer, clientWidth, clientHeight);
 
 			_deviceContext.select(_backBuffer.get());
+			_backBufferValid = false;
 		}
 
 		Section* findSection(int32_t mouseX, int32_t mouseY)
@@ -334,49 +519,324 @@ namespace pingstats // export
 		{
 			if (_selectedSection != nullptr)
 			{
-				const auto pixelsPerSecond{ _selectedSection->plotter.pixelsPerSecond() };
-
 				const auto pixelOffset{ _selectedSection->rect.right - x };
-				const auto offset{ pixelOffset / pixelsPerSecond };
 
-				_selectionTime = _selectionStart - cr::duration_cast
-					<cr::nanoseconds>(ut::seconds_f64{ offset });
+				_selectionTime = _selectedSection->plotter.timeAt(pixelOffset, _selectionStart);
 
 				PostMessageW(_windowHandle, WM_REDRAW, 0, 0);
 			}
 		}
 
+		// All sections zoom and pan together, so their time axes line up.
+		void zoomSections(double factor, int32_t x)
+		{
+			const auto now{ cr::steady_clock::now() };
+
+			for (auto& section : _sections)
+			{
+				if (section != nullptr)
+				{
+					section->plotter.zoom(factor, section->rect.right - x, now);
+				}
+			}
+
+			PostMessageW(_windowHandle, WM_REDRAW, 0, 0);
+		}
+
+		void panSections(int32_t x)
+		{
+			const auto now{ cr::steady_clock::now() };
+
+			for (auto& section : _sections)
+			{
+				if (section != nullptr)
+				{
+					section->plotter.pan(x - _panX, now);
+				}
+			}
+
+			_panX = x;
+			PostMessageW(_windowHandle, WM_REDRAW, 0, 0);
+		}
+
+		void resetSectionViews()
+		{
+			for (auto& section : _sections)
+			{
+				if (section != nullptr)
+				{
+					section->plotter.resetView();
+				}
+			}
+
+			PostMessageW(_windowHandle, WM_REDRAW, 0, 0);
+		}
+
+		bool isWindowShown()
+		{
+			BOOL cloaked{};
+			DwmGetWindowAttribute(_windowHandle, DWMWA_CLOAKED, &cloaked, sizeof cloaked);
+
+			return IsWindowVisible(_windowHandle) && !IsIconic(_windowHandle) && !cloaked;
+		}
+
+		// Draws the sections that are due, then arms the timer for when 
+		// the next ones are. Damage keeps accumulating while the window is
+		// hidden and is drawn once it is shown again.
+		void scheduleRedraw()
+		{
+			KillTimer(_windowHandle, REDRAW_TIMER_ID);
+
+			if (!isWindowShown())
+			{
+				return;
+			}
+
+			if (_redrawScheduler->nextFrame() <= cr::steady_clock::now())
+			{
+				drawDueSections(cr::steady_clock::now());
+			}
+
+			const auto next{ _redrawScheduler->nextFrame() };
+
+			if (next != RedrawScheduler::NEVER)
+			{
+				const auto delay{ cr::ceil<cr::milliseconds>(
+					next - cr::steady_clock::now()).count() };
+
+				SetTimer(_windowHandle, REDRAW_TIMER_ID, static_cast<UINT>(
+					std::max<decltype(delay)>(delay, USER_TIMER_MINIMUM)), nullptr);
+			}
+		}
+
+		void showRenderTimings(bool show)
+		{
+			_showRenderTimings = show;
+			_renderProfiler->clear();
+
+			for (auto& section : _sections)
+			{
+				if (section != nullptr)
+				{
+					section->plotter.setProfiler(show ? _renderProfiler.get() : nullptr);
+				}
+			}
+
+			// Either draws the overlay or brings back what was under it.
+			InvalidateRect(_windowHandle, &_overlayRect, false);
+			PostMessageW(_windowHandle, WM_REDRAW, 0, 0);
+		}
+
+		// The overlay is drawn straight to the window, over the back 
+		// buffer, so the sections under it don't have to be redrawn.
+		void drawRenderTimings(HDC deviceContext)
+		{
+			static constexpr pxindex MARGIN{ 4 };
+			static constexpr pxindex OFFSET{ 16 };
+
+			const auto& spacing{ _overlayAtlas.getFontSpacing() };
+			const auto header{ RenderProfiler::header() };
+			const auto lines{ static_cast<pxindex>(_renderProfiler->channelCount() + 1) };
+			const auto width{ _overlayAtlas.textWidth(header) + 2 * MARGIN };
+			const auto height{ lines * spacing.fontLineSpacing + 2 * MARGIN };
+
+			if (_overlayCanvas.width() != width || _overlayCanvas.height() != height)
+			{
+				_overlayContext.selectDefaults();
+				resizeCanvas(_overlayCanvas, width, height);
+				_overlayContext.select(_overlayCanvas.get());
+			}
+
+			const Color clearColor{ 0, 0, 0 };
+			const Color textColor{ 220, 220, 220 };
+
+			clearCanvas(_overlayCanvas, clearColor);
+			_overlayAtlas.draw(_overlayCanvas, clearColor, textColor, MARGIN, MARGIN, header);
+
+			ut::FixedString<64> line;
+
+			for (std::size_t i{}; i < _renderProfiler->channelCount(); ++i)
+			{
+				_renderProfiler->formatLine(line, i);
+				_overlayAtlas.draw(_overlayCanvas, clearColor, textColor, MARGIN, 
+					MARGIN + static_cast<pxindex>(i + 1) * spacing.fontLineSpacing, line.view());
+			}
+
+			_overlayRect = RECT{ OFFSET, OFFSET, OFFSET + width, OFFSET + height };
+
+			BitBlt(deviceContext, OFFSET, OFFSET, width, height, 
+				_overlayContext.get(), 0, 0, SRCCOPY);
+		}
+
+		// Empty if the dialog was cancelled.
+		static std::string askSaveFilename(
+			HWND hwnd, const wchar_t* defaultName, const wchar_t* filter)
+		{
+			constexpr DWORD FN_SIZE{ 512 };
+			wchar_t filename[FN_SIZE]{};
+			std::wstring_view{ defaultName }.copy(filename, FN_SIZE - 1);
+
+			OPENFILENAMEW saveFile = { sizeof saveFile };
+			saveFile.hwndOwner = hwnd;
+			saveFile.lpstrFilter = filter;
+			saveFile.lpstrFile = filename;
+			saveFile.nMaxFile = FN_SIZE;
+			saveFile.Flags = OFN_LONGNAMES 
+				| OFN_OVERWRITEPROMPT 
+				| OFN_PATHMUSTEXIST;
+
+			return GetSaveFileNameW(&saveFile) ? wa::utf8(filename) : std::string{};
+		}
+
+		void saveRenderTimings(HWND hwnd)
+		{
+			const auto filename{ askSaveFilename(hwnd, 
+				L"pingstats-render-timings.txt", L".txt\0*.txt\0") };
+
+			if (!filename.empty())
+			{
+				ut::FileHandle file{ std::fopen(filename.c_str(), "wb") };
+
+				if (file.get() != nullptr)
+				{
+					const auto timings{ _renderProfiler->format() };
+					std::fwrite(timings.data(), 1, timings.size(), file.get());
+				}
+				else
+				{
+					wa::showMessageBox("Error", "Failed to open file.");
+				}
+			}
+		}
+
+		void saveEventTrace(HWND hwnd)
+		{
+			const auto filename{ askSaveFilename(hwnd, 
+				L"pingstats-trace.json", L".json\0*.json\0") };
+
+			if (!filename.empty() && !ut::eventTracer().writeJson(filename))
+			{
+				wa::showMessageBox("Error", "Failed to write file.");
+			}
+		}
+
+		void drawDueSections(cr::steady_clock::time_point now)
+		{
+			if (!_backBufferValid)
+			{
+				InvalidateRect(_windowHandle, nullptr, false);
+			}
+
+			if (_showRenderTimings)
+			{
+				InvalidateRect(_windowHandle, &_overlayRect, false);
+			}
+
+			for (std::size_t i{}; i < _sections.size(); ++i)
+			{
+				if (_sections[i] != nullptr && _redrawScheduler->isDue(i, now))
+				{
+					const auto& rect{ _sections[i]->rect };
+					const RECT invalid{ rect.left, rect.top, rect.right, rect.bottom };
+
+					_drawSection[i] = 1;
+					InvalidateRect(_windowHandle, &invalid, false);
+				}
+			}
+
+			UpdateWindow(_windowHandle);
+
+			_redrawScheduler->frameDrawn(now);
+
+			// Selection freezes time, only input changes the picture then.
+			if (_selectedSection == nullptr)
+			{
+				for (std::size_t i{}; i < _sections.size(); ++i)
+				{
+					if (_sections[i] != nullptr)
+					{
+						_redrawScheduler->invalidate(i, _sections[i]->plotter.nextRedrawTime(now));
+					}
+				}
+			}
+		}
+
 		void drawWindow(HWND hwnd)
 		{
+			PINGSTATS_TRACE_SCOPE("paint", 0);
+
 			wa::PaintLock paintLock{ hwnd };
 
+			const auto profiler{ _showRenderTimings ? _renderProfiler.get() : nullptr };
+
 			if (_backBuffer.width() > 8 && _backBuffer.height() > 8)
 			{
-				clearCanvas(_backBuffer, _clearColor);
+				ProfileScope frameScope{ profiler, RenderPhase::FRAME };
+
+				if (!_backBufferValid)
+				{
+					clearCanvas(_backBuffer, _clearColor);
+
+					for (std::size_t i{}; i < _sections.size(); ++i)
+					{
+						if (_sections[i] != nullptr)
+						{
+							_sections[i]->plotter.invalidate();
+							_drawSection[i] = 1;
+						}
+					}
+
+					_backBufferValid = true;
+				}
 
 				const bool drawSelectionLine{ _selectedSection != nullptr };
 
 				const auto now{ 
 					drawSelectionLine ? _selectionStart : cr::steady_clock::now() };
 
-				for (auto& section : _sections)
 				{
-					if (section != nullptr)
-					{
-						section->plotter.redraw(
-							_backBuffer, 
-							section->rect, 
-							section->data,
-							now, 
-							_selectionTime, 
-							drawSelectionLine, 
-							_clearColor);
-					}
+					ProfileScope scope{ profiler, RenderPhase::SECTIONS };
+
+					_renderPool->forEach(_sections.size(), [&](std::size_t i) {
+						if (_sections[i] != nullptr && _drawSection[i] != 0)
+						{
+							PINGSTATS_TRACE_SCOPE("render section", i);
+							ProfileScope scope{ profiler, RenderProfiler::sectionChannel(i) };
+
+							_sections[i]->plotter.redraw(
+								_backBuffer, 
+								_sections[i]->rect, 
+								_sections[i]->data,
+								now, 
+								_selectionTime, 
+								drawSelectionLine);
+						}
+					});
+				}
+
+				if (profiler != nullptr)
+				{
+					profiler->endFrame();
 				}
 
-				BitBlt(paintLock.deviceContext(), 0, 0,
-					_backBuffer.width(), _backBuffer.height(),
-					_deviceContext.get(), 0, 0, SRCCOPY);
+				std::fill(_drawSection.begin(), _drawSection.end(), std::uint8_t{});
+
+				// Everything else in the back buffer is still up to date.
+				const auto& paintRect{ paintLock.paintRect() };
+
+				ProfileScope scope{ profiler, RenderPhase::BLIT };
+
+				BitBlt(paintLock.deviceContext(), 
+					paintRect.left, paintRect.top,
+					paintRect.right - paintRect.left, 
+					paintRect.bottom - paintRect.top,
+					_deviceContext.get(), 
+					paintRect.left, paintRect.top, SRCCOPY);
+			}
+
+			if (_showRenderTimings)
+			{
+				drawRenderTimings(paintLock.deviceContext());
 			}
 		}
 
@@ -426,19 +886,68 @@ namespace pingstats // export
 
 			case WM_REDRAW:
 			{
-				RedrawWindow(hwnd, nullptr, nullptr, RDW_INVALIDATE | RDW_UPDATENOW);
+				_redrawScheduler->invalidateAll(cr::steady_clock::now());
+				scheduleRedraw();
+			}	return{ 0 };
+
+			case WM_TIMER:
+			{
+				if (wparam != REDRAW_TIMER_ID)
+				{
+					break;
+				}
+
+				PINGSTATS_TRACE_SCOPE("redraw timer", 0);
+				scheduleRedraw();
 			}	return{ 0 };
 
+			case WM_SHOWWINDOW:
+			{
+				if (wparam)
+				{
+					PostMessageW(hwnd, WM_REDRAW, 0, 0);
+				}
+			}	break;
+
 			case WM_TRACE_RESULT:
 			{
-				_sections[wparam]->data.insertTraceResult(
-					*reinterpret_cast<IcmpEchoResult*>(lparam));
+				PINGSTATS_TRACE_SCOPE("trace result", wparam);
+
+				const auto& result{ *reinterpret_cast<IcmpEchoResult*>(lparam) };
+
+				_sections[wparam]->data.insertTraceResult(result);
+
+				publishTraceResult(wparam, result);
+
+				if (_resultTrace != nullptr)
+				{
+					_resultTrace->write(ResultKind::TRACE, wparam, result);
+				}
+
+				_redrawScheduler->invalidate(wparam, cr::steady_clock::now());
+				scheduleRedraw();
 			}	return{ 0 };
 
 			case WM_PING_RESULT:
 			{
-				_sections[wparam]->data.insertPingResult(
-					*reinterpret_cast<IcmpEchoResult*>(lparam));
+				PINGSTATS_TRACE_SCOPE("ping result", wparam);
+
+				const auto& result{ *reinterpret_cast<IcmpEchoResult*>(lparam) };
+
+				{
+					PINGSTATS_TRACE_SCOPE("insertPingResult", wparam);
+					_sections[wparam]->data.insertPingResult(result);
+				}
+
+				publishPingResult(wparam, result);
+
+				if (_resultTrace != nullptr)
+				{
+					_resultTrace->write(ResultKind::PING, wparam, result);
+				}
+
+				_redrawScheduler->invalidate(wparam, cr::steady_clock::now());
+				scheduleRedraw();
 			}	return{ 0 };
 
 			case WM_CRITICAL_PING_MONITOR_ERROR:
@@ -484,9 +993,37 @@ namespace pingstats // export
 				PostMessageW(hwnd, WM_REDRAW, 0, 0);
 			}	return{ 0 };
 
+			case WM_MBUTTONDOWN:
+			{
+				_panning = true;
+				_panX = GET_X_LPARAM(lparam);
+			}	return{ 0 };
+
+			case WM_MBUTTONUP:
+			{
+				_panning = false;
+			}	return{ 0 };
+
 			case WM_MOUSEMOVE:
 			{
-				setSelectedTimeAndRedraw(GET_X_LPARAM(lparam));
+				if (_panning && (wparam & MK_MBUTTON) != 0)
+				{
+					panSections(GET_X_LPARAM(lparam));
+				}
+				else
+				{
+					setSelectedTimeAndRedraw(GET_X_LPARAM(lparam));
+				}
+			}	return{ 0 };
+
+			case WM_MOUSEWHEEL:
+			{
+				POINT cpt{ GET_X_LPARAM(lparam), GET_Y_LPARAM(lparam) };
+				ScreenToClient(hwnd, &cpt);
+
+				// Wheel up zooms in, by a quarter per notch.
+				const auto notches{ GET_WHEEL_DELTA_WPARAM(wparam) / static_cast<double>(WHEEL_DELTA) };
+				zoomSections(std::pow(1.25, -notches), cpt.x);
 			}	return{ 0 };
 
 			case WM_CONTEXTMENU:
@@ -543,31 +1080,71 @@ namespace pingstats // export
 				{
 					if (selection != nullptr)
 					{
-						constexpr DWORD FN_SIZE{ 512 };
-						wchar_t filename[FN_SIZE] = L"pingstats-log.txt";
-
-						OPENFILENAMEW saveFile = { sizeof saveFile };
-						saveFile.hwndOwner = hwnd;
-						saveFile.lpstrFilter = L".txt\0*.txt\0";
-						saveFile.lpstrFile = filename;
-						saveFile.nMaxFile = FN_SIZE;
-						saveFile.Flags = OFN_LONGNAMES 
-							| OFN_OVERWRITEPROMPT 
-							| OFN_PATHMUSTEXIST;
-
-						if (GetSaveFileNameW(&saveFile))
+						const auto filename{ askSaveFilename(hwnd, 
+							L"pingstats-log.txt", L".txt\0*.txt\0") };
+
+						if (!filename.empty())
 						{
-							asyncWriteLogToFile(wa::utf8(filename), 
+							asyncWriteLogToFile(filename, 
 								selection->data.traceResults(), 
 								selection->data.pingResults());
 						}
 					}
 				}	break;
 
+				case CONTEXT_MENU_RESET_ZOOM:
+				{
+					resetSectionViews();
+				}	break;
+
+				case CONTEXT_MENU_LATENCY_HEATMAP:
+				{
+					if (selection != nullptr)
+					{
+						selection->plotter.setMode(
+							selection->plotter.mode() == PlotMode::HEATMAP ? 
+							PlotMode::LINE : PlotMode::HEATMAP);
+
+						PostMessageW(hwnd, WM_REDRAW, 0, 0);
+					}
+				}	break;
+
+				case CONTEXT_MENU_LOG_SCALE:
+				{
+					if (selection != nullptr)
+					{
+						selection->plotter.setScaleMode(
+							selection->plotter.scaleMode() == ScaleMode::LOG ? 
+							ScaleMode::LINEAR : ScaleMode::LOG);
+
+						PostMessageW(hwnd, WM_REDRAW, 0, 0);
+					}
+				}	break;
+
 				case CONTEXT_MENU_ALWAYS_ON_TOP:
 				{
 					setAlwaysOnTop((_alwaysOnTop = !_alwaysOnTop));
 				}	break;
+
+				case CONTEXT_MENU_RENDER_TIMINGS:
+				{
+					showRenderTimings(!_showRenderTimings);
+				}	break;
+
+				case CONTEXT_MENU_SAVE_RENDER_TIMINGS:
+				{
+					saveRenderTimings(hwnd);
+				}	break;
+
+				case CONTEXT_MENU_EVENT_TRACING:
+				{
+					ut::eventTracer().setEnabled(!ut::eventTracer().enabled());
+				}	break;
+
+				case CONTEXT_MENU_SAVE_EVENT_TRACE:
+				{
+					saveEventTrace(hwnd);
+				}	break;
 				}
 			}	return{ 0 };
 
@@ -0,0 +1,405 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/utility.hpp"
+#include "utility/event_trace.hpp"
+#include "utility/scoped_thread.hpp"
+#include "utility/stopwatch.hpp"
+#include "utility/tree_config.hpp"
+#include "winapi/utility.hpp"
+#include "icmp.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace pingstats // export
+{
+	using namespace utility::literals;
+
+	namespace cr = std::chrono;
+	namespace ut = utility;
+	namespace wa = winapi;
+
+	class SimulatedPathConfig
+	{
+	public:
+		std::string latencyDistribution{ "lognormal" }; // "normal" or "lognormal"
+		double latencyMs{ 20.0 };
+		double jitterMs{ 2.0 };
+
+		// Gilbert-Elliott loss model: independent loss while in the good
+		// state, burst loss while in the bad state.
+		double lossProbability{ 0.005 };
+		double burstStartProbability{ 0.002 };
+		double burstEndProbability{ 0.2 };
+		double burstLossProbability{ 1.0 };
+
+		double reorderProbability{ 0.01 };
+		double reorderDelayMs{ 30.0 };
+
+		std::uint32_t privateHops{ 2 };
+		std::uint32_t publicHops{ 4 };
+
+		std::uint64_t seed{ 1 };
+
+		SimulatedPathConfig() = default;
+
+		SimulatedPathConfig(ut::TreeConfigNode& config)
+		{
+			config.loadOrStore("latencyDistribution", latencyDistribution);
+			config.loadOrStore("latencyMs", latencyMs);
+			config.loadOrStore("jitterMs", jitterMs);
+			config.loadOrStore("lossProbability", lossProbability);
+			config.loadOrStore("burstStartProbability", burstStartProbability);
+			config.loadOrStore("burstEndProbability", burstEndProbability);
+			config.loadOrStore("burstLossProbability", burstLossProbability);
+			config.loadOrStore("reorderProbability", reorderProbability);
+			config.loadOrStore("reorderDelayMs", reorderDelayMs);
+			config.loadOrStore("privateHops", privateHops);
+			config.loadOrStore("publicHops", publicHops);
+			config.loadOrStore("seed", seed);
+		}
+	};
+
+	class SimulationStats
+	{
+	public:
+		std::uint64_t probes;
+		std::uint64_t replies;
+		std::uint64_t timeouts;
+		double meanAbsErrorMs;
+		double maxAbsErrorMs;
+	};
+
+	// In-process stand-in for the network. Replies are signalled from a
+	// scheduler thread after a latency drawn from the configured model, 
+	// so PingMonitor and traceRoute run unmodified against it.
+	class SimulatedNetwork : public IcmpTransport
+	{
+		class Probe
+		{
+		public:
+			wa::HandlePtr event;
+			cr::steady_clock::time_point deadline;
+			cr::steady_clock::time_point deliveredTime;
+			IpEndPoint responder;
+			std::uint32_t statusCode{};
+		};
+
+		using ProbePtr = std::shared_ptr<Probe>;
+
+		struct LaterDeadline
+		{
+			bool operator () (const ProbePtr& lhs, const ProbePtr& rhs) const
+			{
+				return lhs->deadline > rhs->deadline;
+			}
+		};
+
+		class PathState
+		{
+		public:
+			bool inBurst{};
+		};
+
+		SimulatedPathConfig _config;
+		std::vector<IpEndPoint> _hops;
+
+		std::mutex _mutex;
+		std::condition_variable _wakeup;
+		std::priority_queue<ProbePtr, std::vector<ProbePtr>, LaterDeadline> _schedule;
+		std::unordered_map<const IcmpEchoContext*, ProbePtr> _probes;
+		std::map<IPAddr, PathState> _paths;
+		std::mt19937_64 _random;
+		bool _stop{};
+
+		std::uint64_t _probeCount{};
+		std::uint64_t _replyCount{};
+		std::uint64_t _timeoutCount{};
+		double _absErrorSumMs{};
+		double _maxAbsErrorMs{};
+
+		ut::AutojoinThread _thread;
+
+	public:
+		~SimulatedNetwork()
+		{
+			{
+				std::lock_guard<std::mutex> lock{ _mutex };
+				_stop = true;
+			}
+
+			_wakeup.notify_all();
+		}
+
+		SimulatedNetwork(SimulatedNetwork&&) = delete;
+
+		SimulatedNetwork(const SimulatedPathConfig& config)
+			: _config{ config }
+			, _random{ config.seed }
+		{
+			for (std::uint32_t i{}; i < _config.privateHops; ++i)
+			{
+				_hops.push_back(IpEndPoint{ htonl(0xC0A80001 + (i << 8)) }); // 192.168.i.1
+			}
+
+			for (std::uint32_t i{}; i < _config.publicHops; ++i)
+			{
+				_hops.push_back(IpEndPoint{ htonl(0xC6336401 + i) }); // 198.51.100.(1 + i)
+			}
+
+			_thread = std::thread([this] { run(); });
+		}
+
+		std::unique_ptr<IcmpEchoContext> asyncSendEcho(
+			IpEndPoint target,
+			IpEndPoint,
+			DWORD timeoutMs,
+			UCHAR ttl) override
+		{
+			auto context{ std::make_unique<IcmpEchoContext>() };
+			auto probe{ std::make_shared<Probe>() };
+
+			context->timoutMs = timeoutMs;
+			context->sentTime = cr::steady_clock::now();
+
+			if (ttl == 0)
+			{
+				context->errorCode = ERROR_INVALID_PARAMETER;
+				return context;
+			}
+
+			HANDLE event;
+
+			if (!DuplicateHandle(GetCurrentProcess(), context->event.get(), 
+				GetCurrentProcess(), &event, 0, false, DUPLICATE_SAME_ACCESS))
+			{
+				throw wa::WindowsError{ "DuplicateHandle()" };
+			}
+
+			probe->event.reset(event);
+
+			{
+				std::lock_guard<std::mutex> lock{ _mutex };
+
+				const auto latencyMs{ routeProbe(*probe, target, ttl) };
+				const auto lost{ latencyMs < 0.0 || latencyMs >= timeoutMs };
+
+				probe->deadline = context->sentTime + cr::duration_cast<cr::nanoseconds>(
+					ut::milliseconds_f64{ lost ? timeoutMs : latencyMs });
+
+				if (lost)
+				{
+					probe->statusCode = IP_REQ_TIMED_OUT;
+				}
+
+				_probeCount += 1;
+				_probes[context.get()] = probe;
+				_schedule.push(std::move(probe));
+			}
+
+			_wakeup.notify_one();
+
+			context->errorCode = ERROR_IO_PENDING;
+
+			return context;
+		}
+
+		IcmpEchoResult makeResult(
+			const IcmpEchoContext& context,
+			cr::steady_clock::time_point replyTime) override
+		{
+			IcmpEchoResult result{};
+
+			result.sentTime = context.sentTime;
+			result.latency = replyTime - context.sentTime;
+			result.errorCode = context.errorCode;
+			result.statusCode = IP_REQ_TIMED_OUT;
+
+			std::lock_guard<std::mutex> lock{ _mutex };
+
+			const auto it{ _probes.find(&context) };
+
+			if (it != _probes.end())
+			{
+				const auto& probe{ *it->second };
+				const auto delivered{ probe.deliveredTime != cr::steady_clock::time_point{} };
+
+				// Lost probes and probes the engine stopped waiting for before the 
+				// scheduler got to them are timeouts, there is no latency to compare.
+				if (!delivered || probe.statusCode == IP_REQ_TIMED_OUT)
+				{
+					_timeoutCount += 1;
+				}
+				else
+				{
+					// The scheduler signals at the simulated reply time, whatever the 
+					// engine measures beyond that is its own measurement error.
+					const auto truth{ probe.deliveredTime - context.sentTime };
+					const auto errorMs{ std::abs(ut::milliseconds_f64{ result.latency - truth }.count()) };
+
+					_absErrorSumMs += errorMs;
+					_maxAbsErrorMs = std::max(_maxAbsErrorMs, errorMs);
+					_replyCount += 1;
+
+					result.statusCode = probe.statusCode;
+					result.responder = probe.responder;
+					result.sysLatency = static_cast<std::uint32_t>(
+						cr::duration_cast<cr::milliseconds>(truth).count());
+				}
+
+				_probes.erase(it);
+			}
+
+			return result;
+		}
+
+		void abandon(const IcmpEchoContext& context) override
+		{
+			// The scheduler still signals the probe's own event handle later.
+			std::lock_guard<std::mutex> lock{ _mutex };
+			_probes.erase(&context);
+		}
+
+		SimulationStats stats()
+		{
+			std::lock_guard<std::mutex> lock{ _mutex };
+
+			return SimulationStats{
+				_probeCount,
+				_replyCount,
+				_timeoutCount,
+				_replyCount > 0 ? _absErrorSumMs / _replyCount : 0.0,
+				_maxAbsErrorMs };
+		}
+
+	private:
+		// Returns the simulated round trip time in ms, or a negative value if lost.
+		double routeProbe(Probe& probe, IpEndPoint target, UCHAR ttl)
+		{
+			const auto hopCount{ static_cast<std::size_t>(_hops.size()) };
+			auto hop{ hopCount };
+
+			for (std::size_t i{}; i < hopCount; ++i)
+			{
+				if (_hops[i] == target)
+				{
+					hop = i;
+				}
+			}
+
+			auto distance{ hop + 1 };
+
+			if (ttl < distance)
+			{
+				distance = ttl;
+				hop = distance - 1;
+				probe.statusCode = IP_TTL_EXPIRED_TRANSIT;
+				probe.responder = _hops[hop];
+			}
+			else
+			{
+				probe.statusCode = IP_SUCCESS;
+				probe.responder = target;
+			}
+
+			auto& path{ _paths[target.addr4()] };
+			std::uniform_real_distribution<double> uniform;
+
+			path.inBurst = path.inBurst ?
+				uniform(_random) >= _config.burstEndProbability :
+				uniform(_random) < _config.burstStartProbability;
+
+			const auto lossProbability{ path.inBurst ?
+				_config.burstLossProbability : _config.lossProbability };
+
+			if (uniform(_random) < lossProbability)
+			{
+				return -1.0;
+			}
+
+			const auto scale{ distance / (1.0 + hopCount) };
+			const auto mean{ std::max(0.01, _config.latencyMs * scale) };
+			const auto sd{ std::max(0.0, _config.jitterMs * scale) };
+
+			auto latencyMs{ mean };
+
+			if (_config.latencyDistribution == "normal")
+			{
+				latencyMs = std::normal_distribution<double>{ mean, sd }(_random);
+			}
+			else if (sd > 0.0)
+			{
+				const auto variance{ std::log(1.0 + (sd * sd) / (mean * mean)) };
+
+				latencyMs = std::lognormal_distribution<double>{
+					std::log(mean) - variance / 2.0, std::sqrt(variance) }(_random);
+			}
+
+			if (uniform(_random) < _config.reorderProbability)
+			{
+				latencyMs += uniform(_random) * _config.reorderDelayMs;
+			}
+
+			return std::max(0.0, latencyMs);
+		}
+
+		void run()
+		{
+			ut::eventTracer().setThreadName("network simulator");
+
+			std::unique_lock<std::mutex> lock{ _mutex };
+
+			while (!_stop)
+			{
+				if (_schedule.empty())
+				{
+					_wakeup.wait(lock);
+					continue;
+				}
+
+				const auto deadline{ _schedule.top()->deadline };
+
+				if (cr::steady_clock::now() < deadline)
+				{
+					_wakeup.wait_until(lock, deadline);
+					continue;
+				}
+
+				const auto probe{ _schedule.top() };
+				_schedule.pop();
+
+				probe->deliveredTime = cr::steady_clock::now();
+				SetEvent(probe->event.get());
+			}
+		}
+	};
+}
@@ -24,8 +24,17 @@
 #pragma once
 
 #include "utility/utility.hpp"
-#include "ping_monitor.hpp"
-
+#include "utility/seqlock.hpp"
+#include "utility/stopwatch.hpp"
+#include "utility/tree_config.hpp"
+#include "echo_result.hpp"
+#include "latency_pyramid.hpp"
+#include "windowed_quantiles.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -36,14 +45,55 @@ namespace pingstats // export
 	namespace cr = std::chrono;
 	namespace ut = utility;
 
+	// Plain copyable summary of a PingData, published after every insertion
+	// so threads other than the writer can read it without locking.
+	struct PingStats
+	{
+		IpEndPoint lastResponder;
+		std::size_t pingResultCount;
+		double lastPing;
+		double meanPing;
+		double maxPing;
+		double jitter;
+		double lossPercentage;
+	};
+
 	class PingData
 	{
+		static constexpr std::size_t MAX_LATE_INSERTIONS{ 256 };
+
+		// Both histories reserve their maximum size up front and never
+		// reallocate, so readers on other threads can walk them in place
+		// while every modification is bracketed by _historyLock.
+
 		std::vector<IcmpEchoResult> _traceResults;
 		std::vector<IcmpEchoResult> _pingResults;
 		const IcmpEchoResult* _lastResult{};
 
+		// Parallel to _pingResults, the rolling p10 and p90 as of each
+		// result's arrival, for the band behind the plot.
+		std::vector<LatencyBand> _latencyBands;
+		LatencyBandWindow _bandWindow;
+
+		// Results that were inserted before the end of _pingResults, by 
+		// insertion number, so views that draw incrementally can find the
+		// ones that landed in what they already drew. Only the most recent
+		// are kept, _lateInsertionsLost is the last number that was dropped.
+		struct LateInsertion
+		{
+			std::uint64_t insertion;
+			cr::steady_clock::time_point sentTime;
+		};
+
+		std::vector<LateInsertion> _lateInsertions;
+		std::uint64_t _insertionCount{};
+		std::uint64_t _lateInsertionsLost{};
+
 		std::size_t _historySize = { 2 * 3600 };
 
+		// Reaches further back than the histories, for zooming out.
+		LatencyPyramid _pyramid;
+
 		std::string _lastResponder;
 
 		double _meanWeight{ 80.0 };
@@ -57,9 +107,11 @@ namespace pingstats // export
 		double _jitter{};
 		double _loss{};
 		double _lossPercentage{};
-		double _pixelPerMs{ 1.0 };
-		double _pingOffsetMs{};
-		double _gridSizeY{ 50.0 };
+
+		ut::SeqLockValue<PingStats> _publishedStats;
+		ut::SeqLock _historyLock;
+		std::atomic<std::size_t> _publishedPingCount{};
+		std::atomic<std::size_t> _publishedTraceCount{};
 
 	public:
 		PingData(ut::TreeConfigNode& config)
@@ -70,6 +122,24 @@ namespace pingstats // export
 			statscfg.loadOrStore("averagePingWeight", _meanWeight);
 			statscfg.loadOrStore("averageJitterWeight", _jitterWeight);
 			statscfg.loadOrStore("averageLossWeight", _lossWeight);
+
+			auto percentileWindow{ 60 };
+			statscfg.loadOrStore("percentileWindow", percentileWindow);
+
+			_bandWindow = LatencyBandWindow{ static_cast<std::size_t>(std::max(percentileWindow, 1)) };
+
+			auto zoomHistoryHours{ 7 * 24 };
+			statscfg.loadOrStore("zoomHistoryHours", zoomHistoryHours);
+
+			_pyramid = LatencyPyramid{ static_cast<std::size_t>(std::max(zoomHistoryHours, 1)) * 3600 };
+
+			_historySize = std::max<std::size_t>(_historySize, 1);
+
+			_pingResults.reserve(_historySize * 2);
+			_latencyBands.reserve(_historySize * 2);
+			_traceResults.reserve(_historySize * 2);
+
+			publishStats(IpEndPoint{});
 		}
 
 		auto lastResult() const
@@ -87,6 +157,43 @@ namespace pingstats // export
 			return _pingResults;
 		}
 
+		auto& latencyBands() const
+		{
+			return _latencyBands;
+		}
+
+		auto& pyramid() const
+		{
+			return _pyramid;
+		}
+
+		// Number of ping results inserted so far.
+		auto insertionCount() const
+		{
+			return _insertionCount;
+		}
+
+		// Calls f(sentTime) for every ping result among those inserted after
+		// the first `since` that didn't go to the end of the history. Returns
+		// false if some of them have been forgotten, callers then have to 
+		// start over.
+		template <typename F>
+		bool forEachLateInsertion(std::uint64_t since, F&& f) const
+		{
+			if (since < _lateInsertionsLost)
+			{
+				return false;
+			}
+
+			for (auto it{ _lateInsertions.rbegin() }; 
+				it != _lateInsertions.rend() && it->insertion > since; ++it)
+			{
+				f(it->sentTime);
+			}
+
+			return true;
+		}
+
 		auto& lastResponder() const
 		{
 			return _lastResponder;
@@ -102,6 +209,11 @@ namespace pingstats // export
 			return _meanPing;
 		}
 
+		auto maxPing() const
+		{
+			return _maxPing;
+		}
+
 		auto jitter() const
 		{
 			return _jitter;
@@ -112,25 +224,42 @@ namespace pingstats // export
 			return _lossPercentage;
 		}
 
-		auto gridSizeY() const
+		// The accessors above are for the writer thread only,
+		// the functions below may be called from any thread.
+
+		PingStats loadStats() const
 		{
-			return _gridSizeY;
+			return _publishedStats.load();
 		}
 
-		auto pixelPerMs() const
+		// reader(const IcmpEchoResult* results, std::size_t size) sees a
+		// consistent history, but may be invoked more than once.
+		template <typename Reader>
+		auto readPingResults(Reader&& reader) const
 		{
-			return _pixelPerMs;
+			const auto base{ _pingResults.data() };
+
+			return _historyLock.read([&] {
+				return reader(base, _publishedPingCount.load(std::memory_order_relaxed));
+			});
 		}
 
-		auto pingOffsetMs() const
+		template <typename Reader>
+		auto readTraceResults(Reader&& reader) const
 		{
-			return _pingOffsetMs;
+			const auto base{ _traceResults.data() };
+
+			return _historyLock.read([&] {
+				return reader(base, _publishedTraceCount.load(std::memory_order_relaxed));
+			});
 		}
 
 		void insertPingResult(const IcmpEchoResult& echoResult)
 		{
 			_lastResponder = echoResult.responder.name();
 
+			_historyLock.beginWrite();
+
 			// Usually near the end.
 			auto insertionPoint{ std::upper_bound(
 				_pingResults.begin(),
@@ -141,6 +270,7 @@ namespace pingstats // export
 				}
 			) };
 
+			const auto offset{ insertionPoint - _pingResults.begin() };
 			const auto& result{ *_pingResults.insert(insertionPoint, echoResult) };
 			const auto isLost{ result.errorCode != 0 || result.statusCode != 0 };
 			const auto lw{ std::max(1.0 / _lossWeight, 1.0 / _pingResults.size()) };
@@ -151,23 +281,52 @@ namespace pingstats // export
 			if (!isLost)
 			{
 				calculateStats(result);
+				_bandWindow.push(_lastPing);
+			}
+
+			_latencyBands.insert(_latencyBands.begin() + offset, _bandWindow.band());
+
+			++_insertionCount;
+
+			if (static_cast<std::size_t>(offset) + 1 < _pingResults.size())
+			{
+				if (_lateInsertions.size() >= MAX_LATE_INSERTIONS)
+				{
+					const auto dropped{ _lateInsertions.size() / 2 };
+
+					_lateInsertionsLost = _lateInsertions[dropped - 1].insertion;
+					_lateInsertions.erase(_lateInsertions.begin(), _lateInsertions.begin() + dropped);
+				}
+
+				_lateInsertions.push_back({ _insertionCount, result.sentTime });
 			}
 
 			if (_pingResults.size() >= _historySize * 2)
 			{
 				std::copy(_pingResults.end() - _historySize, 
 					_pingResults.end(), _pingResults.begin());
+				std::copy(_latencyBands.end() - _historySize, 
+					_latencyBands.end(), _latencyBands.begin());
 
 				_pingResults.resize(_historySize);
+				_latencyBands.resize(_historySize);
 			}
 
+			_publishedPingCount.store(_pingResults.size(), std::memory_order_relaxed);
+			_historyLock.endWrite();
+
 			_lastResult = &_pingResults.back();
+			_pyramid.insert(echoResult);
+
+			publishStats(echoResult.responder);
 		}
 
 		void insertTraceResult(const IcmpEchoResult& traceResult)
 		{
 			_lastResponder = traceResult.responder.name();
 
+			_historyLock.beginWrite();
+
 			_traceResults.push_back(std::move(traceResult));
 
 			if (_traceResults.size() >= _historySize * 2)
@@ -178,10 +337,30 @@ namespace pingstats // export
 				_traceResults.resize(_historySize);
 			}
 
+			_publishedTraceCount.store(_traceResults.size(), std::memory_order_relaxed);
+			_historyLock.endWrite();
+
 			_lastResult = &_traceResults.back();
+
+			publishStats(traceResult.responder);
 		}
 
 	private:
+		void publishStats(IpEndPoint lastResponder)
+		{
+			PingStats stats;
+
+			stats.lastResponder = lastResponder;
+			stats.pingResultCount = _pingResults.size();
+			stats.lastPing = _lastPing;
+			stats.meanPing = _meanPing;
+			stats.maxPing = _maxPing;
+			stats.jitter = _jitter;
+			stats.lossPercentage = _lossPercentage;
+
+			_publishedStats.store(stats);
+		}
+
 		void calculateStats(const IcmpEchoResult& result)
 		{
 			_lastPing = ut::milliseconds_f64(result.latency).count();
@@ -196,35 +375,6 @@ namespace pingstats // export
 
 			_squaredJitter = (1.0 - jw) * _squaredJitter + jw * sd;
 			_jitter = std::sqrt(_squaredJitter);
-
-			constexpr auto HEIGHT{ 200.0 };
-
-			const auto optimalPixelPerMs{ HEIGHT / ((_meanPing) * 2.0 + _jitter) };
-			const auto pixelPerMsDiff{ std::abs(optimalPixelPerMs - _pixelPerMs) };
-
-			if (pixelPerMsDiff / optimalPixelPerMs > 0.2)
-			{
-				if (optimalPixelPerMs >= HEIGHT / 5.0)
-				{
-					_pixelPerMs = HEIGHT / 5.0;
-					_pingOffsetMs = 0.0;
-					_gridSizeY = 1.0;
-				}
-				else
-				{
-					_pixelPerMs = std::min(HEIGHT / 20.0, optimalPixelPerMs);
-					_pingOffsetMs = 0.0;
-
-					const auto assumedHeight{ HEIGHT / _pixelPerMs };
-
-					_gridSizeY =
-						assumedHeight >= 300.0 ?
-						100.0 : assumedHeight >= 150.0 ?
-						50.0 : assumedHeight >= 75.0 ?
-						25.0 : assumedHeight >= 30.0 ?
-						10.0 : 5.0;
-				}
-			}
 		}
 	};
 
@@ -241,7 +391,11 @@ namespace pingstats // export
 		auto stamp{ makeTimeStamp(tp) };
 
 		std::tm tm;
+#if defined _WIN32
 		localtime_s(&tm, &stamp);
+#else
+		localtime_r(&stamp, &tm);
+#endif
 
 		return ut::formatString("%02d-%02d-%02d %02d:%02d:%02d",
 			1900 + tm.tm_year, 1 + tm.tm_mon, tm.tm_mday,
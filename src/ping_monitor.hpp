@@ -24,6 +24,7 @@
 #pragma once
 
 #include "utility/utility.hpp"
+#include "utility/event_trace.hpp"
 #include "utility/stopwatch.hpp"
 #include "winapi/utility.hpp"
 #include "icmp.hpp"
@@ -52,6 +53,7 @@ namespace pingstats // export
 		std::uint32_t _pingIntervalMs{ 500 };
 		std::uint32_t _pingTimeoutMs{ 2000 };
 
+		IcmpTransport& _transport;
 		HWND _resultHandler;
 		WPARAM _resultTag;
 
@@ -64,8 +66,10 @@ namespace pingstats // export
 			SetEvent(_stopEvent);
 		}
 
-		PingMonitor(ut::TreeConfigNode& config, HWND resultHandler, WPARAM resultTag)
-			: _resultHandler(resultHandler)
+		PingMonitor(ut::TreeConfigNode& config, HWND resultHandler, WPARAM resultTag, 
+			IcmpTransport& transport = systemIcmpTransport())
+			: _transport(transport)
+			, _resultHandler(resultHandler)
 			, _resultTag(resultTag)
 		{
 			config.loadOrStore("target", _targetname);
@@ -74,6 +78,8 @@ namespace pingstats // export
 			config.loadOrStore("pingTimeoutMs", _pingTimeoutMs);
 
 			_thread = std::thread([this] { 
+				ut::eventTracer().setThreadName("ping monitor " + _targetname);
+
 				try{ run(); }
 				catch (std::exception& e)
 				{
@@ -123,9 +129,12 @@ namespace pingstats // export
 					{
 						const auto i{ nEvents++ };
 
-						contexts[i] = asyncSendIcmpEcho(_target, _source, _pingTimeoutMs, 255);
+						contexts[i] = _transport.asyncSendEcho(
+							_target, _source, _pingTimeoutMs, 255);
 						events[i] = contexts[i]->event.get();
 
+						PINGSTATS_TRACE_INSTANT("probe send", _resultTag);
+
 						if (contexts[i]->errorCode == ERROR_IO_PENDING)
 						{
 							contexts[i]->errorCode = 0;
@@ -135,7 +144,7 @@ namespace pingstats // export
 							--nEvents;
 
 							const auto replyTime{ cr::steady_clock::now() };
-							sendResult(makeIcmpPingResult(*contexts[i], replyTime));
+							sendResult(_transport.makeResult(*contexts[i], replyTime));
 
 							contexts[i] = nullptr;
 						}
@@ -163,10 +172,17 @@ namespace pingstats // export
 					// Waiting suspended by external stop event.
 					if (index == 0)
 					{
+						for (DWORD i{ 1 }; i < nEvents; ++i)
+						{
+							_transport.abandon(*contexts[i]);
+						}
+
 						return;
 					}
 
-					sendResult(makeIcmpPingResult(*contexts[index], replyTime));
+					PINGSTATS_TRACE_INSTANT("probe reply", _resultTag);
+
+					sendResult(_transport.makeResult(*contexts[index], replyTime));
 
 					contexts[index] = nullptr;
 				}
@@ -193,6 +209,7 @@ namespace pingstats // export
 				};
 
 				if (!traceRoute(
+					_transport,
 					_target,
 					traceType,
 					_stopEvent,
@@ -213,8 +230,11 @@ namespace pingstats // export
 			return true;
 		}
 
+		// Blocks until the window has handled the result.
 		void sendResult(const IcmpEchoResult& result)
 		{
+			PINGSTATS_TRACE_SCOPE("deliver result", _resultTag);
+
 			SendMessageW(_resultHandler, WM_PING_RESULT, 
 				_resultTag, reinterpret_cast<LPARAM>(&result));
 		}
@@ -24,13 +24,33 @@
 #pragma once
 
 #include "utility/utility.hpp"
-#include "winapi/utility.hpp"
 
 #include "canvas_drawing.hpp"
-#include "string_cache.hpp"
+#include "glyph_atlas.hpp"
+#include "info_panel.hpp"
+#include "latency_heatmap.hpp"
 #include "ping_data.hpp"
+#include "plot_vertex_buffer.hpp"
+#include "render_profiler.hpp"
+#include "vertical_scale.hpp"
+#include "vertex_decimator.hpp"
 
+#if defined _WIN32
+#include "winapi/utility.hpp"
+#include "icmp.hpp"
+#include "string_cache.hpp"
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
 #include <vector>
 
 namespace pingstats // export
@@ -39,16 +59,31 @@ namespace pingstats // export
 
 	namespace cr = std::chrono;
 	namespace ut = utility;
-	namespace wa = winapi;
 
+	enum class PlotMode
+	{
+		LINE,
+		HEATMAP,
+	};
+
+	// Renders one section. Only needs a Canvas, so it runs headless as 
+	// well; without GDI the info panel uses the built-in bitmap font.
 	class PingPlotter
 	{
 		std::string _name{ "Name" };
-		std::string _statusString;
+		std::string_view _statusString;
+
+		// Status messages by (errorCode << 32 | statusCode), looking them
+		// up from the system every frame is expensive.
+		std::unordered_map<std::uint64_t, std::string> _statusStrings;
 
 		double _pixelsPerSecond{ 10.0 };
 		double _secondsPerGridLine{ 5.0 };
 		std::int32_t _plotThickness{ 2 };
+		PlotMode _mode{ PlotMode::LINE };
+		ScaleMode _scaleMode{ ScaleMode::LINEAR };
+		pxindex _heatmapCellWidth{ 4 };
+		bool _showPercentileBand{ true };
 
 		Color _clearColor = Color{ 4, 4, 20 };
 		Color _textColor = Color{ 180, 180, 180 };
@@ -58,19 +93,79 @@ namespace pingstats // export
 		Color _borderColor = Color{ 160, 140, 60 };
 		Color _lineColor = Color{ 120, 120, 120 };
 		Color _selectionColor = Color{ 160, 160, 160 };
+		Color _heatColor = Color{ 240, 220, 150 };
+		Color _bandColor = Color{ 40, 140, 180, 50 };
 
-		LOGFONT _logFont{};
+		GlyphAtlas _glyphAtlas;
+		InfoPanel _infoPanel;
 
-		std::vector<Vertex> _pointBuffer;
+		Rect _frameRect{};
+		bool _frameValid{};
 
-		std::size_t _lastWidth{};
-		std::size_t _lastHeight{};
+		std::vector<Vertex> _pointBuffer;
+		std::vector<Vertex> _screenBuffer;
+		VertexDecimator _decimator;
+		PlotVertexBuffer _vertexBuffer;
+
+		// Percentile band rows per new column, and their coverage.
+		std::vector<pxindex> _bandTops;
+		std::vector<pxindex> _bandBottoms;
+		std::vector<std::uint8_t> _bandMask;
+
+		// The vertical scale follows the visible latencies, they are 
+		// looked at again every SCALE_CHECK_INTERVAL or when the view moves.
+		VerticalAutoScale _autoScale;
+		std::vector<double> _scaleSamples;
+		cr::steady_clock::time_point _nextScaleCheck{};
+
+		// Grid and plot are kept in a layer that is scrolled along with 
+		// time, so a frame only has to draw the newly exposed strip and 
+		// results that arrived since the last frame. _layerTime is the time
+		// at the layer's right edge; the fractional part of the scroll 
+		// distance is carried implicitly as now - _layerTime.
+
+		Canvas _plotLayer;
+		bool _layerValid{};
+		cr::steady_clock::time_point _layerTime{};
+		cr::steady_clock::time_point _layerLastSentTime{};
+		std::uint64_t _layerInsertions{};
+		VerticalScale _layerScale;
+
+		// Columns left of _layerBandRight already have their band, it is
+		// drawn once per column so the translucent fill never stacks.
+		pxindex _layerBandRight{};
+
+		// Heatmap mode: the layer's right edge is pixel column 
+		// _layerRightPixel, counted in whole pixels since the clock's epoch,
+		// and each cell of the heatmap is _heatmapCellWidth of them wide.
+		std::int64_t _layerRightPixel{};
+		LatencyHeatmap _heatmap;
+		bool _heatmapValid{};
+		cr::steady_clock::time_point _heatmapLastSentTime{};
+		std::uint64_t _heatmapInsertions{};
+
+		// Zoom and pan. _zoom stretches the configured time axis, the 
+		// view's right edge is _viewEnd, or now while that is unset.
+		double _zoom{ 1.0 };
+		double _viewPixelsPerSecond{ 10.0 };
+		double _viewSecondsPerGridLine{ 5.0 };
+		std::optional<cr::steady_clock::time_point> _viewEnd;
+
+		// Whether the layer shows the pyramid instead of raw results.
+		bool _layerShowsPyramid{};
+		std::uint64_t _layerPyramidVersion{};
 
 		std::size_t _selection{};
 		cr::steady_clock::time_point _selectionTime{};
 		double _selectionTimeMs{};
 
+		RenderProfiler* _profiler{};
+
 	public:
+		static constexpr double MIN_ZOOM{ 1.0 / 16.0 };
+		static constexpr double MAX_ZOOM{ 65536.0 };
+		static constexpr cr::milliseconds SCALE_CHECK_INTERVAL{ 250 };
+
 		PingPlotter(ut::TreeConfigNode& config)
 		{
 			_name = config.name();
@@ -83,6 +178,23 @@ namespace pingstats // export
 				plotcfg.loadOrStore("pixelsPerSecond", _pixelsPerSecond);
 				plotcfg.loadOrStore("secondsPerGridLine", _secondsPerGridLine);
 				plotcfg.loadOrStore("thickness", _plotThickness);
+				plotcfg.loadOrStore("heatmapCellWidth", _heatmapCellWidth);
+				plotcfg.loadOrStore("percentileBand", _showPercentileBand);
+
+				auto mode{ "line"s };
+				plotcfg.loadOrStore("mode", mode);
+
+				auto scale{ "linear"s };
+				auto scaleShrinkSeconds{ 10.0 };
+
+				plotcfg.loadOrStore("scale", scale);
+				plotcfg.loadOrStore("scaleShrinkSeconds", scaleShrinkSeconds);
+
+				_mode = mode == "heatmap" ? PlotMode::HEATMAP : PlotMode::LINE;
+				_scaleMode = scale == "log" ? ScaleMode::LOG : ScaleMode::LINEAR;
+				_autoScale = VerticalAutoScale{ cr::seconds{ 1 }, cr::duration_cast<cr::nanoseconds>(
+					ut::seconds_f64{ std::max(scaleShrinkSeconds, 0.0) }) };
+				_heatmapCellWidth = std::max(_heatmapCellWidth, 1);
 			}
 
 			{
@@ -94,15 +206,23 @@ namespace pingstats // export
 				fontcfg.loadOrStore("size", size);
 				fontcfg.loadOrStore("name", name);
 
-				_logFont.lfHeight = size;
-				_logFont.lfWeight = FW_NORMAL;
-				_logFont.lfCharSet = ANSI_CHARSET;
-				_logFont.lfOutPrecision = OUT_TT_PRECIS;
-				_logFont.lfClipPrecision = CLIP_DEFAULT_PRECIS;
-				_logFont.lfQuality = CLEARTYPE_QUALITY;
-				_logFont.lfPitchAndFamily = FF_DONTCARE;
-
-				wa::wstr(&_logFont.lfFaceName[0], 32, name.c_str(), name.size());
+#if defined _WIN32
+				LOGFONT logFont{};
+				logFont.lfHeight = size;
+				logFont.lfWeight = FW_NORMAL;
+				logFont.lfCharSet = ANSI_CHARSET;
+				logFont.lfOutPrecision = OUT_TT_PRECIS;
+				logFont.lfClipPrecision = CLIP_DEFAULT_PRECIS;
+				logFont.lfQuality = CLEARTYPE_QUALITY;
+				logFont.lfPitchAndFamily = FF_DONTCARE;
+
+				winapi::wstr(&logFont.lfFaceName[0], 32, name.c_str(), name.size());
+
+				_glyphAtlas = makeGdiGlyphAtlas(logFont);
+#else
+				// The built-in font is 9 pixels high per scale step.
+				_glyphAtlas = makeBuiltinGlyphAtlas(std::max(1, (size + 4) / 9));
+#endif
 			}
 
 			{
@@ -116,58 +236,240 @@ namespace pingstats // export
 				colors.loadOrStore("border", _borderColor);
 				colors.loadOrStore("line", _lineColor);
 				colors.loadOrStore("selection", _selectionColor);
+				colors.loadOrStore("heat", _heatColor);
+				colors.loadOrStore("band", _bandColor);
 			}
+
+			_decimator = VertexDecimator{ _lossColor };
+			_heatmap.setPalette(_clearColor, _pingColor, _heatColor, _lossColor);
+
+			resetView();
 		}
 
-		auto& statusString() const
+		auto& name() const
+		{
+			return _name;
+		}
+
+		auto statusString() const
 		{
 			return _statusString;
 		}
 
-		auto pixelsPerSecond() const
+		auto zoomFactor() const
+		{
+			return _zoom;
+		}
+
+		// The view's right edge, it doesn't move past now.
+		cr::steady_clock::time_point viewEnd(cr::steady_clock::time_point now) const
+		{
+			return _viewEnd ? std::min(*_viewEnd, now) : now;
+		}
+
+		// The time shown the given number of pixels left of the right edge.
+		cr::steady_clock::time_point timeAt(
+			double pixelsFromRight, cr::steady_clock::time_point now) const
+		{
+			return viewEnd(now) - cr::duration_cast<cr::nanoseconds>(
+				ut::seconds_f64{ pixelsFromRight / _viewPixelsPerSecond });
+		}
+
+		// Keeps the time at pixelsFromRight in place. A view that follows
+		// now keeps doing so and zooms around its right edge.
+		void zoom(double factor, double pixelsFromRight, cr::steady_clock::time_point now)
+		{
+			const auto zoom{ std::clamp(_zoom * factor, MIN_ZOOM, MAX_ZOOM) };
+
+			if (!_viewEnd)
+			{
+				setView(zoom, std::nullopt);
+			}
+			else
+			{
+				const auto anchor{ timeAt(pixelsFromRight, now) };
+				const auto pixelsPerSecond{ _pixelsPerSecond / zoom };
+
+				setView(zoom, anchor + cr::duration_cast<cr::nanoseconds>(
+					ut::seconds_f64{ pixelsFromRight / pixelsPerSecond }), now);
+			}
+		}
+
+		// Positive pixels move the view back in time. Panning up to now 
+		// follows now again.
+		void pan(double pixels, cr::steady_clock::time_point now)
+		{
+			setView(_zoom, viewEnd(now) - cr::duration_cast<cr::nanoseconds>(
+				ut::seconds_f64{ pixels / _viewPixelsPerSecond }), now);
+		}
+
+		void resetView()
+		{
+			setView(1.0, std::nullopt);
+		}
+
+		auto mode() const
+		{
+			return _mode;
+		}
+
+		// The heatmap only collects results while it is shown.
+		void setMode(PlotMode mode)
+		{
+			_mode = mode;
+			_layerValid = false;
+			_heatmapValid = false;
+		}
+
+		auto scaleMode() const
 		{
-			return _pixelsPerSecond;
+			return _scaleMode;
+		}
+
+		void setScaleMode(ScaleMode mode)
+		{
+			_scaleMode = mode;
+			_nextScaleCheck = {};
+		}
+
+		auto& scale() const
+		{
+			return _autoScale.scale();
+		}
+
+		// Times the vertical scale changed to follow the latencies.
+		auto rescales() const
+		{
+			return _autoScale.rescales();
+		}
+
+		// The earliest time the plot looks different without new data: 
+		// when it has scrolled by a whole pixel, or when the selection 
+		// clock in the info panel ticks over to the next second.
+		cr::steady_clock::time_point nextRedrawTime(cr::steady_clock::time_point now) const
+		{
+			if (!_layerValid)
+			{
+				return now;
+			}
+
+			// Rounded up, _layerTime itself is truncated. A panned view 
+			// doesn't scroll.
+			const auto scrollTime{ _viewEnd ? cr::steady_clock::time_point::max() :
+				_layerTime + cr::nanoseconds{ 1 } + cr::duration_cast<cr::nanoseconds>(
+					ut::seconds_f64{ 1.0 / _viewPixelsPerSecond }) };
+
+			const auto clockTime{ _selectionTime + 
+				cr::ceil<cr::seconds>(now - _selectionTime + cr::nanoseconds{ 1 }) };
+
+			return std::max(now, std::min(scrollTime, clockTime));
+		}
+
+		// Times the render phases into profiler, nullptr turns that off.
+		// Must not be changed while redraw is running.
+		void setProfiler(RenderProfiler* profiler)
+		{
+			_profiler = profiler;
+		}
+
+		// The section's background and border are drawn once and then left
+		// alone, call this when the canvas under the section was overwritten.
+		void invalidate()
+		{
+			_frameValid = false;
 		}
 
 		void redraw(
-			wa::MemoryCanvas& canvas,
+			Canvas& canvas,
 			const Rect& rect,
 			const PingData& pingData,
 			cr::steady_clock::time_point now,
 			cr::steady_clock::time_point selectionOffset,
-			bool drawSelectionLine,
-			Color clearColor)
+			bool drawSelectionLine)
 		{
-			setStatusString(pingData);
+			{
+				ProfileScope scope{ _profiler, RenderPhase::STATUS };
+				setStatusString(pingData);
+			}
 
-			if (_clearColor.value != clearColor.value)
+			if (!_frameValid || 
+				_frameRect.left != rect.left || _frameRect.top != rect.top ||
+				_frameRect.right != rect.right || _frameRect.bottom != rect.bottom)
 			{
 				fillCanvasRect(canvas, rect, _clearColor);
-			}
+				drawBorder(canvas, rect);
 
-			auto& stringCache{ getStaticStringCache(_logFont) };
+				_frameRect = rect;
+				_frameValid = true;
+			}
 
-			const auto& fontSpacing{ stringCache.getFontSpacing() };
-			const auto lineHeight{ fontSpacing.fontHeight };
+			const auto& fontSpacing{ _glyphAtlas.getFontSpacing() };
+			const auto lineHeight{ fontSpacing.fontLineSpacing };
 			const auto infoHeight{ lineHeight * 3 + 8 };
 
-			if (rect.height() > infoHeight)
+			// Plot and info panel stay inside the border.
+			const Rect inner{ 
+				rect.left + 1, 
+				rect.top + 1, 
+				rect.right - 1, 
+				rect.bottom - 1 
+			};
+
+			if (inner.height() > infoHeight && inner.width() > 0)
 			{
+				const auto end{ viewEnd(now) };
+
 				const Rect plotRect{
-					rect.left, 
-					rect.top, 
-					rect.right, 
-					rect.bottom - infoHeight
+					inner.left, 
+					inner.top, 
+					inner.right, 
+					inner.bottom - infoHeight
 				};
 
-				drawGrid(canvas, plotRect, pingData);
-				drawPlot(canvas, plotRect, pingData, now, selectionOffset, drawSelectionLine);
-				drawInfo(canvas, rect, pingData, now, stringCache);
-				drawBorder(canvas, rect);
+				{
+					ProfileScope scope{ _profiler, RenderPhase::GRID };
+					updateScale(plotRect, pingData, end, now);
+				}
+
+				updatePlotLayer(plotRect, pingData, end, drawSelectionLine);
+
+				{
+					ProfileScope scope{ _profiler, RenderPhase::LAYER_COPY };
+					copyCanvasRect(canvas, _plotLayer, plotRect, 0, 0);
+				}
+
+				{
+					ProfileScope scope{ _profiler, RenderPhase::SELECTION };
+					drawSelection(canvas, plotRect, pingData, end, now, selectionOffset, drawSelectionLine);
+				}
+
+				{
+					ProfileScope scope{ _profiler, RenderPhase::INFO };
+					drawInfo(canvas, inner, pingData, now);
+				}
 			}
 		}
 
 	private:
+		// Zooming or panning repaints everything and bins the heatmap anew,
+		// its cells depend on the scale.
+		void setView(double zoom, std::optional<cr::steady_clock::time_point> end)
+		{
+			_zoom = zoom;
+			_viewPixelsPerSecond = _pixelsPerSecond / zoom;
+			_viewSecondsPerGridLine = _secondsPerGridLine * std::exp2(std::round(std::log2(zoom)));
+			_viewEnd = end;
+
+			_layerValid = false;
+			_heatmapValid = false;
+			_nextScaleCheck = {};
+		}
+
+		void setView(double zoom, cr::steady_clock::time_point end, cr::steady_clock::time_point now)
+		{
+			setView(zoom, end < now ? std::optional{ end } : std::nullopt);
+		}
+
 		void setStatusString(const PingData& pingData)
 		{
 			if (pingData.lastResult() == nullptr)
@@ -181,54 +483,82 @@ namespace pingstats // export
 					pingData.pingResults()[_selection] :
 					*pingData.lastResult() };
 
-				if (result.statusCode != 0)
-				{
-					_statusString = ut::formatString("(%u, %u) %s",
-						result.errorCode,
-						result.statusCode,
-						makeIpStatusString(result.statusCode).c_str());
-				}
-				else if (result.errorCode != 0)
-				{
-					_statusString = ut::formatString("(%u, %u) %s",
-						result.errorCode,
-						result.statusCode,
-						std::system_category().
-						message(result.errorCode).c_str());
-				}
-				else
+				const auto key{ 
+					static_cast<std::uint64_t>(result.errorCode) << 32 | 
+					static_cast<std::uint64_t>(result.statusCode) };
+
+				auto it{ _statusStrings.find(key) };
+
+				if (it == _statusStrings.end())
 				{
-					_statusString = "(0, 0) Success";
+					it = _statusStrings.emplace(key, 
+						makeStatusString(result.errorCode, result.statusCode)).first;
 				}
+
+				_statusString = it->second;
+			}
+		}
+
+		static std::string makeStatusString(std::uint32_t errorCode, std::uint32_t statusCode)
+		{
+			if (statusCode != 0)
+			{
+#if defined _WIN32
+				return ut::formatString("(%u, %u) %s",
+					errorCode,
+					statusCode,
+					makeIpStatusString(statusCode).c_str());
+#else
+				return ut::formatString("(%u, %u) IP status %u",
+					errorCode,
+					statusCode,
+					statusCode);
+#endif
+			}
+			else if (errorCode != 0)
+			{
+				return ut::formatString("(%u, %u) %s",
+					errorCode,
+					statusCode,
+					std::system_category().message(errorCode).c_str());
+			}
+			else
+			{
+				return "(0, 0) Success";
 			}
 		}
 
 		void drawGrid(
-			wa::MemoryCanvas& canvas, 
+			Canvas& canvas, 
 			const Rect& rect, 
-			const PingData& pingData)
+			const Rect& clip,
+			cr::steady_clock::time_point rightEdgeTime)
 		{
-			const auto xStep{ _secondsPerGridLine * _pixelsPerSecond };
-			const auto xStart{ rect.right - 1 - xStep };
-
-			for (auto x{ xStart }; x > rect.left; x -= xStep)
+			// Vertical lines are anchored to time so they scroll with the plot.
+			const auto xStep{ _viewSecondsPerGridLine * _viewPixelsPerSecond };
+			const auto phase{ std::fmod(ut::seconds_f64{ 
+				rightEdgeTime.time_since_epoch() }.count(), _viewSecondsPerGridLine) };
+			const auto xStart{ rect.right - 1 - phase * _viewPixelsPerSecond };
+
+			// Down to lines that round to the left column, as the ones 
+			// scrolled there do.
+			for (auto x{ xStart }; x > rect.left - 1; x -= xStep)
 			{
 				const auto ix{ fastround<pxindex>(x) };
-				drawVerticalLine(canvas, rect, _gridColor, ix, rect.top, rect.bottom - 1);
+				drawVerticalLine(canvas, clip, _gridColor, ix, rect.top, rect.bottom - 1);
 			}
 
-			const auto yStep{ pingData.gridSizeY() * pingData.pixelPerMs() };
-			const auto yOffset{ pingData.pingOffsetMs() * pingData.pixelPerMs() };
-			const auto yStart{ rect.bottom - 1 - yOffset };
+			_layerScale.forEachGridLine([&](double ms) {
+				const auto iy{ fastround<pxindex>(rect.bottom - 1 - _layerScale.pixels(ms)) };
 
-			for (auto y{ yStart }; y > rect.top; y -= yStep)
-			{
-				const auto iy{ fastround<pxindex>(y) };
-				drawHorizontalLine(canvas, rect, _gridColor, iy, rect.left, rect.right - 1);
-			}
+				if (iy > rect.top)
+				{
+					drawHorizontalLine(canvas, clip, _gridColor, iy, rect.left, rect.right - 1);
+				}
+			});
 		}
 
-		void drawBorder(wa::MemoryCanvas& canvas, const Rect& rect)
+		void drawBorder(Canvas& canvas, const Rect& rect)
 		{
 			drawVerticalLine(canvas, rect, 
 				_borderColor, rect.left, rect.top, rect.bottom - 1);
@@ -241,43 +571,48 @@ namespace pingstats // export
 		}
 
 		void drawInfo(
-			wa::MemoryCanvas& canvas,
+			Canvas& canvas,
 			const Rect& rect, 
 			const PingData& pingData, 
-			cr::steady_clock::time_point now, 
-			StringCache& stringCache)
+			cr::steady_clock::time_point now)
 		{
-			const auto& fontSpacing = stringCache.getFontSpacing();
+			const auto& fontSpacing = _glyphAtlas.getFontSpacing();
 			const auto fsy = fontSpacing.fontLineSpacing;
-			const auto fsx = fontSpacing.fontWidth;
-			const auto row0 = rect.bottom - 8 - 3 * fsy;
-			const auto row1 = rect.bottom - 8 - 2 * fsy;
-			const auto row2 = rect.bottom - 8 - 1 * fsy;
-			const auto col0 = rect.left + 8;
-			const auto col1 = rect.right - 8 - 26 * fsx;
-			const auto col2 = rect.right - 8 - 12 * fsx;
+			// The columns hold mostly digits, which share one advance in almost any font.
+			const auto fsx = _glyphAtlas.advance('0');
+			const auto infoHeight = fsy * 3 + 8;
+			const auto row0 = infoHeight - 8 - 3 * fsy;
+			const auto row1 = infoHeight - 8 - 2 * fsy;
+			const auto row2 = infoHeight - 8 - 1 * fsy;
+			const auto col0 = 8;
+			const auto col1 = rect.width() - 8 - 26 * fsx;
+			const auto col2 = rect.width() - 8 - 12 * fsx;
 
 			const auto calcPrecision = [](auto x, auto a, auto b, auto c) { 
 				return x >= 1000 ? 0 : x >= 100 ? a : x >= 10 ? b : c;
 			};
 
+			const auto statusWidth = _glyphAtlas.textWidth(_statusString);
+
+			_infoPanel.clearLines();
+
 			// Column 2
-			stringCache.draw(canvas, _clearColor, _pingColor, col2, row0,
-				ut::formatString("ping %4.*f ms", 
-					calcPrecision(pingData.lastPing(), 0, 1, 2), 
-					pingData.lastPing()));
+			_infoPanel.line(0, _pingColor, col2, row0).append("ping ")
+				.appendFixed(pingData.lastPing(), 
+					calcPrecision(pingData.lastPing(), 0, 1, 2), 4)
+				.append(" ms");
 
-			stringCache.draw(canvas, _clearColor, _lossColor, col2, row1,
-				ut::formatString("jttr %4.*f ms", 
-					calcPrecision(pingData.jitter(), 0, 1, 2), 
-					pingData.jitter()));
+			_infoPanel.line(1, _lossColor, col2, row1).append("jttr ")
+				.appendFixed(pingData.jitter(), 
+					calcPrecision(pingData.jitter(), 0, 1, 2), 4)
+				.append(" ms");
 
-			if (col0 + static_cast<LONG>(_statusString.size()) * fsx < col2)
+			if (col0 + statusWidth < col2)
 			{
-				stringCache.draw(canvas, _clearColor, _lossColor, col2, row2,
-					ut::formatString("loss %4.*f %%", 
-						calcPrecision(pingData.lossPercentage(), 0, 1, 2), 
-						pingData.lossPercentage()));
+				_infoPanel.line(2, _lossColor, col2, row2).append("loss ")
+					.appendFixed(pingData.lossPercentage(), 
+						calcPrecision(pingData.lossPercentage(), 0, 1, 2), 4)
+					.append(" %");
 			}
 
 			// Column 1
@@ -285,175 +620,888 @@ namespace pingstats // export
 				const auto delta = now - _selectionTime;
 				const auto min = cr::duration_cast<cr::minutes>(delta);
 				const auto sec = cr::duration_cast< cr::seconds>(delta) - min;
-				const auto minc = static_cast<int>(min.count());
-				const auto secc = static_cast<int>(sec.count());
 
-				const auto str = ut::formatString("[%.*f ms | -%02d:%02d]",
-					calcPrecision(_selectionTimeMs, 0, 1, 2), 
-					_selectionTimeMs, minc, secc);
+				InfoPanel::Line str;
+
+				str.append('[')
+					.appendFixed(_selectionTimeMs, calcPrecision(_selectionTimeMs, 0, 1, 2))
+					.append(" ms | -")
+					.appendInteger(min.count(), 2, '0')
+					.append(':')
+					.appendInteger(sec.count(), 2, '0')
+					.append(']');
 
 				const auto x = 
-					col1 - fsx * (static_cast<int>(str.size()) - 12);
+					col1 + fsx * 12 - _glyphAtlas.textWidth(str.view());
 
-				stringCache.draw(
-					canvas, _clearColor, _textColor, x, row0, str);
+				_infoPanel.line(3, _textColor, x, row0).append(str.view());
 			}
 
-			stringCache.draw(canvas, _clearColor, _textColor, col1, row1,
-				ut::formatString("mean %4.*f ms", 
-					calcPrecision(pingData.meanPing(), 0, 1, 2),
-					pingData.meanPing()));
+			_infoPanel.line(4, _textColor, col1, row1).append("mean ")
+				.appendFixed(pingData.meanPing(), 
+					calcPrecision(pingData.meanPing(), 0, 1, 2), 4)
+				.append(" ms");
 
-			if (col0 + static_cast<LONG>(_statusString.size()) * fsx < col1)
+			if (col0 + statusWidth < col1)
 			{
-				stringCache.draw(canvas, _clearColor, _textColor, col1, row2,
-					ut::formatString("grid %4.*f ms", 
-						calcPrecision(pingData.gridSizeY(), 0, 1, 2), 
-						pingData.gridSizeY()));
+				// Log scales have no single grid size, their top is shown.
+				const auto& scale{ _autoScale.scale() };
+				const auto linear{ scale.mode() == ScaleMode::LINEAR };
+				const auto gridMs{ linear ? scale.gridMs() : scale.topMs() };
+
+				_infoPanel.line(5, _textColor, col1, row2).append(linear ? "grid " : "top  ")
+					.appendFixed(gridMs, calcPrecision(gridMs, 0, 1, 2), 4)
+					.append(" ms");
 			}
 
 			// Column 0
-			stringCache.draw(canvas, _clearColor, _textColor, col0, row0, _name);
+			_infoPanel.line(6, _textColor, col0, row0).append(_name);
+			_infoPanel.line(7, _textColor, col0, row1).append(pingData.lastResponder());
+			_infoPanel.line(8, _textColor, col0, row2).append(_statusString);
+
+			_infoPanel.draw(canvas, 
+				Rect{ rect.left, rect.bottom - infoHeight, rect.right, rect.bottom }, 
+				_glyphAtlas, _clearColor);
+		}
+
+		// Index of the first result that is visible in a plot of the given 
+		// width whose right edge is at rightEdgeTime, minus one so the line
+		// enters from the left border.
+		std::size_t firstContributingResult(
+			const std::vector<IcmpEchoResult>& pingResults,
+			cr::steady_clock::time_point rightEdgeTime,
+			pxindex width) const
+		{
+			const auto leftEdgeTime{ rightEdgeTime - cr::duration_cast<
+				cr::nanoseconds>(ut::seconds_f64{ width / _viewPixelsPerSecond }) };
+
+			const auto it{ std::upper_bound(pingResults.begin(), pingResults.end(), 
+				leftEdgeTime, [](auto time, const IcmpEchoResult& result) {
+					return time < result.sentTime;
+				}
+			) };
+
+			if (it == pingResults.end())
+			{
+				return pingResults.size();
+			}
+
+			return (it - pingResults.begin()) - (it != pingResults.begin());
+		}
+
+		// The value a lost result is plotted at: the last successful ping 
+		// in [start, index], or the first one after start if there is none.
+		double carriedPingMs(
+			const PingData& pingData, std::size_t start, std::size_t index) const
+		{
+			const auto& pingResults{ pingData.pingResults() };
+
+			for (auto i{ index + 1 }; i-- > start; )
+			{
+				if (pingResults[i].errorCode == 0 && pingResults[i].statusCode == 0)
+				{
+					return ut::milliseconds_f64{ pingResults[i].latency }.count();
+				}
+			}
+
+			for (auto i{ start }; i < pingResults.size(); ++i)
+			{
+				if (pingResults[i].statusCode == 0)
+				{
+					return ut::milliseconds_f64{ pingResults[i].latency }.count();
+				}
+			}
 
-			stringCache.draw(canvas, _clearColor, _textColor, 
-				col0, row1, pingData.lastResponder());
+			return pingData.meanPing();
+		}
 
-			stringCache.draw(canvas, _clearColor, _textColor, col0, row2, _statusString);
+		// Number of results sent at or before time.
+		static std::size_t resultsSentUntil(
+			const std::vector<IcmpEchoResult>& pingResults,
+			cr::steady_clock::time_point time)
+		{
+			return static_cast<std::size_t>(std::upper_bound(
+				pingResults.begin(), pingResults.end(), time, 
+				[](auto t, const IcmpEchoResult& result) {
+					return t < result.sentTime;
+				}
+			) - pingResults.begin());
+		}
+
+		std::int64_t pixelColumn(cr::steady_clock::time_point time) const
+		{
+			return static_cast<std::int64_t>(std::floor(
+				ut::seconds_f64{ time.time_since_epoch() }.count() * _viewPixelsPerSecond));
+		}
+
+		// Rounded up, so the time is inside the column.
+		cr::steady_clock::time_point pixelColumnTime(std::int64_t column) const
+		{
+			return cr::steady_clock::time_point{ cr::ceil<cr::nanoseconds>(
+				ut::seconds_f64{ column / _viewPixelsPerSecond }) };
 		}
 
-		void drawPlot(
-			wa::MemoryCanvas& canvas,
+		// Bins the results sent since the last call, and those that were 
+		// inserted since then behind results already binned. Returns the
+		// first pixel column whose cell changed.
+		std::int64_t insertHeatmapResults(
+			const PingData& pingData,
+			cr::steady_clock::time_point now,
+			pxindex width)
+		{
+			const auto& pingResults{ pingData.pingResults() };
+
+			// Twice the width, so moving the selection doesn't drop cells.
+			const auto capacity{ static_cast<std::size_t>(
+				(width / _heatmapCellWidth + 2) * 2) };
+
+			auto begin{ resultsSentUntil(pingResults, _heatmapLastSentTime) };
+			auto dirtyFrom{ std::numeric_limits<std::int64_t>::max() };
+
+			const auto insertResult{ [&](const IcmpEchoResult& result) {
+				const auto cell{ floorDiv(pixelColumn(result.sentTime), _heatmapCellWidth) };
+
+				if (result.errorCode == 0 && result.statusCode == 0)
+				{
+					_heatmap.insert(cell, ut::milliseconds_f64{ result.latency }.count());
+				}
+				else
+				{
+					_heatmap.insertLoss(cell);
+				}
+
+				dirtyFrom = std::min(dirtyFrom, cell * _heatmapCellWidth);
+			} };
+
+			const auto lateKnown{ pingData.forEachLateInsertion(_heatmapInsertions, 
+				[&](cr::steady_clock::time_point sentTime) {
+					const auto index{ resultsSentUntil(pingResults, sentTime) };
+
+					// Unless the history was trimmed past it meanwhile.
+					if (_heatmapValid && sentTime <= _heatmapLastSentTime && 
+						index > 0 && pingResults[index - 1].sentTime == sentTime)
+					{
+						insertResult(pingResults[index - 1]);
+					}
+				}
+			) };
+
+			_heatmapInsertions = pingData.insertionCount();
+
+			if (!_heatmapValid || !lateKnown || _heatmap.capacity() < capacity)
+			{
+				_heatmap.reset(capacity);
+				_heatmapValid = true;
+
+				// From the start of the leftmost cell, which can begin 
+				// left of the plot.
+				const auto firstColumn{ floorDiv(pixelColumn(now) - width + 1, 
+					_heatmapCellWidth) * _heatmapCellWidth };
+
+				begin = resultsSentUntil(pingResults, pixelColumnTime(firstColumn) - cr::nanoseconds{ 2 });
+
+				while (begin < pingResults.size() && 
+					pixelColumn(pingResults[begin].sentTime) < firstColumn)
+				{
+					++begin;
+				}
+
+				dirtyFrom = std::numeric_limits<std::int64_t>::max();
+			}
+
+			const auto end{ resultsSentUntil(pingResults, now) };
+
+			for (auto i{ begin }; i < end; ++i)
+			{
+				insertResult(pingResults[i]);
+			}
+
+			if (begin < end)
+			{
+				_heatmapLastSentTime = pingResults[end - 1].sentTime;
+			}
+
+			return dirtyFrom;
+		}
+
+		// Like the line plot the layer scrolls, but by whole pixel columns
+		// of absolute time, so a cell always covers the same pixels. Only 
+		// the exposed strip and cells that got new results are repainted.
+		// Selection doesn't force a redraw here, the histograms keep 
+		// results that arrive meanwhile.
+		void updateHeatmapLayer(
 			const Rect& rect,
 			const PingData& pingData,
-			std::chrono::steady_clock::time_point now,
-			cr::steady_clock::time_point selectionTime,
-			bool drawSelectionLine)
+			cr::steady_clock::time_point now)
 		{
-			const auto left = rect.left;
-			const auto right = rect.right;
-			const auto top = rect.top;
-			const auto bot = rect.bottom;
+			const auto width{ rect.width() };
+			const auto right{ pixelColumn(now) };
+			const auto shift{ right - _layerRightPixel };
 
+			std::int64_t dirtyFrom{};
+
+			{
+				ProfileScope scope{ _profiler, RenderPhase::PLOT };
+				dirtyFrom = insertHeatmapResults(pingData, now, width);
+			}
+
+			auto stripLeft{ width };
+
+			{
+				ProfileScope scope{ _profiler, RenderPhase::GRID };
+
+				if (!_layerValid || shift < 0 || shift >= width ||
+					_layerScale != _autoScale.scale())
+				{
+					_layerScale = _autoScale.scale();
+
+					_heatmap.setRows(rect.height(), _layerScale);
+					stripLeft = 0;
+				}
+				else if (shift > 0)
+				{
+					scrollCanvasRectLeft(_plotLayer, rect, static_cast<pxindex>(shift));
+					stripLeft = width - static_cast<pxindex>(shift);
+				}
+
+				if (dirtyFrom <= right)
+				{
+					stripLeft = std::min(stripLeft, static_cast<pxindex>(
+						std::max<std::int64_t>(0, width - 1 - (right - dirtyFrom))));
+				}
+
+				_layerRightPixel = right;
+				_layerTime = pixelColumnTime(right);
+				_layerValid = true;
+
+				if (stripLeft < width)
+				{
+					const Rect strip{ stripLeft, rect.top, width, rect.bottom };
+
+					fillCanvasRect(_plotLayer, strip, _clearColor);
+					drawGrid(_plotLayer, rect, strip, _layerTime);
+				}
+			}
+
+			if (stripLeft < width)
+			{
+				ProfileScope scope{ _profiler, RenderPhase::PLOT };
+
+				_heatmap.draw(_plotLayer, Rect{ stripLeft, rect.top, width, rect.bottom }, 
+					right - width + 1 + stripLeft, _heatmapCellWidth);
+			}
+		}
+
+		// Raw results are drawn as long as they reach back to the view's 
+		// left edge and the line has at most a few per pixel, the pyramid
+		// beyond that. The heatmap bins raw results at any zoom.
+		bool showsPyramid(
+			const PingData& pingData, 
+			cr::steady_clock::time_point viewEnd, 
+			pxindex width) const
+		{
 			const auto& pingResults{ pingData.pingResults() };
+			const auto& pyramid{ pingData.pyramid() };
 
-			const auto abstime{ [](auto t) {
-				return t < decltype(t){} ? -t : t;
-			} };
+			if (pyramid.empty())
+			{
+				return false;
+			}
 
-			const auto calcX{ [&](auto sentTime) {
-				return right -
-					ut::seconds_f64{ now - sentTime }.count() * _pixelsPerSecond;
+			if (_mode == PlotMode::LINE && 
+				_viewPixelsPerSecond <= 1.0 / LatencyPyramid::bucketSeconds(0))
+			{
+				return true;
+			}
+
+			const auto viewBegin{ viewEnd - cr::duration_cast<cr::nanoseconds>(
+				ut::seconds_f64{ width / _viewPixelsPerSecond }) };
+
+			// The histories have been trimmed and the view reaches past them.
+			return pingResults.empty() || (viewBegin < pingResults.front().sentTime && 
+				pyramid.oldest() < cr::floor<cr::seconds>(pingResults.front().sentTime));
+		}
+
+		// Drawn in full whenever anything changes, that is bounded by the 
+		// width and happens at most once per pixel of scrolling.
+		void updatePyramidLayer(
+			const Rect& rect,
+			const PingData& pingData,
+			cr::steady_clock::time_point now)
+		{
+			const auto& pyramid{ pingData.pyramid() };
+			const auto scroll{ ut::seconds_f64{ now - _layerTime }.count() * _viewPixelsPerSecond };
+
+			if (_layerValid && _layerShowsPyramid && 
+				_layerPyramidVersion == pyramid.version() &&
+				_layerScale == _autoScale.scale() &&
+				scroll >= 0.0 && scroll < 1.0)
+			{
+				return;
+			}
+
+			_layerTime = now;
+			_layerShowsPyramid = true;
+			_layerPyramidVersion = pyramid.version();
+			_layerScale = _autoScale.scale();
+			_layerValid = true;
+
+			{
+				ProfileScope scope{ _profiler, RenderPhase::GRID };
+
+				fillCanvasRect(_plotLayer, rect, _clearColor);
+				drawGrid(_plotLayer, rect, rect, _layerTime);
+			}
+
+			{
+				ProfileScope scope{ _profiler, RenderPhase::PLOT };
+				drawPyramid(rect, pingData);
+			}
+		}
+
+		// One vertex per pixel column at the mean, with a band from min to 
+		// max behind it. Columns with losses are drawn in the loss colour,
+		// empty buckets break the line.
+		void drawPyramid(const Rect& rect, const PingData& pingData)
+		{
+			const auto& pyramid{ pingData.pyramid() };
+
+			const auto secondsPerPixel{ 1.0 / _viewPixelsPerSecond };
+			const auto level{ LatencyPyramid::levelFor(secondsPerPixel) };
+			const auto bucketSeconds{ LatencyPyramid::bucketSeconds(level) };
+			const auto rightSeconds{ ut::seconds_f64{ _layerTime.time_since_epoch() }.count() };
+			const auto leftSeconds{ rightSeconds - rect.width() * secondsPerPixel };
+			const auto bandColor{ _pingColor.withAlpha(90) };
+
+			const auto calcY{ [&](double ms) {
+				return rect.bottom - _layerScale.pixels(ms);
 			} };
 
-			const auto calcY{ [&](auto rtt) {
-				const auto offMs{ pingData.pingOffsetMs()};
-				const auto ms{ ut::milliseconds_f64{ rtt }.count() };
-				return bot - (ms + offMs) * pingData.pixelPerMs();
+			PyramidBucket column{};
+			auto columnX{ std::numeric_limits<pxindex>::min() };
+			auto columnCenter{ 0.0 };
+			auto lastMeanMs{ std::numeric_limits<double>::quiet_NaN() };
+
+			const auto flushLine{ [&] {
+				drawPrettyLines(_plotLayer, rect, _plotThickness, 
+					_pointBuffer.data(), _pointBuffer.size());
+				_pointBuffer.clear();
 			} };
 
-			const auto getFirstContributingResult{ [&] {
-				for (std::size_t i{}; i < pingResults.size(); ++i)
+			const auto flushColumn{ [&] {
+				if (column.samples > 0)
 				{
-					if (calcX(pingResults[i].sentTime) > left)
+					const auto top{ fastround<pxindex>(calcY(column.maxMs)) };
+					const auto bottom{ fastround<pxindex>(calcY(column.minMs)) };
+
+					// Translucent, so the grid shows through the band.
+					if (top < rect.bottom && bottom >= rect.top && 
+						columnX >= rect.left && columnX < rect.right)
 					{
-						return i - (i > 0);
+						blendCanvasRect(_plotLayer, Rect{ columnX, std::max(top, rect.top), 
+							columnX + 1, std::min(bottom + 1, rect.bottom) }, bandColor);
 					}
+
+					lastMeanMs = column.meanMs();
 				}
 
-				return pingResults.size();
+				if (column.samples > 0 || (column.losses > 0 && !std::isnan(lastMeanMs)))
+				{
+					_pointBuffer.push_back({ columnCenter, calcY(lastMeanMs), 
+						column.losses > 0 ? _lossColor : _pingColor });
+				}
+				else if (column.losses == 0)
+				{
+					flushLine();
+				}
+
+				column = PyramidBucket{};
 			} };
 
-			const auto getFirstSuccessfulPingMs{ [&](std::size_t start) {
-				for (auto i{ start }; i < pingResults.size(); ++i)
-				{
-					if (pingResults[i].statusCode == 0)
+			_pointBuffer.clear();
+
+			// Starts a bucket early, so the line enters from the left border.
+			pyramid.forEach(level, leftSeconds - bucketSeconds, rightSeconds, 
+				[&](double startSeconds, const PyramidBucket& bucket) {
+					const auto center{ rect.right - 
+						(rightSeconds - startSeconds - 0.5 * bucketSeconds) * _viewPixelsPerSecond };
+					const auto x{ static_cast<pxindex>(std::floor(center)) };
+
+					if (x != columnX)
 					{
-						return ut::milliseconds_f64{ pingResults[i].latency }.count();
+						if (columnX != std::numeric_limits<pxindex>::min())
+						{
+							flushColumn();
+						}
+
+						columnX = x;
+						columnCenter = center;
 					}
+
+					column.add(bucket);
 				}
+			);
 
-				return pingData.meanPing();
-			} };
+			if (columnX != std::numeric_limits<pxindex>::min())
+			{
+				flushColumn();
+			}
+
+			flushLine();
+		}
 
-			auto startIndex{ getFirstContributingResult() };
+		// Fits the vertical scale to the p1 and p99 of what the view shows,
+		// raw results or the pyramid's minima and maxima. The auto scale 
+		// decides whether that is worth a rescale.
+		void updateScale(
+			const Rect& rect,
+			const PingData& pingData,
+			cr::steady_clock::time_point viewEnd,
+			cr::steady_clock::time_point now)
+		{
+			const auto& current{ _autoScale.scale() };
 
-			if (startIndex < pingResults.size())
+			if (now < _nextScaleCheck && current.mode() == _scaleMode && 
+				current.height() == rect.height())
 			{
-				_pointBuffer.clear();
+				return;
+			}
+
+			_nextScaleCheck = now + SCALE_CHECK_INTERVAL;
+			_scaleSamples.clear();
 
-				auto selectionDistance{ cr::nanoseconds::max() };
-				auto _lastPingMs{ getFirstSuccessfulPingMs(startIndex) };
+			if (showsPyramid(pingData, viewEnd, rect.width()))
+			{
+				const auto secondsPerPixel{ 1.0 / _viewPixelsPerSecond };
+				const auto rightSeconds{ ut::seconds_f64{ viewEnd.time_since_epoch() }.count() };
 
-				for (auto i{ startIndex }; i < pingResults.size(); ++i)
+				pingData.pyramid().forEach(LatencyPyramid::levelFor(secondsPerPixel), 
+					rightSeconds - rect.width() * secondsPerPixel, rightSeconds, 
+					[&](double, const PyramidBucket& bucket) {
+						if (bucket.samples > 0)
+						{
+							_scaleSamples.push_back(bucket.minMs);
+							_scaleSamples.push_back(bucket.maxMs);
+						}
+					}
+				);
+			}
+			else
+			{
+				const auto& pingResults{ pingData.pingResults() };
+				const auto end{ resultsSentUntil(pingResults, viewEnd) };
+
+				for (auto i{ firstContributingResult(pingResults, viewEnd, rect.width()) }; i < end; ++i)
 				{
-					const auto x{ calcX(pingResults[i].sentTime) };
-					auto color{ _lossColor };
+					const auto& result{ pingResults[i] };
 
-					if (pingResults[i].errorCode == 0 && 
-						pingResults[i].statusCode == 0)
+					if (result.errorCode == 0 && result.statusCode == 0)
 					{
-						_lastPingMs = ut::milliseconds_f64{ pingResults[i].latency }.count();
-						color = _pingColor;
+						_scaleSamples.push_back(ut::milliseconds_f64{ result.latency }.count());
 					}
+				}
+			}
 
-					_pointBuffer.push_back({ x, calcY(_lastPingMs), color });
+			auto lowMs{ std::numeric_limits<double>::quiet_NaN() };
+			auto highMs{ lowMs };
 
-					auto dist{ abstime(pingResults[i].sentTime - selectionTime) };
+			if (!_scaleSamples.empty())
+			{
+				const auto quantile{ [&](double q) {
+					const auto nth{ _scaleSamples.begin() + static_cast<std::ptrdiff_t>(
+						q * (_scaleSamples.size() - 1) + 0.5) };
 
-					if (dist < selectionDistance)
-					{
-						selectionDistance = dist;
+					std::nth_element(_scaleSamples.begin(), nth, _scaleSamples.end());
+					return *nth;
+				} };
 
-						_selection = i;
-						_selectionTime = pingResults[i].sentTime;
-						_selectionTimeMs = _lastPingMs;
-					}
+				highMs = quantile(0.99);
+				lowMs = quantile(0.01);
+			}
+
+			_autoScale.update(_scaleMode, rect.height(), lowMs, highMs, now);
+		}
+
+		void updatePlotLayer(
+			const Rect& rect,
+			const PingData& pingData,
+			cr::steady_clock::time_point now,
+			bool forceRedraw)
+		{
+			const auto width{ rect.width() };
+			const auto height{ rect.height() };
+			const Rect layerRect{ 0, 0, width, height };
+
+			if (_plotLayer.width() != width || _plotLayer.height() != height)
+			{
+				resizeCanvas(_plotLayer, width, height);
+				_layerValid = false;
+			}
+
+			if (showsPyramid(pingData, now, width))
+			{
+				updatePyramidLayer(layerRect, pingData, now);
+				return;
+			}
+
+			if (_layerShowsPyramid)
+			{
+				_layerShowsPyramid = false;
+				_layerValid = false;
+			}
+
+			if (_mode == PlotMode::HEATMAP)
+			{
+				updateHeatmapLayer(layerRect, pingData, now);
+				return;
+			}
+
+			auto redraw{ forceRedraw || !_layerValid || now < _layerTime ||
+				_layerScale != _autoScale.scale() };
+
+			// Results inserted behind ones already drawn, like losses that
+			// are delivered when they time out.
+			auto lateSentTime{ cr::steady_clock::time_point::max() };
+
+			redraw |= !pingData.forEachLateInsertion(_layerInsertions, 
+				[&](cr::steady_clock::time_point sentTime) {
+					lateSentTime = std::min(lateSentTime, sentTime);
 				}
+			);
 
-				drawPrettyLines(canvas, rect, _plotThickness, 
-					_pointBuffer.data(), _pointBuffer.size());
+			_layerInsertions = pingData.insertionCount();
+
+			const auto scroll{ ut::seconds_f64{ now - _layerTime }.count() * _viewPixelsPerSecond };
 
-				const auto lineX{ fastround<pxindex>(calcX(selectionTime)) };
+			// Where drawNewResults starts over, if it does.
+			auto clip{ layerRect };
 
-				if (rect.left < lineX && rect.right > lineX)
+			{
+				ProfileScope scope{ _profiler, RenderPhase::GRID };
+
+				if (redraw || scroll >= width)
 				{
-					if (_selection < pingResults.size())
-						// Implies (startIndex < pingResults.size())
-						// and that selection properties have been set.
+					_layerTime = now;
+					_layerLastSentTime = cr::steady_clock::time_point::min();
+					_layerScale = _autoScale.scale();
+					_layerBandRight = layerRect.left;
+
+					fillCanvasRect(_plotLayer, layerRect, _clearColor);
+					drawGrid(_plotLayer, layerRect, layerRect, _layerTime);
+				}
+				else if (scroll >= 1.0)
+				{
+					const auto shift{ static_cast<pxindex>(scroll) };
+					const Rect strip{ width - shift, 0, width, height };
+
+					_layerTime += cr::duration_cast<cr::nanoseconds>(
+						ut::seconds_f64{ shift / _viewPixelsPerSecond });
+					_layerBandRight -= shift;
+
+					scrollCanvasRectLeft(_plotLayer, layerRect, shift);
+					fillCanvasRect(_plotLayer, strip, _clearColor);
+					drawGrid(_plotLayer, layerRect, strip, _layerTime);
+				}
+
+				if (lateSentTime <= _layerLastSentTime)
+				{
+					clip.left = lateResultColumn(layerRect, pingData, lateSentTime);
+
+					if (clip.left < clip.right)
 					{
-						const auto x{ calcX(_selectionTime) };
-						const auto y{ calcY(_selectionTimeMs) };
-
-						std::array<Vertex, 5> vertices {
-							Vertex{ x - 8, y + 8, _selectionColor },
-							Vertex{ x - 8, y - 8, _selectionColor },
-							Vertex{ x + 8, y - 8, _selectionColor },
-							Vertex{ x + 8, y + 8, _selectionColor },
-							Vertex{ x - 8, y + 8, _selectionColor },
-						};
-
-						drawPrettyLines(canvas, rect, _plotThickness, 
-							vertices.data(), vertices.size());
+						_layerLastSentTime = cr::steady_clock::time_point::min();
+						_layerBandRight = std::min(_layerBandRight, clip.left);
+
+						fillCanvasRect(_plotLayer, clip, _clearColor);
+						drawGrid(_plotLayer, layerRect, clip, _layerTime);
 					}
+				}
+			}
 
-					if (drawSelectionLine)
-					{
-						const pxindex dist{ 20 };
-						const pxindex height{ 8 };
+			{
+				ProfileScope scope{ _profiler, RenderPhase::PLOT };
+				drawNewResults(layerRect, clip, pingData);
+			}
 
-						for (pxindex y{ rect.bottom - dist }; y > rect.top; y -= dist)
-						{
-							drawVerticalLine(canvas, rect, _lineColor, lineX, y, y + height);
-						}
+			// Selection freezes time, results arriving meanwhile would 
+			// be drawn outside the layer and lost.
+			_layerValid = !forceRedraw;
+		}
+
+		// The first layer column the line changed in when the result sent
+		// at sentTime was inserted: it now runs from the result before it 
+		// to the one after it. The width if that's all left of the layer.
+		pxindex lateResultColumn(
+			const Rect& rect,
+			const PingData& pingData,
+			cr::steady_clock::time_point sentTime) const
+		{
+			const auto& pingResults{ pingData.pingResults() };
+			const auto index{ resultsSentUntil(pingResults, sentTime) };
+
+			const auto calcX{ [&](cr::steady_clock::time_point time) {
+				return rect.right - ut::seconds_f64{ _layerTime - time }.count() * _viewPixelsPerSecond;
+			} };
+
+			// Thick lines reach a few pixels past their ends.
+			const auto reach{ _plotThickness + 2 };
+
+			if (index < pingResults.size() && calcX(pingResults[index].sentTime) + reach < rect.left)
+			{
+				return rect.right;
+			}
+
+			const auto before{ index >= 2 ? pingResults[index - 2].sentTime : sentTime };
+
+			return std::max(rect.left, static_cast<pxindex>(std::floor(calcX(before))) - reach);
+		}
+
+		// Draws the results that arrived since the last call. When starting
+		// over, only the part of the layer in clip is drawn to, it has been
+		// cleared.
+		void drawNewResults(const Rect& rect, const Rect& clip, const PingData& pingData)
+		{
+			const auto& pingResults{ pingData.pingResults() };
+
+			// Results past the right edge are left for a later frame, 
+			// the strip they would partially cover gets cleared.
+			const auto firstNew{ resultsSentUntil(pingResults, _layerLastSentTime) };
+			const auto end{ resultsSentUntil(pingResults, _layerTime) };
+
+			if (firstNew >= end)
+			{
+				return;
+			}
+
+			// Lines from results a little left of the clip reach into it.
+			const auto firstVisible{ firstContributingResult(pingResults, _layerTime, 
+				rect.right - clip.left + _plotThickness + 2) };
+			auto startIndex{ firstNew };
+
+			if (_layerLastSentTime == cr::steady_clock::time_point::min())
+			{
+				startIndex = firstVisible;
+
+				if (startIndex >= end)
+				{
+					return;
+				}
+			}
+			else if (firstNew > 0)
+			{
+				// Continue the line from the last result already drawn.
+				startIndex = firstNew - 1;
+			}
+
+			const auto first{ std::min(startIndex, firstVisible) };
+
+			_vertexBuffer.sync(pingResults, first, [&](std::size_t index) {
+				return carriedPingMs(pingData, index, index);
+			});
+
+			const auto xScale{ _viewPixelsPerSecond };
+			const auto xOffset{ rect.right - 
+				ut::seconds_f64{ _layerTime - _vertexBuffer.origin() }.count() * xScale };
+			const auto linear{ _layerScale.mode() == ScaleMode::LINEAR };
+			const auto yScale{ linear ? _layerScale.pixelPerMs() : -1.0 };
+			const auto yOffset{ linear ? rect.bottom + _layerScale.bottomMs() * yScale : 0.0 };
+
+			_screenBuffer.clear();
+			_vertexBuffer.transform(_screenBuffer, startIndex - first, end - first, 
+				xOffset, xScale, yOffset, yScale, _pingColor, _lossColor);
+
+			// Log scales get the latency as y and map it here.
+			if (!linear)
+			{
+				for (auto& vertex : _screenBuffer)
+				{
+					vertex.y = rect.bottom - _layerScale.pixels(vertex.y);
+				}
+			}
+
+			if (startIndex < firstNew)
+			{
+				// The joint belongs to the segment already drawn.
+				_screenBuffer.front().color = _pingColor;
+			}
+
+			if (_showPercentileBand)
+			{
+				drawPercentileBand(clip, pingData, startIndex);
+			}
+
+			_pointBuffer.clear();
+
+			for (const auto& vertex : _screenBuffer)
+			{
+				_decimator.push(_pointBuffer, vertex);
+			}
+
+			_decimator.flush(_pointBuffer);
+
+			drawPrettyLines(_plotLayer, clip, _plotThickness, 
+				_pointBuffer.data(), _pointBuffer.size());
+
+			if (_profiler != nullptr)
+			{
+				_profiler->countVertices(_screenBuffer.size());
+			}
+
+			_layerLastSentTime = pingResults[end - 1].sentTime;
+		}
+
+		// Fills each column from the p90 down to the p10 of the next result
+		// at or right of it, before the line is drawn over it. The columns
+		// are gathered into one coverage mask, blending them one by one 
+		// would walk the layer a column at a time.
+		void drawPercentileBand(
+			const Rect& rect, 
+			const PingData& pingData, 
+			std::size_t startIndex)
+		{
+			const auto& bands{ pingData.latencyBands() };
+			const auto left{ std::max(_layerBandRight, rect.left) };
+
+			auto top{ rect.bottom };
+			auto bottom{ rect.top };
+
+			_bandTops.clear();
+			_bandBottoms.clear();
+
+			for (std::size_t i{}; i < _screenBuffer.size(); ++i)
+			{
+				const auto right{ std::min(fastround<pxindex>(_screenBuffer[i].x) + 1, rect.right) };
+				const auto& band{ bands[startIndex + i] };
+
+				if (right <= _layerBandRight || !band.valid())
+				{
+					continue;
+				}
+
+				const auto high{ std::max(fastround<pxindex>(
+					rect.bottom - _layerScale.pixels(band.highMs)), rect.top) };
+				const auto low{ std::min(fastround<pxindex>(
+					rect.bottom - _layerScale.pixels(band.lowMs)) + 1, rect.bottom) };
+
+				top = std::min(top, high);
+				bottom = std::max(bottom, low);
+
+				for (auto x{ std::max(_layerBandRight, rect.left) }; x < right; ++x)
+				{
+					_bandTops.push_back(high);
+					_bandBottoms.push_back(low);
+				}
+
+				_layerBandRight = right;
+			}
+
+			const auto width{ static_cast<pxindex>(_bandTops.size()) };
+
+			if (width == 0 || top >= bottom)
+			{
+				return;
+			}
+
+			const auto stride{ static_cast<std::size_t>(width) };
+			_bandMask.resize(stride * static_cast<std::size_t>(bottom - top));
+
+			for (auto y{ top }; y < bottom; ++y)
+			{
+				const auto row{ _bandMask.data() + stride * static_cast<std::size_t>(y - top) };
+
+				for (std::size_t x{}; x < stride; ++x)
+				{
+					row[x] = _bandTops[x] <= y && y < _bandBottoms[x] ? 0xFF : 0x00;
+				}
+			}
+
+			blendCanvasMask(_plotLayer, Rect{ left, top, left + width, bottom }, 
+				_bandColor, _bandMask.data(), stride);
+		}
+
+		void drawSelection(
+			Canvas& canvas,
+			const Rect& rect,
+			const PingData& pingData,
+			cr::steady_clock::time_point viewEnd,
+			cr::steady_clock::time_point now,
+			cr::steady_clock::time_point selectionTime,
+			bool drawSelectionLine)
+		{
+			const auto& pingResults{ pingData.pingResults() };
+
+			const auto startIndex{ firstContributingResult(pingResults, viewEnd, rect.width()) };
+
+			if (startIndex >= pingResults.size())
+			{
+				return;
+			}
+
+			const auto calcX{ [&](auto sentTime) {
+				return rect.right -
+					ut::seconds_f64{ viewEnd - sentTime }.count() * _viewPixelsPerSecond;
+			} };
+
+			const auto calcY{ [&](double ms) {
+				return rect.bottom - _autoScale.scale().pixels(ms);
+			} };
+
+			const auto lineX{ fastround<pxindex>(calcX(selectionTime)) };
+
+			if (rect.left < lineX && rect.right > lineX)
+			{
+				// Closest visible result, the earlier one on ties.
+				const auto it{ std::lower_bound(
+					pingResults.begin() + startIndex, pingResults.end(), selectionTime,
+					[](const IcmpEchoResult& result, auto time) {
+						return result.sentTime < time;
 					}
+				) };
+
+				auto index{ static_cast<std::size_t>(it - pingResults.begin()) };
+
+				if (index == pingResults.size() || (index > startIndex && 
+					selectionTime - pingResults[index - 1].sentTime <= 
+					pingResults[index].sentTime - selectionTime))
+				{
+					index -= 1;
 				}
-				else
+
+				_selection = index;
+				_selectionTime = pingResults[index].sentTime;
+				_selectionTimeMs = carriedPingMs(pingData, startIndex, index);
+
+				const auto x{ calcX(_selectionTime) };
+				const auto y{ calcY(_selectionTimeMs) };
+
+				std::array<Vertex, 5> vertices {
+					Vertex{ x - 8, y + 8, _selectionColor },
+					Vertex{ x - 8, y - 8, _selectionColor },
+					Vertex{ x + 8, y - 8, _selectionColor },
+					Vertex{ x + 8, y + 8, _selectionColor },
+					Vertex{ x - 8, y + 8, _selectionColor },
+				};
+
+				drawPrettyLines(canvas, rect, _plotThickness, 
+					vertices.data(), vertices.size());
+
+				if (drawSelectionLine)
 				{
-					_selection = pingResults.size();
-					_selectionTime = now;
-					_selectionTimeMs = 0.0;
+					const pxindex dist{ 20 };
+					const pxindex height{ 8 };
+
+					for (pxindex y{ rect.bottom - dist }; y > rect.top; y -= dist)
+					{
+						drawVerticalLine(canvas, rect, _lineColor, lineX, y, y + height);
+					}
 				}
 			}
+			else
+			{
+				_selection = pingResults.size();
+				_selectionTime = now;
+				_selectionTimeMs = 0.0;
+			}
 		}
 	};
 }
@@ -0,0 +1,189 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+#if defined __linux__
+#include <sys/mman.h>
+#endif
+
+namespace pingstats // export
+{
+	// Platform independent counterpart of winapi::MemoryCanvas with the
+	// same interface, for rendering without GDI. Always top-down, 32 bpp.
+	class PixelCanvas
+	{
+	public:
+		// Pixel memory that can outlive its canvas, so CanvasPool can hand
+		// it to the next one. Large buffers get transparent huge pages on
+		// Linux, which saves most of the page faults on first touch.
+		class Storage
+		{
+			static constexpr std::size_t HUGE_PAGE_SIZE{ 2 << 20 };
+
+			struct Release
+			{
+				std::size_t mappedBytes;
+
+				void operator () (std::uint32_t* pixels) const
+				{
+#if defined __linux__
+					if (mappedBytes != 0)
+					{
+						munmap(pixels, mappedBytes);
+						return;
+					}
+#endif
+					delete[] pixels;
+				}
+			};
+
+			std::unique_ptr<std::uint32_t[], Release> _pixels{ nullptr, Release{} };
+			std::size_t _capacity{};
+
+		public:
+			static Storage allocate(std::size_t capacity)
+			{
+				Storage storage;
+				storage._capacity = capacity;
+
+#if defined __linux__
+				const auto bytes{ capacity * sizeof(std::uint32_t) };
+
+				if (bytes >= HUGE_PAGE_SIZE)
+				{
+					const auto mappedBytes{ (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1) };
+					const auto pixels{ mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, 
+						MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+
+					if (pixels == MAP_FAILED)
+					{
+						throw std::bad_alloc{};
+					}
+
+					madvise(pixels, mappedBytes, MADV_HUGEPAGE);
+
+					storage._pixels = { static_cast<std::uint32_t*>(pixels), Release{ mappedBytes } };
+					return storage;
+				}
+#endif
+				storage._pixels = { new std::uint32_t[capacity], Release{} };
+				return storage;
+			}
+
+			std::size_t capacity() const
+			{
+				return _pixels != nullptr ? _capacity : 0;
+			}
+
+			std::uint32_t* data() const
+			{
+				return _pixels.get();
+			}
+		};
+
+	private:
+		Storage _storage;
+		std::int32_t _width{};
+		std::int32_t _height{};
+
+	public:
+		PixelCanvas(PixelCanvas&& other)
+			: PixelCanvas{}
+		{
+			*this = std::move(other);
+		}
+
+		PixelCanvas() = default;
+
+		PixelCanvas(std::int32_t width, std::int32_t height)
+			: _width{ width }
+			, _height{ height }
+		{
+			if (_width != 0 && _height != 0)
+			{
+				_storage = Storage::allocate(size());
+			}
+		}
+
+		// Takes storage that holds at least width * height pixels.
+		PixelCanvas(std::int32_t width, std::int32_t height, Storage storage)
+			: _storage{ std::move(storage) }
+			, _width{ width }
+			, _height{ height }
+		{}
+
+		PixelCanvas& operator = (PixelCanvas&& other)
+		{
+			_storage = std::move(other._storage);
+			_width = other._width;
+			_height = other._height;
+			other._width = {};
+			other._height = {};
+			return *this;
+		}
+
+		// Leaves the canvas empty.
+		Storage releaseStorage()
+		{
+			_width = {};
+			_height = {};
+			return std::move(_storage);
+		}
+
+		auto width() const
+		{
+			return _width;
+		}
+
+		auto height() const
+		{
+			return _height;
+		}
+
+		std::size_t size() const
+		{
+			return width() * static_cast<std::size_t>(height());
+		}
+
+		auto& operator () (std::size_t x, std::size_t y) const
+		{
+			return _storage.data()[x + y * width()];
+		}
+
+		auto& operator () (std::size_t x, std::size_t y)
+		{
+			return _storage.data()[x + y * width()];
+		}
+
+		auto pixelPtr()
+		{
+			return _storage.data();
+		}
+	};
+}
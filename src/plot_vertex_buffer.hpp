@@ -0,0 +1,192 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/utility.hpp"
+#include "utility/stopwatch.hpp"
+
+#include "canvas_drawing.hpp"
+#include "echo_result.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pingstats // export
+{
+	namespace cr = std::chrono;
+	namespace ut = utility;
+
+	// The points of a line plot in time-relative coordinates: seconds since
+	// an origin and the latency the point is drawn at, lost results already
+	// carrying the last latency before them. Results are appended once when
+	// they arrive and dropped from the front once they leave the view, so 
+	// drawing only has to map the points to the screen.
+	class PlotVertexBuffer
+	{
+		std::vector<double> _seconds;
+		std::vector<double> _pingMs;
+		std::vector<std::uint8_t> _lost;
+
+		// Points before _begin were dropped, they're erased in bulk.
+		std::size_t _begin{};
+
+		cr::steady_clock::time_point _origin{};
+		cr::steady_clock::time_point _firstSentTime{};
+		cr::steady_clock::time_point _lastSentTime{};
+		double _lastPingMs{};
+
+		void append(const std::vector<IcmpEchoResult>& pingResults, std::size_t first)
+		{
+			for (auto i{ first }; i < pingResults.size(); ++i)
+			{
+				const auto& result{ pingResults[i] };
+				const auto lost{ result.errorCode != 0 || result.statusCode != 0 };
+
+				if (!lost)
+				{
+					_lastPingMs = ut::milliseconds_f64{ result.latency }.count();
+				}
+
+				_seconds.push_back(ut::seconds_f64{ result.sentTime - _origin }.count());
+				_pingMs.push_back(_lastPingMs);
+				_lost.push_back(lost);
+			}
+
+			if (first < pingResults.size())
+			{
+				_lastSentTime = pingResults.back().sentTime;
+			}
+		}
+
+		void dropFront(std::size_t count)
+		{
+			_begin += count;
+
+			if (_begin > 4096 && _begin > size())
+			{
+				_seconds.erase(_seconds.begin(), _seconds.begin() + _begin);
+				_pingMs.erase(_pingMs.begin(), _pingMs.begin() + _begin);
+				_lost.erase(_lost.begin(), _lost.begin() + _begin);
+				_begin = 0;
+			}
+		}
+
+	public:
+		std::size_t size() const
+		{
+			return _seconds.size() - _begin;
+		}
+
+		// Makes point k the result first + k, for all results in the 
+		// history. Only results that arrived since the last call are 
+		// converted. If the buffered range no longer matches the history,
+		// because a late result was inserted into it or the view moved 
+		// before it, the points are rebuilt starting at a latency of 
+		// carriedPingMs(first).
+		template <typename CarriedPingMs>
+		void sync(
+			const std::vector<IcmpEchoResult>& pingResults, 
+			std::size_t first,
+			CarriedPingMs&& carriedPingMs)
+		{
+			const auto begin{ static_cast<std::size_t>(std::lower_bound(
+				pingResults.begin(), pingResults.end(), _firstSentTime,
+				[](const IcmpEchoResult& result, auto time) {
+					return result.sentTime < time;
+				}
+			) - pingResults.begin()) };
+
+			const auto end{ begin + size() };
+
+			const auto intact{ size() != 0 && 
+				end <= pingResults.size() &&
+				pingResults[begin].sentTime == _firstSentTime &&
+				pingResults[end - 1].sentTime == _lastSentTime &&
+				begin <= first && first <= end };
+
+			if (!intact)
+			{
+				_seconds.clear();
+				_pingMs.clear();
+				_lost.clear();
+				_begin = 0;
+
+				if (first < pingResults.size())
+				{
+					_origin = pingResults[first].sentTime;
+					_lastPingMs = carriedPingMs(first);
+				}
+
+				append(pingResults, first);
+			}
+			else
+			{
+				dropFront(first - begin);
+				append(pingResults, end);
+			}
+
+			if (size() != 0)
+			{
+				_firstSentTime = pingResults[first].sentTime;
+			}
+		}
+
+		// Appends points [first, last) mapped to the screen: x is xOffset + 
+		// seconds * xScale, y is yOffset - pingMs * yScale.
+		void transform(
+			std::vector<Vertex>& output,
+			std::size_t first,
+			std::size_t last,
+			double xOffset,
+			double xScale,
+			double yOffset,
+			double yScale,
+			Color pingColor,
+			Color lossColor) const
+		{
+			const auto offset{ output.size() };
+			output.resize(offset + (last - first));
+
+			const auto seconds{ _seconds.data() + _begin };
+			const auto pingMs{ _pingMs.data() + _begin };
+			const auto lost{ _lost.data() + _begin };
+			const auto vertices{ output.data() + offset };
+
+			for (auto i{ first }; i < last; ++i)
+			{
+				vertices[i - first] = Vertex{ 
+					xOffset + seconds[i] * xScale, 
+					yOffset - pingMs[i] * yScale, 
+					lost[i] != 0 ? lossColor : pingColor };
+			}
+		}
+
+		auto origin() const
+		{
+			return _origin;
+		}
+	};
+}
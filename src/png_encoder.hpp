@@ -0,0 +1,466 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "canvas_kernels.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace pingstats // export
+{
+	namespace png
+	{
+		using CrcTable = std::array<std::array<std::uint32_t, 256>, 8>;
+
+		CrcTable makeCrcTable()
+		{
+			CrcTable table{};
+
+			for (std::uint32_t i{}; i < 256; ++i)
+			{
+				auto crc{ i };
+
+				for (int k{}; k < 8; ++k)
+				{
+					crc = crc & 1 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+				}
+
+				table[0][i] = crc;
+			}
+
+			for (std::size_t t{ 1 }; t < table.size(); ++t)
+			{
+				for (std::size_t i{}; i < 256; ++i)
+				{
+					table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xFF];
+				}
+			}
+
+			return table;
+		}
+
+		// CRC-32 as used by PNG chunks, eight bytes per step.
+		std::uint32_t crc32(std::uint32_t crc, const std::uint8_t* data, std::size_t size)
+		{
+			static const auto table{ makeCrcTable() };
+
+			crc = ~crc;
+
+			for (; size >= 8; data += 8, size -= 8)
+			{
+				const auto lo{ crc ^ (data[0] | data[1] << 8 | data[2] << 16 | 
+					static_cast<std::uint32_t>(data[3]) << 24) };
+				const auto hi{ data[4] | data[5] << 8 | data[6] << 16 | 
+					static_cast<std::uint32_t>(data[7]) << 24 };
+
+				crc = table[7][lo & 0xFF] ^ table[6][(lo >> 8) & 0xFF] ^
+					table[5][(lo >> 16) & 0xFF] ^ table[4][lo >> 24] ^
+					table[3][hi & 0xFF] ^ table[2][(hi >> 8) & 0xFF] ^
+					table[1][(hi >> 16) & 0xFF] ^ table[0][hi >> 24];
+			}
+
+			for (; size > 0; ++data, --size)
+			{
+				crc = table[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+			}
+
+			return ~crc;
+		}
+
+		std::uint32_t adler32(std::uint32_t adler, const std::uint8_t* data, std::size_t size)
+		{
+			// Largest n such that the sums can't overflow before the modulo.
+			static constexpr std::size_t NMAX{ 5552 };
+
+			std::uint64_t a{ adler & 0xFFFF };
+			std::uint64_t b{ adler >> 16 };
+
+			while (size > 0)
+			{
+				const auto block{ size < NMAX ? size : NMAX };
+				std::size_t i{};
+
+#if defined PINGSTATS_X86
+				// 16 bytes at a time: a gains their sum, b gains 16 times 
+				// the a before them plus their sum weighted 16 down to 1.
+				const auto zero{ _mm_setzero_si128() };
+				const auto weightsLo{ _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9) };
+				const auto weightsHi{ _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1) };
+
+				auto sumA{ zero };
+				auto sumPreviousA{ zero };
+				auto sumB{ zero };
+
+				for (; i + 16 <= block; i += 16)
+				{
+					const auto v{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)) };
+
+					sumPreviousA = _mm_add_epi32(sumPreviousA, sumA);
+					sumA = _mm_add_epi32(sumA, _mm_sad_epu8(v, zero));
+					sumB = _mm_add_epi32(sumB, _mm_add_epi32(
+						_mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weightsLo),
+						_mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weightsHi)));
+				}
+
+				alignas(16) std::uint32_t lanes[3][4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes[0]), sumA);
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes[1]), sumPreviousA);
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes[2]), sumB);
+
+				b += a * i + 16 * (std::uint64_t{ lanes[1][0] } + lanes[1][2]) + 
+					lanes[2][0] + lanes[2][1] + lanes[2][2] + lanes[2][3];
+				a += std::uint64_t{ lanes[0][0] } + lanes[0][2];
+#endif
+
+				for (; i < block; ++i)
+				{
+					a += data[i];
+					b += a;
+				}
+
+				a %= 65521;
+				b %= 65521;
+				data += block;
+				size -= block;
+			}
+
+			return static_cast<std::uint32_t>(b << 16 | a);
+		}
+
+		struct Code
+		{
+			std::uint32_t bits;
+			std::uint32_t length;
+		};
+
+		constexpr std::uint32_t reverseBits(std::uint32_t code, std::uint32_t length)
+		{
+			std::uint32_t reversed{};
+
+			for (std::uint32_t i{}; i < length; ++i)
+			{
+				reversed |= ((code >> i) & 1) << (length - 1 - i);
+			}
+
+			return reversed;
+		}
+
+		// Deflate's fixed Huffman code for a literal/length symbol, 
+		// bit reversed because deflate streams are written LSB first.
+		constexpr Code fixedLiteralCode(std::uint32_t symbol)
+		{
+			return symbol < 144 ? Code{ reverseBits(0x30 + symbol, 8), 8 } :
+				symbol < 256 ? Code{ reverseBits(0x190 + symbol - 144, 9), 9 } :
+				symbol < 280 ? Code{ reverseBits(symbol - 256, 7), 7 } :
+				Code{ reverseBits(0xC0 + symbol - 280, 8), 8 };
+		}
+
+		struct FixedCodes
+		{
+			std::array<Code, 256> literals{};
+
+			// Length symbol, its extra bits and distance code 0 (distance 1)
+			// in one code, indexed by match length.
+			std::array<Code, 259> runs{};
+		};
+
+		FixedCodes makeFixedCodes()
+		{
+			static constexpr std::array<std::uint32_t, 29> LENGTH_BASE{ 
+				3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 
+				35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+			static constexpr std::array<std::uint32_t, 29> LENGTH_EXTRA{ 
+				0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 
+				3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+			FixedCodes codes;
+
+			for (std::uint32_t i{}; i < 256; ++i)
+			{
+				codes.literals[i] = fixedLiteralCode(i);
+			}
+
+			for (std::uint32_t length{ 3 }; length <= 258; ++length)
+			{
+				std::uint32_t index{ LENGTH_BASE.size() - 1 };
+
+				while (LENGTH_BASE[index] > length)
+				{
+					--index;
+				}
+
+				const auto symbol{ fixedLiteralCode(257 + index) };
+				const auto extra{ LENGTH_EXTRA[index] };
+
+				codes.runs[length] = Code{ 
+					symbol.bits | (length - LENGTH_BASE[index]) << symbol.length, 
+					symbol.length + extra + 5 };
+			}
+
+			return codes;
+		}
+
+		// Writes deflate's LSB first bit stream. Every write stores a whole 
+		// word (little endian) and advances by the completed bytes, which 
+		// avoids a hard to predict flush branch. Needs 8 bytes of slack.
+		class BitWriter
+		{
+			std::uint8_t* _out;
+			std::uint64_t _bits{};
+			std::uint32_t _count{};
+
+		public:
+			explicit BitWriter(std::uint8_t* out)
+				: _out{ out }
+			{}
+
+			void write(Code code)
+			{
+				_bits |= static_cast<std::uint64_t>(code.bits) << _count;
+				_count += code.length;
+
+				std::memcpy(_out, &_bits, sizeof _bits);
+
+				const auto bytes{ _count / 8 };
+				_out += bytes;
+				_bits >>= 8 * bytes;
+				_count %= 8;
+			}
+
+			std::uint8_t* finish()
+			{
+				write(Code{ 0, 7 });
+				return _out;
+			}
+		};
+
+		// One final block with the fixed code. Only runs of a repeated byte
+		// are matched, which is what filtered flat image areas turn into.
+		// Writes at most 9 bits per input byte plus the block overhead.
+		std::uint8_t* deflateRuns(std::uint8_t* out, const std::uint8_t* data, std::size_t size)
+		{
+			static const auto codes{ makeFixedCodes() };
+
+			BitWriter writer{ out };
+			writer.write(Code{ 0b011, 3 }); // BFINAL, BTYPE = 01
+
+			for (std::size_t i{}; i < size; )
+			{
+				const auto value{ data[i] };
+
+				if (i == 0 || data[i - 1] != value)
+				{
+					writer.write(codes.literals[value]);
+					i += 1;
+					continue;
+				}
+
+				const auto limit{ size - i < 258 ? size - i : 258 };
+				std::size_t run{};
+
+				std::uint64_t pattern;
+				std::memset(&pattern, value, sizeof pattern);
+
+				for (std::uint64_t word; run + 8 <= limit && 
+					(std::memcpy(&word, data + i + run, 8), word == pattern); run += 8)
+				{}
+
+				while (run < limit && data[i + run] == value)
+				{
+					run += 1;
+				}
+
+				if (run >= 3)
+				{
+					writer.write(codes.runs[run]);
+					i += run;
+				}
+				else
+				{
+					writer.write(codes.literals[value]);
+					i += 1;
+				}
+			}
+
+			writer.write(fixedLiteralCode(256));
+
+			return writer.finish();
+		}
+
+		void storeRgb(std::uint8_t* dest, std::uint32_t pixel)
+		{
+			dest[0] = static_cast<std::uint8_t>(pixel >> 16);
+			dest[1] = static_cast<std::uint8_t>(pixel >> 8);
+			dest[2] = static_cast<std::uint8_t>(pixel);
+		}
+
+		// PNG's Sub filter: every byte minus the byte of the pixel to its 
+		// left. Computed on whole pixels, with borrows kept inside bytes.
+		void filterSub(std::uint8_t* dest, const std::uint32_t* row, std::size_t width)
+		{
+			std::size_t x{};
+
+#if defined PINGSTATS_X86
+			// Most pixels equal their neighbour, blocks of 4 zero 
+			// differences are stored at once.
+			const auto zero{ _mm_setzero_si128() };
+			const auto rgbMask{ _mm_set1_epi32(0x00FFFFFF) };
+			auto previous{ zero };
+
+			for (; x + 4 <= width; x += 4, dest += 12)
+			{
+				const auto current{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)) };
+				const auto left{ _mm_or_si128(
+					_mm_slli_si128(current, 4), _mm_srli_si128(previous, 12)) };
+				const auto diff{ _mm_and_si128(_mm_sub_epi8(current, left), rgbMask) };
+
+				previous = current;
+
+				if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, zero)) == 0xFFFF)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), zero);
+					continue;
+				}
+
+				alignas(16) std::uint32_t diffs[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(diffs), diff);
+
+				for (int i{}; i < 4; ++i)
+				{
+					storeRgb(dest + 3 * i, diffs[i]);
+				}
+			}
+#endif
+
+			for (auto left{ x > 0 ? row[x - 1] : 0 }; x < width; ++x, dest += 3)
+			{
+				const auto current{ row[x] };
+
+				storeRgb(dest, 
+					((current | 0x80808080u) - (left & 0x7F7F7F7Fu)) ^ 
+					((current ^ ~left) & 0x80808080u));
+
+				left = current;
+			}
+		}
+
+		std::uint8_t* writeBigEndian(std::uint8_t* out, std::uint32_t value)
+		{
+			for (int shift{ 24 }; shift >= 0; shift -= 8)
+			{
+				*out++ = static_cast<std::uint8_t>(value >> shift);
+			}
+
+			return out;
+		}
+
+		std::uint8_t* writeChunk(
+			std::uint8_t* out, const char (&type)[5], const std::uint8_t* data, std::size_t size)
+		{
+			out = writeBigEndian(out, static_cast<std::uint32_t>(size));
+			std::memcpy(out, type, 4);
+			std::memmove(out + 4, data, size);
+
+			const auto crc{ crc32(0, out, 4 + size) };
+			return writeBigEndian(out + 4 + size, crc);
+		}
+	}
+
+	// Encodes 0x00RRGGBB pixels as an 8 bit RGB PNG. Rows equal to the one
+	// above use the Up filter, all others Sub, so flat areas, grid lines 
+	// and repeated rows all become runs of zeros. Output and scratch keep 
+	// their capacity, so encoding same-sized images doesn't allocate.
+	void encodePng(
+		std::vector<std::uint8_t>& out, 
+		std::vector<std::uint8_t>& scratch, 
+		const std::uint32_t* pixels, 
+		std::size_t width, 
+		std::size_t height, 
+		std::size_t stride)
+	{
+		static constexpr std::uint8_t SIGNATURE[8]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		static constexpr std::uint8_t FILTER_SUB{ 1 };
+		static constexpr std::uint8_t FILTER_UP{ 2 };
+
+		const auto rowSize{ 1 + 3 * width };
+		const auto rawSize{ rowSize * height };
+
+		// filterSub may write 4 bytes past the end of a row.
+		scratch.resize(rawSize + 4);
+
+		for (std::size_t y{}; y < height; ++y)
+		{
+			const auto row{ pixels + y * stride };
+			auto dest{ scratch.data() + y * rowSize };
+
+			if (y > 0 && std::memcmp(row, row - stride, width * sizeof *row) == 0)
+			{
+				*dest = FILTER_UP;
+				std::memset(dest + 1, 0, 3 * width);
+				continue;
+			}
+
+			*dest = FILTER_SUB;
+			png::filterSub(dest + 1, row, width);
+		}
+
+		// Signature, IHDR, IDAT with zlib header and Adler-32, IEND.
+		out.resize(8 + 25 + 12 + 2 + (rawSize * 9 + 7) / 8 + 16 + 4 + 12);
+
+		auto ptr{ out.data() };
+		std::memcpy(ptr, SIGNATURE, sizeof SIGNATURE);
+		ptr += sizeof SIGNATURE;
+
+		std::uint8_t header[13]{};
+		png::writeBigEndian(header, static_cast<std::uint32_t>(width));
+		png::writeBigEndian(header + 4, static_cast<std::uint32_t>(height));
+		header[8] = 8; // bit depth
+		header[9] = 2; // RGB
+		ptr = png::writeChunk(ptr, "IHDR", header, sizeof header);
+
+		// IDAT is written in place, its length is filled in afterwards.
+		const auto idat{ ptr };
+		ptr += 4;
+		std::memcpy(ptr, "IDAT", 4);
+		ptr += 4;
+
+		*ptr++ = 0x78; // deflate, 32 KiB window
+		*ptr++ = 0x01; // no dictionary, fastest, header checksum
+
+		ptr = png::deflateRuns(ptr, scratch.data(), rawSize);
+		ptr = png::writeBigEndian(ptr, png::adler32(1, scratch.data(), rawSize));
+
+		const auto idatSize{ static_cast<std::size_t>(ptr - idat) - 8 };
+		png::writeBigEndian(idat, static_cast<std::uint32_t>(idatSize));
+		ptr = png::writeBigEndian(ptr, png::crc32(0, idat + 4, 4 + idatSize));
+
+		ptr = png::writeChunk(ptr, "IEND", nullptr, 0);
+
+		out.resize(static_cast<std::size_t>(ptr - out.data()));
+	}
+}
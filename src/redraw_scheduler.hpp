@@ -0,0 +1,110 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace pingstats // export
+{
+	namespace cr = std::chrono;
+
+	// Tracks for every section when it next has to be drawn, either 
+	// because something changed (new results, input) or because its 
+	// content changes by itself (the plot scrolling by a whole pixel). 
+	// Frames are spaced at least one refresh interval apart, so bursts of
+	// damage are coalesced into one frame.
+	class RedrawScheduler
+	{
+	public:
+		using TimePoint = cr::steady_clock::time_point;
+
+		static constexpr TimePoint NEVER{ TimePoint::max() };
+
+	private:
+		std::vector<TimePoint> _due;
+		cr::nanoseconds _minInterval;
+		TimePoint _lastFrame{ TimePoint::min() };
+
+	public:
+		RedrawScheduler(std::size_t sections, int refreshRate)
+			: _due(sections, NEVER)
+			, _minInterval{ cr::duration_cast<cr::nanoseconds>(
+				cr::duration<double>{ 1.0 / std::max(1, refreshRate) }) }
+		{}
+
+		void invalidate(std::size_t section, TimePoint when)
+		{
+			_due[section] = std::min(_due[section], when);
+		}
+
+		void invalidateAll(TimePoint when)
+		{
+			for (std::size_t i{}; i < _due.size(); ++i)
+			{
+				invalidate(i, when);
+			}
+		}
+
+		bool isDue(std::size_t section, TimePoint now) const
+		{
+			return _due[section] <= now;
+		}
+
+		// When the next frame should be drawn, NEVER if nothing is pending.
+		TimePoint nextFrame() const
+		{
+			const auto it{ std::min_element(_due.begin(), _due.end()) };
+
+			if (it == _due.end() || *it == NEVER)
+			{
+				return NEVER;
+			}
+
+			if (_lastFrame == TimePoint::min())
+			{
+				return *it;
+			}
+
+			return std::max(*it, _lastFrame + _minInterval);
+		}
+
+		// Clears everything that was due at now, the caller re-arms 
+		// sections that keep changing on their own.
+		void frameDrawn(TimePoint now)
+		{
+			_lastFrame = now;
+
+			for (auto& due : _due)
+			{
+				if (due <= now)
+				{
+					due = NEVER;
+				}
+			}
+		}
+	};
+}
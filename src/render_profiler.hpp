@@ -0,0 +1,282 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/utility.hpp"
+#include "utility/fixed_string.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pingstats // export
+{
+	namespace cr = std::chrono;
+	namespace ut = utility;
+
+	enum class RenderPhase : std::size_t
+	{
+		FRAME,
+		SECTIONS,
+		BLIT,
+		STATUS,
+		GRID,
+		PLOT,
+		LAYER_COPY,
+		SELECTION,
+		INFO,
+		COUNT,
+	};
+
+	static constexpr std::array<const char*, static_cast<std::size_t>(RenderPhase::COUNT)> 
+		RENDER_PHASE_NAMES{
+			"frame", "sections", "blit", "status", "grid", 
+			"plot", "layer copy", "selection", "info" };
+
+	struct TimingSummary
+	{
+		std::size_t samples;
+		double p50Us;
+		double p99Us;
+		double maxUs;
+	};
+
+	// The most recent durations of one channel. Sections render in 
+	// parallel, so writers only claim a slot with an atomic increment.
+	// A reader racing a writer may see an older sample in that slot.
+	// Counts are kept the same way, summarized with a divisor of 1.
+	class TimingRing
+	{
+	public:
+		static constexpr std::size_t SIZE{ 512 };
+
+	private:
+		std::array<std::atomic<std::uint32_t>, SIZE> _samples{};
+		std::atomic<std::size_t> _next{};
+
+	public:
+		void push(std::uint64_t value)
+		{
+			const auto sample{ std::min<std::uint64_t>(value, UINT32_MAX) };
+			const auto slot{ _next.fetch_add(1, std::memory_order_relaxed) % SIZE };
+
+			_samples[slot].store(static_cast<std::uint32_t>(sample), std::memory_order_relaxed);
+		}
+
+		void push(cr::nanoseconds duration)
+		{
+			push(static_cast<std::uint64_t>(std::max<cr::nanoseconds::rep>(duration.count(), 0)));
+		}
+
+		void clear()
+		{
+			_next.store(0, std::memory_order_relaxed);
+		}
+
+		TimingSummary summary(double divisor = 1e3) const
+		{
+			std::array<std::uint32_t, SIZE> samples;
+			const auto count{ std::min(_next.load(std::memory_order_relaxed), SIZE) };
+
+			for (std::size_t i{}; i < count; ++i)
+			{
+				samples[i] = _samples[i].load(std::memory_order_relaxed);
+			}
+
+			if (count == 0)
+			{
+				return {};
+			}
+
+			const auto begin{ samples.begin() };
+			const auto end{ begin + count };
+
+			const auto percentile{ [&](double p) {
+				const auto nth{ begin + static_cast<std::ptrdiff_t>(p * (count - 1)) };
+				std::nth_element(begin, nth, end);
+				return *nth / divisor;
+			} };
+
+			const auto p50{ percentile(0.5) };
+			const auto p99{ percentile(0.99) };
+
+			return { count, p50, p99, *std::max_element(begin, end) / divisor };
+		}
+	};
+
+	// Rolling timings of the render phases (RenderPhase) followed by one
+	// channel per section, and last the number of plot vertices each
+	// frame had to transform.
+	class RenderProfiler
+	{
+		static constexpr auto PHASE_COUNT{ static_cast<std::size_t>(RenderPhase::COUNT) };
+
+		std::vector<std::string> _names;
+		std::unique_ptr<TimingRing[]> _rings;
+		std::atomic<std::size_t> _frameVertices{};
+
+	public:
+		explicit RenderProfiler(const std::vector<std::string>& sectionNames)
+			: _names(RENDER_PHASE_NAMES.begin(), RENDER_PHASE_NAMES.end())
+			, _rings{ std::make_unique<TimingRing[]>(PHASE_COUNT + sectionNames.size() + 1) }
+		{
+			_names.insert(_names.end(), sectionNames.begin(), sectionNames.end());
+			_names.push_back("vertices");
+		}
+
+		static std::size_t channel(RenderPhase phase)
+		{
+			return static_cast<std::size_t>(phase);
+		}
+
+		static std::size_t sectionChannel(std::size_t section)
+		{
+			return PHASE_COUNT + section;
+		}
+
+		std::size_t channelCount() const
+		{
+			return _names.size();
+		}
+
+		std::size_t vertexChannel() const
+		{
+			return _names.size() - 1;
+		}
+
+		const std::string& channelName(std::size_t channel) const
+		{
+			return _names[channel];
+		}
+
+		void record(std::size_t channel, cr::nanoseconds duration)
+		{
+			_rings[channel].push(duration);
+		}
+
+		TimingSummary summary(std::size_t channel) const
+		{
+			return _rings[channel].summary(channel == vertexChannel() ? 1.0 : 1e3);
+		}
+
+		// Called by the sections while they render, possibly in parallel.
+		void countVertices(std::size_t count)
+		{
+			_frameVertices.fetch_add(count, std::memory_order_relaxed);
+		}
+
+		void endFrame()
+		{
+			_rings[vertexChannel()].push(std::uint64_t{ 
+				_frameVertices.exchange(0, std::memory_order_relaxed) });
+		}
+
+		void clear()
+		{
+			for (std::size_t i{}; i < channelCount(); ++i)
+			{
+				_rings[i].clear();
+			}
+		}
+
+		// Fixed width line for channel, without allocating. Used by the 
+		// overlay and for dumps.
+		template <std::size_t N>
+		void formatLine(ut::FixedString<N>& line, std::size_t channel) const
+		{
+			static constexpr std::size_t NAME_WIDTH{ 14 };
+
+			const auto name{ std::string_view{ _names[channel] }.substr(0, NAME_WIDTH) };
+			const auto summary{ this->summary(channel) };
+			const auto decimals{ channel == vertexChannel() ? 0 : 1 };
+
+			line.clear();
+			line.append(name).append(' ', NAME_WIDTH - name.size());
+			line.appendFixed(summary.p50Us, decimals, 9);
+			line.appendFixed(summary.p99Us, decimals, 9);
+			line.appendFixed(summary.maxUs, decimals, 9);
+			line.appendInteger(static_cast<std::int64_t>(summary.samples), 6);
+		}
+
+		static std::string_view header()
+		{
+			return "phase (us)          p50      p99      max     n";
+		}
+
+		std::string format() const
+		{
+			std::string result{ header() };
+			result += "\r\n";
+
+			ut::FixedString<64> line;
+
+			for (std::size_t i{}; i < channelCount(); ++i)
+			{
+				formatLine(line, i);
+				result.append(line.view().data(), line.size());
+				result += "\r\n";
+			}
+
+			return result;
+		}
+	};
+
+	// Times its scope into a channel of a RenderProfiler. A null profiler
+	// disables it; the clock is read either way, so only the destructor 
+	// tests the pointer.
+	class ProfileScope
+	{
+		RenderProfiler* _profiler;
+		std::size_t _channel;
+		cr::steady_clock::time_point _start;
+
+	public:
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator = (const ProfileScope&) = delete;
+
+		ProfileScope(RenderProfiler* profiler, std::size_t channel)
+			: _profiler{ profiler }
+			, _channel{ channel }
+			, _start{ cr::steady_clock::now() }
+		{}
+
+		ProfileScope(RenderProfiler* profiler, RenderPhase phase)
+			: ProfileScope{ profiler, RenderProfiler::channel(phase) }
+		{}
+
+		~ProfileScope()
+		{
+			if (_profiler != nullptr)
+			{
+				_profiler->record(_channel, cr::steady_clock::now() - _start);
+			}
+		}
+	};
+}
@@ -0,0 +1,270 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/utility.hpp"
+#include "utility/stopwatch.hpp"
+#include "utility/tree_config.hpp"
+#include "utility/worker_pool.hpp"
+#include "winapi/utility.hpp"
+#include "canvas_drawing.hpp"
+#include "ping_data.hpp"
+#include "ping_plotter.hpp"
+#include "render_profiler.hpp"
+#include "result_trace.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pingstats // export
+{
+	using namespace utility::literals;
+
+	namespace cr = std::chrono;
+	namespace ut = utility;
+	namespace wa = winapi;
+
+	// Feeds a recorded ResultTrace into PingData and renders it with 
+	// PingPlotter at a fixed frame rate of trace time, either paced like
+	// the recording (speed 1.0 is real time) or as fast as possible (0.0).
+	class ReplayBenchmark
+	{
+		class ReplaySection
+		{
+		public:
+			std::unique_ptr<ut::TreeConfigNode> config;
+			std::unique_ptr<PingData> data;
+			std::unique_ptr<PingPlotter> plotter;
+			Rect rect{};
+		};
+
+		struct Settings
+		{
+			double refreshRate{ 30.0 };
+			int sectionWidth{ 480 };
+			int sectionHeight{ 320 };
+			Color clearColor{ 4, 4, 20 };
+		};
+
+		struct ReplayResult
+		{
+			std::vector<double> frameTimesUs;
+			cr::nanoseconds insertTime{};
+			double wallSeconds{};
+			std::string phaseTimings;
+		};
+
+	public:
+		// Replays the trace twice, rendering sections on one thread and 
+		// then on a WorkerPool of replay.renderThreads (0 means all cores).
+		std::string run(ut::TreeConfigNode& config, const ResultTrace& trace, double speed)
+		{
+			auto& benchcfg{ *config.findOrAppendNode("replay") };
+
+			Settings settings;
+			auto renderThreads{ 0 };
+
+			benchcfg.loadOrStore("refreshRate", settings.refreshRate);
+			benchcfg.loadOrStore("renderThreads", renderThreads);
+			config.loadOrStore("sectionWidth", settings.sectionWidth);
+			config.loadOrStore("sectionHeight", settings.sectionHeight);
+			config.loadOrStore("clearColor", settings.clearColor);
+
+			settings.refreshRate = std::max(1.0, settings.refreshRate);
+
+			ut::WorkerPool singleThread{ 1 };
+			ut::WorkerPool pool{ static_cast<std::size_t>(std::max(0, renderThreads)) };
+
+			auto single{ replay(config, trace, speed, settings, singleThread) };
+			auto parallel{ replay(config, trace, speed, settings, pool) };
+
+			const auto records{ std::max<std::size_t>(1, trace.records.size()) };
+
+			return ut::formatString(
+				"sections            %zu\r\n"
+				"records             %zu\r\n"
+				"trace duration      %.2f s\r\n"
+				"replay speed        %s\r\n"
+				"replay wall time    %.2f s\r\n"
+				"insert mean         %.1f ns\r\n"
+				"frames              %zu (%.1f Hz)\r\n",
+				trace.sectionNames.size(),
+				trace.records.size(),
+				ut::seconds_f64{ trace.duration() }.count(),
+				speed > 0.0 ? ut::formatString("%.2fx", speed).c_str() : "max",
+				single.wallSeconds,
+				static_cast<double>(single.insertTime.count()) / records,
+				single.frameTimesUs.size(), settings.refreshRate) +
+				formatFrameTimes("1 thread", single.frameTimesUs) +
+				formatFrameTimes(ut::formatString("%zu threads", pool.size()).c_str(), 
+					parallel.frameTimesUs) + 
+				single.phaseTimings;
+		}
+
+	private:
+		static std::string formatFrameTimes(const char* label, std::vector<double>& frameTimesUs)
+		{
+			std::sort(frameTimesUs.begin(), frameTimesUs.end());
+
+			const auto percentile{ [&](double p) {
+				const auto i{ static_cast<std::size_t>(p * (frameTimesUs.size() - 1)) };
+				return frameTimesUs[i];
+			} };
+
+			double frameSumUs{};
+
+			for (auto t : frameTimesUs)
+			{
+				frameSumUs += t;
+			}
+
+			return ut::formatString(
+				"redraw %-12s mean %.1f us | p50 %.1f us | p99 %.1f us | max %.1f us\r\n",
+				label,
+				frameSumUs / frameTimesUs.size(),
+				percentile(0.5),
+				percentile(0.99),
+				frameTimesUs.back());
+		}
+
+		ReplayResult replay(
+			ut::TreeConfigNode& config, 
+			const ResultTrace& trace, 
+			double speed, 
+			const Settings& settings,
+			ut::WorkerPool& pool)
+		{
+			const auto sectionWidth{ settings.sectionWidth };
+			const auto sectionHeight{ settings.sectionHeight };
+
+			auto& hosts{ *config.findOrAppendNode("hosts") };
+			std::vector<ReplaySection> sections(trace.sectionNames.size());
+			RenderProfiler profiler{ trace.sectionNames };
+
+			for (std::size_t i{}; i < sections.size(); ++i)
+			{
+				auto& section{ sections[i] };
+				auto host{ hosts.findNode(trace.sectionNames[i]) };
+
+				// Copy the render and stats settings of the recorded host, if any.
+				section.config = std::make_unique<ut::TreeConfigNode>(
+					nullptr, trace.sectionNames[i]);
+
+				if (host != nullptr)
+				{
+					parseTreeConfig(*section.config, serializeTreeConfig(*host).c_str());
+				}
+
+				section.data = std::make_unique<PingData>(*section.config);
+				section.plotter = std::make_unique<PingPlotter>(*section.config);
+				section.plotter->setProfiler(&profiler);
+
+				const auto top{ static_cast<pxindex>(i * sectionHeight) };
+				section.rect = Rect{ 0, top, sectionWidth, top + sectionHeight };
+			}
+
+			Canvas canvas{ sectionWidth, 
+				std::max(1, static_cast<int>(sections.size()) * sectionHeight) };
+
+			const auto frameInterval{ cr::duration_cast<cr::nanoseconds>(
+				ut::seconds_f64{ 1.0 / settings.refreshRate }) };
+
+			ReplayResult result;
+
+			// Like the window's back buffer, the canvas is only cleared once
+			// and sections keep their static parts between frames.
+			clearCanvas(canvas, settings.clearColor);
+
+			const auto start{ cr::steady_clock::now() };
+			auto nextFrame{ cr::nanoseconds{} };
+
+			const auto renderFrame{ [&](cr::nanoseconds traceTime) {
+				const auto now{ start + traceTime };
+
+				// Paced frames are drawn when they would be on screen.
+				if (speed > 0.0)
+				{
+					std::this_thread::sleep_until(start + cr::duration_cast<
+						cr::nanoseconds>(traceTime / speed));
+				}
+
+				ut::Stopwatch<> stopwatch;
+
+				pool.forEach(sections.size(), [&](std::size_t i) {
+					ProfileScope scope{ &profiler, RenderProfiler::sectionChannel(i) };
+
+					sections[i].plotter->redraw(canvas, sections[i].rect, 
+						*sections[i].data, now, now, false);
+				});
+
+				result.frameTimesUs.push_back(
+					stopwatch.elapsed<ut::seconds_f64>().count() * 1e6);
+			} };
+
+			ut::Stopwatch<> wallClock;
+
+			for (auto& record : trace.records)
+			{
+				const cr::nanoseconds deliveryTime{ record.deliveryTimeNs };
+
+				for (; nextFrame <= deliveryTime; nextFrame += frameInterval)
+				{
+					renderFrame(nextFrame);
+				}
+
+				if (speed > 0.0)
+				{
+					std::this_thread::sleep_until(start + cr::duration_cast<
+						cr::nanoseconds>(deliveryTime / speed));
+				}
+
+				const auto echoResult{ ResultTrace::makeResult(record, start) };
+				auto& data{ *sections[record.section].data };
+
+				ut::Stopwatch<> stopwatch;
+
+				if (record.kind == ResultKind::PING)
+				{
+					data.insertPingResult(echoResult);
+				}
+				else
+				{
+					data.insertTraceResult(echoResult);
+				}
+
+				result.insertTime += stopwatch.elapsed();
+			}
+
+			renderFrame(nextFrame);
+
+			result.wallSeconds = wallClock.elapsed<ut::seconds_f64>().count();
+			result.phaseTimings = profiler.format();
+
+			return result;
+		}
+	};
+}
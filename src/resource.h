@@ -36,3 +36,10 @@
 #define CONTEXT_MENU_COPY_ROUTE (CONTEXT_MENU+4)
 #define CONTEXT_MENU_SAVE_LOG (CONTEXT_MENU+5)
 #define CONTEXT_MENU_ALWAYS_ON_TOP (CONTEXT_MENU+6)
+#define CONTEXT_MENU_RENDER_TIMINGS (CONTEXT_MENU+7)
+#define CONTEXT_MENU_SAVE_RENDER_TIMINGS (CONTEXT_MENU+8)
+#define CONTEXT_MENU_EVENT_TRACING (CONTEXT_MENU+9)
+#define CONTEXT_MENU_SAVE_EVENT_TRACE (CONTEXT_MENU+10)
+#define CONTEXT_MENU_LATENCY_HEATMAP (CONTEXT_MENU+11)
+#define CONTEXT_MENU_RESET_ZOOM (CONTEXT_MENU+12)
+#define CONTEXT_MENU_LOG_SCALE (CONTEXT_MENU+13)
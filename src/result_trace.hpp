@@ -0,0 +1,223 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/utility.hpp"
+#include "utility/read_file.hpp"
+#include "echo_result.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace pingstats // export
+{
+	namespace cr = std::chrono;
+	namespace ut = utility;
+
+	// Binary trace of the results delivered to the window, in delivery order.
+	// Layout: ResultTraceHeader, then sectionCount length-prefixed section 
+	// names, then fixed size ResultTraceRecords until the end of the file.
+	// All times are nanoseconds relative to the start of the recording.
+
+	static constexpr std::uint32_t RESULT_TRACE_MAGIC{ 0x54525350 }; // "PSRT"
+	static constexpr std::uint32_t RESULT_TRACE_VERSION{ 1 };
+
+	enum class ResultKind : std::uint8_t
+	{
+		PING,
+		TRACE,
+	};
+
+	struct ResultTraceHeader
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t sectionCount;
+		std::uint32_t recordSize;
+	};
+
+	struct ResultTraceRecord
+	{
+		std::int64_t deliveryTimeNs;
+		std::int64_t sentTimeNs;
+		std::int64_t latencyNs;
+		std::uint32_t errorCode;
+		std::uint32_t statusCode;
+		std::uint32_t responderIpv4;
+		std::uint32_t sysLatency;
+		std::uint16_t section;
+		ResultKind kind;
+		std::uint8_t reserved[5];
+	};
+
+	static_assert(sizeof(ResultTraceRecord) == 48);
+
+	class ResultTraceWriter
+	{
+		ut::FileHandle _file;
+		cr::steady_clock::time_point _start;
+
+	public:
+		ResultTraceWriter(const std::string& filename, 
+			const std::vector<std::string>& sectionNames)
+			: _file{ std::fopen(filename.c_str(), "wb") }
+			, _start{ cr::steady_clock::now() }
+		{
+			if (_file == nullptr)
+			{
+				throw std::runtime_error("Unable to open \"" + filename + "\".");
+			}
+
+			const ResultTraceHeader header{ 
+				RESULT_TRACE_MAGIC, 
+				RESULT_TRACE_VERSION, 
+				static_cast<std::uint32_t>(sectionNames.size()),
+				static_cast<std::uint32_t>(sizeof(ResultTraceRecord)) };
+
+			std::fwrite(&header, sizeof header, 1, _file.get());
+
+			for (auto& name : sectionNames)
+			{
+				const auto size{ static_cast<std::uint16_t>(std::min<std::size_t>(name.size(), 0xFFFF)) };
+
+				std::fwrite(&size, sizeof size, 1, _file.get());
+				std::fwrite(name.data(), 1, size, _file.get());
+			}
+		}
+
+		void write(ResultKind kind, std::size_t section, const IcmpEchoResult& result)
+		{
+			ResultTraceRecord record{};
+
+			record.deliveryTimeNs = (cr::steady_clock::now() - _start).count();
+			record.sentTimeNs = (result.sentTime - _start).count();
+			record.latencyNs = cr::duration_cast<cr::nanoseconds>(result.latency).count();
+			record.errorCode = result.errorCode;
+			record.statusCode = result.statusCode;
+			record.responderIpv4 = result.responder.addr4();
+			record.sysLatency = result.sysLatency;
+			record.section = static_cast<std::uint16_t>(section);
+			record.kind = kind;
+
+			std::fwrite(&record, sizeof record, 1, _file.get());
+		}
+	};
+
+	class ResultTrace
+	{
+	public:
+		std::vector<std::string> sectionNames;
+		std::vector<ResultTraceRecord> records;
+
+		cr::nanoseconds duration() const
+		{
+			return cr::nanoseconds{ records.empty() ? 0 : records.back().deliveryTimeNs };
+		}
+
+		static IcmpEchoResult makeResult(
+			const ResultTraceRecord& record, cr::steady_clock::time_point start)
+		{
+			IcmpEchoResult result{};
+
+			result.sentTime = start + cr::nanoseconds{ record.sentTimeNs };
+			result.latency = cr::nanoseconds{ record.latencyNs };
+			result.errorCode = record.errorCode;
+			result.statusCode = record.statusCode;
+			result.responder = IpEndPoint{ record.responderIpv4 };
+			result.sysLatency = record.sysLatency;
+
+			return result;
+		}
+	};
+
+	ResultTrace readResultTrace(const std::string& filename)
+	{
+		const auto file{ ut::readFileAs<std::vector<char>>(filename) };
+		const auto invalid{ [&filename] {
+			return std::runtime_error("Invalid result trace \"" + filename + "\".");
+		} };
+
+		ResultTraceHeader header;
+
+		if (file.size() < sizeof header)
+		{
+			throw invalid();
+		}
+
+		std::memcpy(&header, file.data(), sizeof header);
+
+		if (header.magic != RESULT_TRACE_MAGIC || 
+			header.version != RESULT_TRACE_VERSION ||
+			header.recordSize != sizeof(ResultTraceRecord))
+		{
+			throw invalid();
+		}
+
+		ResultTrace trace;
+		auto offset{ sizeof header };
+
+		for (std::uint32_t i{}; i < header.sectionCount; ++i)
+		{
+			std::uint16_t size;
+
+			if (file.size() < offset + sizeof size)
+			{
+				throw invalid();
+			}
+
+			std::memcpy(&size, file.data() + offset, sizeof size);
+			offset += sizeof size;
+
+			if (file.size() < offset + size)
+			{
+				throw invalid();
+			}
+
+			trace.sectionNames.emplace_back(file.data() + offset, size);
+			offset += size;
+		}
+
+		// A truncated last record is expected if the recording was killed.
+		trace.records.resize((file.size() - offset) / sizeof(ResultTraceRecord));
+
+		if (trace.records.size() > 0)
+		{
+			std::memcpy(trace.records.data(), file.data() + offset,
+				trace.records.size() * sizeof(ResultTraceRecord));
+		}
+
+		for (auto& record : trace.records)
+		{
+			if (record.section >= header.sectionCount)
+			{
+				throw invalid();
+			}
+		}
+
+		return trace;
+	}
+}
@@ -0,0 +1,224 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/utility.hpp"
+#include "utility/stopwatch.hpp"
+#include "utility/tree_config.hpp"
+#include "winapi/utility.hpp"
+#include "window_messages.hpp"
+#include "network_simulator.hpp"
+#include "ping_monitor.hpp"
+#include "ping_data.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pingstats // export
+{
+	using namespace utility::literals;
+
+	namespace cr = std::chrono;
+	namespace ut = utility;
+	namespace wa = winapi;
+
+	// Runs many PingMonitors against a SimulatedNetwork and feeds their
+	// results into PingData exactly like MainWindow does, then reports
+	// throughput, CPU cost and timing accuracy of the whole engine.
+	class SimulationBenchmark
+	{
+		static constexpr wchar_t WND_CLASSNAME[]{ L"SimulationBenchmarkClass" };
+
+		std::vector<std::unique_ptr<ut::TreeConfigNode>> _hosts;
+		std::vector<std::unique_ptr<PingData>> _data;
+		std::uint64_t _pingResults{};
+		std::uint64_t _traceResults{};
+
+	public:
+		std::string run(ut::TreeConfigNode& config)
+		{
+			auto& simcfg{ *config.findOrAppendNode("simulation") };
+			auto& benchcfg{ *simcfg.findOrAppendNode("benchmark") };
+
+			const SimulatedPathConfig pathConfig{ *simcfg.findOrAppendNode("path") };
+
+			auto sections{ 64u };
+			auto seconds{ 10.0 };
+			auto pingIntervalMs{ 50u };
+			auto target{ "trace public4 8.8.8.8"s };
+
+			benchcfg.loadOrStore("sections", sections);
+			benchcfg.loadOrStore("seconds", seconds);
+			benchcfg.loadOrStore("pingIntervalMs", pingIntervalMs);
+			benchcfg.loadOrStore("target", target);
+
+			const auto hwnd{ createMessageWindow() };
+
+			SimulatedNetwork network{ pathConfig };
+			std::vector<std::unique_ptr<PingMonitor>> monitors;
+
+			for (unsigned i{}; i < sections; ++i)
+			{
+				_hosts.push_back(std::make_unique<ut::TreeConfigNode>(
+					nullptr, "sim" + std::to_string(i)));
+
+				auto& host{ *_hosts.back() };
+				host.storeValue("target", target);
+				host.storeValue("pingIntervalMs", pingIntervalMs);
+
+				_data.push_back(std::make_unique<PingData>(host));
+			}
+
+			const auto cpuStart{ processCpuTime() };
+			ut::Stopwatch<> stopwatch;
+
+			for (unsigned i{}; i < sections; ++i)
+			{
+				monitors.push_back(std::make_unique<PingMonitor>(
+					*_hosts[i], hwnd, i, network));
+			}
+
+			SetTimer(hwnd, 1, static_cast<UINT>(seconds * 1000.0), nullptr);
+
+			MSG message;
+
+			while (GetMessageW(&message, nullptr, 0, 0) > 0)
+			{
+				if (message.hwnd == hwnd && message.message == WM_TIMER)
+				{
+					break;
+				}
+
+				TranslateMessage(&message);
+				DispatchMessageW(&message);
+			}
+
+			const auto wallSeconds{ stopwatch.elapsed<ut::seconds_f64>().count() };
+			const auto cpuSeconds{ ut::seconds_f64{ processCpuTime() - cpuStart }.count() };
+
+			// Monitors block in SendMessage while we join them, 
+			// destroying the window first makes that fail instead.
+			DestroyWindow(hwnd);
+			monitors.clear();
+
+			const auto stats{ network.stats() };
+			const auto results{ _pingResults + _traceResults };
+
+			return ut::formatString(
+				"sections            %u\r\n"
+				"ping interval       %u ms\r\n"
+				"duration            %.2f s\r\n"
+				"probes sent         %llu\r\n"
+				"results delivered   %llu (%llu ping, %llu trace)\r\n"
+				"replies / timeouts  %llu / %llu\r\n"
+				"results per second  %.1f\r\n"
+				"cpu per result      %.2f us\r\n"
+				"mean abs error      %.3f ms\r\n"
+				"max abs error       %.3f ms\r\n",
+				sections, 
+				pingIntervalMs, 
+				wallSeconds,
+				static_cast<unsigned long long>(stats.probes),
+				static_cast<unsigned long long>(results),
+				static_cast<unsigned long long>(_pingResults),
+				static_cast<unsigned long long>(_traceResults),
+				static_cast<unsigned long long>(stats.replies),
+				static_cast<unsigned long long>(stats.timeouts),
+				results / wallSeconds,
+				results > 0 ? 1e6 * cpuSeconds / results : 0.0,
+				stats.meanAbsErrorMs,
+				stats.maxAbsErrorMs);
+		}
+
+	private:
+		HWND createMessageWindow()
+		{
+			WNDCLASSEXW windowClassEx{};
+			windowClassEx.cbSize = sizeof windowClassEx;
+			windowClassEx.hInstance = GetModuleHandleW(nullptr);
+			windowClassEx.lpfnWndProc = windowProc;
+			windowClassEx.lpszClassName = WND_CLASSNAME;
+
+			RegisterClassExW(&windowClassEx);
+
+			const auto hwnd{ CreateWindowExW(0, WND_CLASSNAME, L"", 0, 0, 0, 0, 0,
+				HWND_MESSAGE, nullptr, GetModuleHandleW(nullptr), nullptr) };
+
+			if (hwnd == nullptr)
+			{
+				throw wa::WindowsError{ "CreateWindowEx()" };
+			}
+
+			SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+
+			return hwnd;
+		}
+
+		static LRESULT CALLBACK windowProc(
+			HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+		{
+			const auto self{ reinterpret_cast<SimulationBenchmark*>(
+				GetWindowLongPtrW(hwnd, GWLP_USERDATA)) };
+
+			if (self != nullptr)
+			{
+				switch (message)
+				{
+				default:
+				{} break;
+
+				case WM_PING_RESULT:
+				{
+					self->_data[wparam]->insertPingResult(
+						*reinterpret_cast<IcmpEchoResult*>(lparam));
+					self->_pingResults += 1;
+				}	return 0;
+
+				case WM_TRACE_RESULT:
+				{
+					self->_data[wparam]->insertTraceResult(
+						*reinterpret_cast<IcmpEchoResult*>(lparam));
+					self->_traceResults += 1;
+				}	return 0;
+				}
+			}
+
+			return DefWindowProcW(hwnd, message, wparam, lparam);
+		}
+
+		static cr::nanoseconds processCpuTime()
+		{
+			FILETIME creation, exit, kernel, user;
+			GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+
+			const auto ticks{ [](FILETIME t) {
+				return (static_cast<std::uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+			} };
+
+			// FILETIME counts 100 ns intervals.
+			return cr::nanoseconds{ 100 * (ticks(kernel) + ticks(user)) };
+		}
+	};
+}
@@ -0,0 +1,73 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "canvas_drawing.hpp"
+#include "ping_data.hpp"
+#include "ping_plotter.hpp"
+#include "png_encoder.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace pingstats // export
+{
+	namespace cr = std::chrono;
+
+	// Renders sections into PNG images without a window. The canvas and 
+	// buffers are reused, so snapshots of one size don't allocate.
+	class SnapshotRenderer
+	{
+		Canvas _canvas;
+		std::vector<std::uint8_t> _scratch;
+		std::vector<std::uint8_t> _png;
+
+	public:
+		const std::vector<std::uint8_t>& render(
+			PingPlotter& plotter,
+			const PingData& pingData,
+			pxindex width,
+			pxindex height,
+			cr::steady_clock::time_point now)
+		{
+			resizeCanvas(_canvas, width, height);
+
+			// The canvas may hold another section, so the plotter has to 
+			// draw its background and border again.
+			plotter.invalidate();
+			plotter.redraw(_canvas, Rect{ 0, 0, width, height }, pingData, now, now, false);
+
+			encodePng(_png, _scratch, _canvas.pixelPtr(), 
+				static_cast<std::size_t>(width), static_cast<std::size_t>(height), 
+				static_cast<std::size_t>(width));
+
+			return _png;
+		}
+
+		Canvas& canvas()
+		{
+			return _canvas;
+		}
+	};
+}
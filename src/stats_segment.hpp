@@ -0,0 +1,539 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility/utility.hpp"
+#include "utility/seqlock.hpp"
+
+#if defined _WIN32
+#include "winapi/utility.hpp"
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace pingstats // export
+{
+	namespace ut = utility;
+
+	// Fixed layout of the shared memory segment pingstats publishes its 
+	// per-section statistics to. Every section is guarded by its own
+	// sequence lock, so readers in other processes can poll the mapped 
+	// memory without any system calls. Bump the version on layout changes.
+
+	static constexpr std::uint32_t STATS_SEGMENT_MAGIC{ 0x50535447 }; // "PSTG"
+	static constexpr std::uint32_t STATS_SEGMENT_VERSION{ 2 };
+	static constexpr std::size_t STATS_SEGMENT_RING_CAPACITY{ 256 };
+	static constexpr std::size_t STATS_SEGMENT_TRACE_CAPACITY{ 64 };
+	static constexpr std::size_t STATS_SEGMENT_NAME_SIZE{ 56 };
+
+	static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+	struct StatsSegmentHeader
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t sectionCount;
+		std::uint32_t ringCapacity;
+		std::uint64_t segmentSize;
+		std::uint64_t sectionSize;
+		std::uint32_t traceCapacity;
+	};
+
+	struct StatsSegmentSample
+	{
+		std::int64_t sentTimeNs; // steady_clock::time_point::time_since_epoch()
+		std::int64_t latencyNs;
+		std::uint32_t errorCode;
+		std::uint32_t statusCode;
+		std::uint32_t responderIpv4; // Network byte order
+	};
+
+	struct alignas(64) StatsSegmentSection
+	{
+		ut::SeqLock lock;
+		std::uint32_t responderIpv4; // Network byte order
+		char name[STATS_SEGMENT_NAME_SIZE];
+		std::uint64_t pingResultCount;
+		std::uint64_t sampleCount; // Next ring index is sampleCount % ringCapacity
+		double lastPing;
+		double meanPing;
+		double maxPing;
+		double jitter;
+		double lossPercentage;
+		std::uint64_t traceSampleCount; // Next trace index is traceSampleCount % traceCapacity
+		StatsSegmentSample samples[STATS_SEGMENT_RING_CAPACITY];
+		StatsSegmentSample traceSamples[STATS_SEGMENT_TRACE_CAPACITY];
+	};
+
+	static_assert(sizeof(StatsSegmentHeader) <= 64);
+
+	constexpr std::size_t statsSegmentSize(std::size_t sectionCount)
+	{
+		return 64 + sectionCount * sizeof(StatsSegmentSection);
+	}
+
+	class StatsSegmentMapping
+	{
+#if defined _WIN32
+		wa::HandlePtr _owner;
+		wa::HandlePtr _mapping;
+#else
+		std::string _unlinkName;
+		int _owner{ -1 };
+#endif
+		void* _view{};
+		std::size_t _size{};
+
+	public:
+		~StatsSegmentMapping()
+		{
+#if defined _WIN32
+			if (_view != nullptr)
+			{
+				UnmapViewOfFile(_view);
+			}
+
+			if (_owner != nullptr)
+			{
+				ReleaseMutex(_owner.get());
+			}
+#else
+			if (_view != nullptr)
+			{
+				munmap(_view, _size);
+			}
+
+			if (_owner >= 0)
+			{
+				shm_unlink(_unlinkName.c_str());
+				close(_owner);
+			}
+#endif
+		}
+
+		StatsSegmentMapping(StatsSegmentMapping&&) = delete;
+
+		// Creates a new segment, or takes over one left behind by an instance
+		// that died. Fails while another instance is still writing to it.
+		StatsSegmentMapping(const std::string& name, std::size_t size)
+			: _size{ size }
+		{
+#if defined _WIN32
+			// The mapping lives on as long as any reader keeps it open, so
+			// ownership is a named mutex, which is abandoned when its owner dies.
+			const auto wname{ wa::wstr(name) };
+			const auto wownerName{ wa::wstr(name + ".owner") };
+
+			_owner.reset(CreateMutexW(nullptr, false, wownerName.c_str()));
+
+			if (_owner == nullptr)
+			{
+				throw wa::WindowsError{ "CreateMutex()" };
+			}
+
+			const auto wait{ WaitForSingleObject(_owner.get(), 0) };
+
+			if (wait != WAIT_OBJECT_0 && wait != WAIT_ABANDONED)
+			{
+				_owner = nullptr;
+				throw std::runtime_error("Stats segment \"" + name + "\" is in use.");
+			}
+
+			// An existing mapping keeps its size, mapping
+			// more than that fails below.
+			_mapping.reset(CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+				static_cast<DWORD>(static_cast<std::uint64_t>(size) >> 32),
+				static_cast<DWORD>(size), wname.c_str()));
+
+			if (_mapping == nullptr)
+			{
+				throw wa::WindowsError{ "CreateFileMapping()" };
+			}
+
+			_view = MapViewOfFile(_mapping.get(), FILE_MAP_ALL_ACCESS, 0, 0, size);
+
+			if (_view == nullptr)
+			{
+				throw wa::WindowsError{ "MapViewOfFile()" };
+			}
+#else
+			const auto posixName{ "/" + name };
+			const auto fd{ shm_open(posixName.c_str(), O_RDWR | O_CREAT, 0644) };
+
+			if (fd < 0)
+			{
+				throw std::runtime_error("shm_open() failed for \"" + posixName + "\".");
+			}
+
+			// The lock is released when its owner dies, so a
+			// segment left behind by a crash can be taken over.
+			if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+			{
+				close(fd);
+				throw std::runtime_error("Stats segment \"" + posixName + "\" is in use.");
+			}
+
+			struct stat info{};
+
+			if (fstat(fd, &info) == 0)
+			{
+				const auto existingSize{ static_cast<std::size_t>(info.st_size) };
+
+				// Never shrinks, readers still attached to a stale segment would fault.
+				_size = std::max(size, existingSize);
+
+				if (existingSize >= size || ftruncate(fd, static_cast<off_t>(size)) == 0)
+				{
+					_view = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				}
+			}
+
+			if (_view == MAP_FAILED || _view == nullptr)
+			{
+				_view = nullptr;
+				shm_unlink(posixName.c_str());
+				close(fd);
+				throw std::runtime_error("Mapping \"" + posixName + "\" failed.");
+			}
+
+			// Unlinked before the lock is released on destruction,
+			// so nobody takes over a segment that is going away.
+			_unlinkName = posixName;
+			_owner = fd;
+#endif
+		}
+
+		// Opens an existing segment read-only.
+		explicit StatsSegmentMapping(const std::string& name)
+		{
+#if defined _WIN32
+			const auto wname{ wa::wstr(name) };
+
+			_mapping.reset(OpenFileMappingW(FILE_MAP_READ, false, wname.c_str()));
+
+			if (_mapping == nullptr)
+			{
+				throw wa::WindowsError{ "OpenFileMapping()" };
+			}
+
+			// Size 0 maps the whole segment.
+			_view = MapViewOfFile(_mapping.get(), FILE_MAP_READ, 0, 0, 0);
+
+			if (_view == nullptr)
+			{
+				throw wa::WindowsError{ "MapViewOfFile()" };
+			}
+
+			// Nothing in the header can be trusted before the reader validated it,
+			// so the size comes from the system, which rounds it up to whole pages.
+			MEMORY_BASIC_INFORMATION info{};
+
+			if (VirtualQuery(_view, &info, sizeof info) == 0)
+			{
+				const wa::WindowsError error{ "VirtualQuery()" };
+				UnmapViewOfFile(_view);
+				throw error;
+			}
+
+			_size = info.RegionSize;
+#else
+			const auto posixName{ "/" + name };
+			const auto fd{ shm_open(posixName.c_str(), O_RDONLY, 0) };
+
+			if (fd < 0)
+			{
+				throw std::runtime_error("shm_open() failed for \"" + posixName + "\".");
+			}
+
+			struct stat info{};
+
+			if (fstat(fd, &info) == 0 && info.st_size > 0)
+			{
+				_size = static_cast<std::size_t>(info.st_size);
+				_view = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+			}
+
+			close(fd);
+
+			if (_view == MAP_FAILED || _view == nullptr)
+			{
+				_view = nullptr;
+				throw std::runtime_error("Mapping \"" + posixName + "\" failed.");
+			}
+#endif
+		}
+
+		auto data() const
+		{
+			return _view;
+		}
+
+		auto size() const
+		{
+			return _size;
+		}
+	};
+
+	class StatsSegmentWriter
+	{
+		StatsSegmentMapping _mapping;
+		StatsSegmentHeader* _header;
+		StatsSegmentSection* _sections;
+
+	public:
+		StatsSegmentWriter(const std::string& name, std::size_t sectionCount)
+			: _mapping{ name, statsSegmentSize(sectionCount) }
+			, _header{ static_cast<StatsSegmentHeader*>(_mapping.data()) }
+			, _sections{ reinterpret_cast<StatsSegmentSection*>(
+				static_cast<char*>(_mapping.data()) + 64) }
+		{
+			_header->magic = 0;
+			std::atomic_thread_fence(std::memory_order_release);
+
+			// The memory is either zeroed or a segment taken over from an instance
+			// that died, which readers may still be polling. So sections are reset 
+			// under their lock instead of constructed, which would reset the lock.
+			for (std::size_t i{}; i < sectionCount; ++i)
+			{
+				auto& section{ _sections[i] };
+				const auto offset{ offsetof(StatsSegmentSection, responderIpv4) };
+
+				section.lock.beginAbandonedWrite();
+				std::memset(reinterpret_cast<char*>(&section) + offset, 0, sizeof section - offset);
+				section.lock.endWrite();
+			}
+
+			_header->sectionCount = static_cast<std::uint32_t>(sectionCount);
+			_header->ringCapacity = static_cast<std::uint32_t>(STATS_SEGMENT_RING_CAPACITY);
+			_header->traceCapacity = static_cast<std::uint32_t>(STATS_SEGMENT_TRACE_CAPACITY);
+			_header->segmentSize = statsSegmentSize(sectionCount);
+			_header->sectionSize = sizeof(StatsSegmentSection);
+			_header->version = STATS_SEGMENT_VERSION;
+
+			// Written last, readers refuse to attach before it is set.
+			std::atomic_thread_fence(std::memory_order_release);
+			_header->magic = STATS_SEGMENT_MAGIC;
+		}
+
+		auto sectionCount() const
+		{
+			return static_cast<std::size_t>(_header->sectionCount);
+		}
+
+		// writer(StatsSegmentSection&) is called inside the write section.
+		template <typename Writer>
+		void writeSection(std::size_t index, Writer&& writer)
+		{
+			auto& section{ _sections[index] };
+
+			section.lock.beginWrite();
+			writer(section);
+			section.lock.endWrite();
+		}
+
+		void setSectionName(std::size_t index, std::string_view name)
+		{
+			writeSection(index, [name](StatsSegmentSection& section) {
+				const auto size{ std::min(name.size(), STATS_SEGMENT_NAME_SIZE - 1) };
+				std::memcpy(section.name, name.data(), size);
+				section.name[size] = '\0';
+			});
+		}
+
+		// Overwrites the oldest sample of the ring. Samples are kept in the
+		// order they arrived, a late result follows the ones sent after it.
+		static void appendSample(StatsSegmentSection& section, const StatsSegmentSample& sample)
+		{
+			section.samples[section.sampleCount % STATS_SEGMENT_RING_CAPACITY] = sample;
+			section.sampleCount += 1;
+		}
+
+		static void appendTraceSample(StatsSegmentSection& section, const StatsSegmentSample& sample)
+		{
+			section.traceSamples[section.traceSampleCount % STATS_SEGMENT_TRACE_CAPACITY] = sample;
+			section.traceSampleCount += 1;
+		}
+	};
+
+	struct StatsSegmentSummary
+	{
+		char name[STATS_SEGMENT_NAME_SIZE];
+		std::uint32_t responderIpv4;
+		std::uint64_t pingResultCount;
+		std::uint64_t sampleCount;
+		std::uint64_t traceSampleCount;
+		double lastPing;
+		double meanPing;
+		double maxPing;
+		double jitter;
+		double lossPercentage;
+	};
+
+	// A section whose writer died inside a write, it can't be read 
+	// again before another writer takes the segment over.
+	class StaleStatsSegmentError : public std::runtime_error
+	{
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	class StatsSegmentReader
+	{
+		StatsSegmentMapping _mapping;
+		const StatsSegmentHeader* _header;
+		const char* _sections;
+		std::size_t _sectionCount{};
+
+	public:
+		explicit StatsSegmentReader(const std::string& name)
+			: _mapping{ name }
+			, _header{ static_cast<const StatsSegmentHeader*>(_mapping.data()) }
+			, _sections{ static_cast<const char*>(_mapping.data()) + 64 }
+		{
+			// The rest of the header means nothing before these are checked.
+			if (_mapping.size() < 64 ||
+				_header->magic != STATS_SEGMENT_MAGIC ||
+				_header->version != STATS_SEGMENT_VERSION)
+			{
+				throw std::runtime_error("Incompatible stats segment \"" + name + "\".");
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			// Kept, a writer taking the segment over later may change the header.
+			_sectionCount = _header->sectionCount;
+
+			if (_header->sectionSize != sizeof(StatsSegmentSection) ||
+				_header->ringCapacity != STATS_SEGMENT_RING_CAPACITY ||
+				_header->traceCapacity != STATS_SEGMENT_TRACE_CAPACITY ||
+				_header->segmentSize != statsSegmentSize(_sectionCount) ||
+				_header->segmentSize > _mapping.size())
+			{
+				throw std::runtime_error("Corrupt stats segment \"" + name + "\".");
+			}
+		}
+
+		auto sectionCount() const
+		{
+			return _sectionCount;
+		}
+
+		// reader(const StatsSegmentSection&) reads the section in place. It may be 
+		// invoked more than once and must not act on the data before this returns.
+		// Throws StaleStatsSegmentError if the section stays locked.
+		template <typename Reader>
+		auto readSection(std::size_t index, Reader&& reader) const
+		{
+			if (index >= _sectionCount)
+			{
+				throw std::out_of_range("Stats segment section index out of range.");
+			}
+
+			const auto& section{ *reinterpret_cast<const StatsSegmentSection*>(
+				_sections + index * sizeof(StatsSegmentSection)) };
+
+			// Writes take microseconds, a lock held far longer than that is abandoned.
+			auto result{ section.lock.tryReadFor(
+				[&] { return reader(section); }, std::chrono::milliseconds{ 250 }) };
+
+			if (!result)
+			{
+				throw StaleStatsSegmentError("Stats segment section " + 
+					std::to_string(index) + " is stale, its writer died inside a write.");
+			}
+
+			return *result;
+		}
+
+		StatsSegmentSummary loadSummary(std::size_t index) const
+		{
+			return readSection(index, [](const StatsSegmentSection& section) {
+				StatsSegmentSummary summary;
+
+				std::memcpy(summary.name, section.name, sizeof summary.name);
+				summary.name[sizeof summary.name - 1] = '\0';
+				summary.responderIpv4 = section.responderIpv4;
+				summary.pingResultCount = section.pingResultCount;
+				summary.sampleCount = section.sampleCount;
+				summary.traceSampleCount = section.traceSampleCount;
+				summary.lastPing = section.lastPing;
+				summary.meanPing = section.meanPing;
+				summary.maxPing = section.maxPing;
+				summary.jitter = section.jitter;
+				summary.lossPercentage = section.lossPercentage;
+
+				return summary;
+			});
+		}
+
+		// Copies up to maxSamples of the most recent samples, oldest first.
+		// Returns the number of samples copied.
+		std::size_t loadRecentSamples(std::size_t index, 
+			StatsSegmentSample* samples, std::size_t maxSamples) const
+		{
+			return readSection(index, [=](const StatsSegmentSection& section) {
+				return copyRecent(section.samples, STATS_SEGMENT_RING_CAPACITY,
+					section.sampleCount, samples, maxSamples);
+			});
+		}
+
+		// Same for the trace results, which are kept apart from the pings.
+		std::size_t loadRecentTraceSamples(std::size_t index, 
+			StatsSegmentSample* samples, std::size_t maxSamples) const
+		{
+			return readSection(index, [=](const StatsSegmentSection& section) {
+				return copyRecent(section.traceSamples, STATS_SEGMENT_TRACE_CAPACITY,
+					section.traceSampleCount, samples, maxSamples);
+			});
+		}
+
+	private:
+		static std::size_t copyRecent(const StatsSegmentSample* ring, std::size_t capacity,
+			std::uint64_t total, StatsSegmentSample* samples, std::size_t maxSamples)
+		{
+			const auto n{ static_cast<std::size_t>(std::min<std::uint64_t>(
+				{ total, maxSamples, capacity })) };
+
+			for (std::size_t i{}; i < n; ++i)
+			{
+				samples[i] = ring[(total - n + i) % capacity];
+			}
+
+			return n;
+		}
+	};
+}
@@ -26,9 +26,12 @@
 #include "utility/utility.hpp"
 #include "winapi/utility.hpp"
 #include "canvas_drawing.hpp"
+#include "glyph_atlas.hpp"
 
 #include <algorithm>
-#include <vector>
+#include <array>
+#include <cstdint>
+#include <string_view>
 
 namespace pingstats // export
 {
@@ -37,160 +40,126 @@ namespace pingstats // export
 	namespace ut = utility;
 	namespace wa = winapi;
 
-	class FontSpacing
+	// Renders the printable glyphs of a GDI font into a GlyphAtlas.
+	GlyphAtlas makeGdiGlyphAtlas(const LOGFONT& logFont)
 	{
-	public:
-		LONG fontWidth{ 8 };
-		LONG fontHeight{ 16 };
-		LONG fontLineSpacing{ 16 };
-	};
-
-	class StringCache
-	{
-		static constexpr std::size_t CACHE_MAX_SIZE{ 512 };
-		static constexpr std::size_t CACHE_CLEAR_SIZE{ 256 };
+		wa::MemoryCanvas cell;
+		wa::FontPtr font{ CreateFontIndirectW(&logFont) };
+		wa::DeviceContext deviceContext{ CreateCompatibleDC(nullptr) };
 
-		class ColoredString
-		{
-		public:
-			wa::MemoryCanvas canvas;
-			std::string str;
-			Color clearColor{ 0, 0, 0 };
-			Color stringColor{ 0, 0, 0 };
-			
-			mutable uint32_t usageCounter = {};
-
-			ColoredString() = default;
-
-			ColoredString(std::string str, Color clearColor, Color stringColor)
-				: str{ std::move(str) }
-				, clearColor{ clearColor }
-				, stringColor{ stringColor }
-			{}
-
-			bool operator == (const ColoredString& rhs) const
-			{
-				return str == rhs.str 
-					&& clearColor.value == rhs.clearColor.value 
-					&& stringColor.value == rhs.stringColor.value;
-			}
-		};
+		deviceContext.select(font.get());
 
-		std::vector<ColoredString> _cache;
-		wa::DeviceContext _deviceContext;
-		wa::FontPtr _font;
-		LOGFONT _logFont;
-		FontSpacing _spacing{};
+		FontSpacing spacing{};
+		TEXTMETRIC metric;
 
-	public:
-		StringCache(const LOGFONT& logFont)
-			: _deviceContext{ CreateCompatibleDC(nullptr) }
-			, _font{ CreateFontIndirectW(&logFont) }
-			, _logFont{ logFont }
+		if (GetTextMetricsW(deviceContext.get(), &metric))
 		{
-			_deviceContext.select(_font.get());
+			spacing.fontHeight = metric.tmHeight;
+			spacing.fontLineSpacing = metric.tmHeight + metric.tmExternalLeading;
+		}
 
-			TEXTMETRIC metric;
+		// Advances come from the font, only TrueType fonts report how far the 
+		// ink reaches, for the others it ends at the advance. Ink left of the 
+		// origin is cut off. The cell fits the widest glyph.
+		std::array<ABC, GlyphAtlas::GLYPH_COUNT> abc{};
+		std::array<INT, GlyphAtlas::GLYPH_COUNT> widths{};
+		std::array<pxindex, GlyphAtlas::GLYPH_COUNT> advances{};
+		std::array<pxindex, GlyphAtlas::GLYPH_COUNT> inkWidths{};
 
-			if (GetTextMetricsW(_deviceContext.get(), &metric))
+		if (GetCharABCWidthsW(deviceContext.get(), 
+			GlyphAtlas::FIRST_GLYPH, GlyphAtlas::LAST_GLYPH, abc.data()))
+		{
+			for (std::size_t i{}; i < GlyphAtlas::GLYPH_COUNT; ++i)
 			{
-				_spacing.fontWidth = metric.tmAveCharWidth;
-				_spacing.fontHeight = metric.tmHeight;
-				_spacing.fontLineSpacing = metric.tmHeight + metric.tmExternalLeading;
+				advances[i] = abc[i].abcA + static_cast<pxindex>(abc[i].abcB) + abc[i].abcC;
+				inkWidths[i] = std::max(advances[i], abc[i].abcA + static_cast<pxindex>(abc[i].abcB));
 			}
 		}
-
-		auto& getLogicalFont() const
+		else if (GetCharWidth32W(deviceContext.get(), 
+			GlyphAtlas::FIRST_GLYPH, GlyphAtlas::LAST_GLYPH, widths.data()))
 		{
-			return _logFont;
+			std::copy(widths.begin(), widths.end(), advances.begin());
+			inkWidths = advances;
 		}
-
-		auto& getFontSpacing() const
+		else
 		{
-			return _spacing;
+			advances.fill(spacing.fontWidth);
+			inkWidths = advances;
 		}
 
-		void draw(
-			wa::MemoryCanvas& canvas, 
-			Color clearColor, 
-			Color stringColor, 
-			int32_t x, int32_t y,
-			std::string s)
-		{
-			if (s.size() == 0)
-			{
-				return;
-			}
+		spacing.fontWidth = std::max(*std::max_element(inkWidths.begin(), inkWidths.end()), pxindex{ 1 });
 
-			shrink();
+		GlyphAtlas atlas{ spacing };
 
-			ColoredString cs{ std::move(s), clearColor, stringColor };
-			auto it = std::find(_cache.begin(), _cache.end(), cs);
-
-			if (it == _cache.end())
-			{
-				const auto strSize = static_cast<int>(cs.str.size());
+		for (std::size_t i{}; i < GlyphAtlas::GLYPH_COUNT; ++i)
+		{
+			atlas.setAdvance(static_cast<char>(GlyphAtlas::FIRST_GLYPH + i), advances[i], inkWidths[i]);
+		}
 
-				cs.canvas = wa::MemoryCanvas{ 
-					strSize * _spacing.fontWidth, _spacing.fontHeight };
+		cell = wa::MemoryCanvas{ spacing.fontWidth, spacing.fontHeight };
 
-				_deviceContext.select(cs.canvas.get());
+		deviceContext.select(cell.get());
 
-				clearCanvas(cs.canvas, clearColor);
+		SetBkMode(deviceContext.get(), TRANSPARENT);
+		SetTextColor(deviceContext.get(), RGB(0xFF, 0xFF, 0xFF));
 
-				SetBkMode(_deviceContext.get(), TRANSPARENT);
-				SetTextColor(_deviceContext.get(), stringColor.toColorRef());
+		for (auto c{ GlyphAtlas::FIRST_GLYPH }; c <= GlyphAtlas::LAST_GLYPH; ++c)
+		{
+			const auto glyph{ static_cast<char>(c) };
 
-				TextOutA(_deviceContext.get(), 0, 0, cs.str.data(), strSize);
+			clearCanvas(cell, Color{ 0, 0, 0 });
+			TextOutA(deviceContext.get(), 0, 0, &glyph, 1);
+			GdiFlush();
 
-				_cache.push_back(std::move(cs));
+			// White on black, so any channel is the coverage. ClearType 
+			// renders per channel, the average drops the colour fringes.
+			const auto mask{ atlas.glyph(glyph) };
 
-				it = _cache.begin() + (_cache.size() - 1);
+			for (std::size_t i{}; i < cell.size(); ++i)
+			{
+				const Color pixel{ cell.pixelPtr()[i] };
+				mask[i] = static_cast<std::uint8_t>((pixel.r() + pixel.g() + pixel.b()) / 3);
 			}
+		}
 
-			it->usageCounter += 1;
+		return atlas;
+	}
 
-			const Rect rect{
-				x, y, 
-				x + static_cast<pxindex>(it->canvas.width()), 
-				y + static_cast<pxindex>(it->canvas.height())
-			};
+	// Draws strings in a GDI font, composited from a GlyphAtlas.
+	class StringCache
+	{
+		GlyphAtlas _atlas;
+		LOGFONT _logFont;
 
-			copyCanvasRect(canvas, it->canvas, rect, 0, 0);
-		}
+	public:
+		StringCache(const LOGFONT& logFont)
+			: _atlas{ makeGdiGlyphAtlas(logFont) }
+			, _logFont{ logFont }
+		{}
 
-		void shrink()
+		auto& getLogicalFont() const
 		{
-			if (_cache.size() >= CACHE_MAX_SIZE)
-			{
-				std::sort(_cache.begin(), _cache.end(), 
-					[](const ColoredString& lhs, const ColoredString& rhs) {
-						return lhs.usageCounter > rhs.usageCounter;
-					}
-				);
-
-				_cache.resize(CACHE_CLEAR_SIZE);
-			}
+			return _logFont;
 		}
-	};
 
-	StringCache& getStaticStringCache(const LOGFONT& logFont)
-	{
-		thread_local std::vector<StringCache> cache;
-
-		for (size_t i = 0; i < cache.size(); ++i)
+		auto& getFontSpacing() const
 		{
-			if (std::memcmp(
-				&cache[i].getLogicalFont(), 
-				&logFont, 
-				sizeof logFont) == 0)
-			{
-				return cache[i];
-			}
+			return _atlas.getFontSpacing();
 		}
 
-		cache.emplace_back(logFont);
+		auto& atlas() const
+		{
+			return _atlas;
+		}
 
-		return cache.back();
-	}
+		void draw(
+			Canvas& canvas, 
+			Color clearColor, 
+			Color stringColor, 
+			int32_t x, int32_t y,
+			std::string_view s) const
+		{
+			_atlas.draw(canvas, clearColor, stringColor, x, y, s);
+		}
+	};
 }
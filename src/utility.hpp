@@ -25,6 +25,8 @@
 
 #include "utility/utility.hpp"
 
+#include <algorithm>
+
 namespace pingstats // export
 {
 	template <typename To, typename From>
@@ -48,6 +50,12 @@ namespace pingstats // export
 		return static_cast<To>(value + From{ 0.5 });
 	}
 
+	// Rounds towards negative infinity, the built-in division truncates.
+	constexpr std::int64_t floorDiv(std::int64_t a, std::int64_t b)
+	{
+		return a / b - (a % b != 0 && (a < 0) != (b < 0));
+	}
+
 	std::vector<std::string> parseWords(const std::string& source)
 	{
 		const auto skipSpaces{ [](const char* s) {
@@ -0,0 +1,342 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "utility.hpp"
+#include "read_file.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined _M_X64 || defined _M_IX86 || defined __x86_64__ || defined __i386__
+#define PINGSTATS_TRACE_TSC
+#if defined _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Event tracing for looking at how the threads interact, dumped as Chrome
+// trace_event JSON (chrome://tracing, ui.perfetto.dev). Events go into a
+// fixed size ring per thread, so recording takes no locks. Defining 
+// PINGSTATS_DISABLE_TRACING compiles the trace macros out entirely.
+
+#define PINGSTATS_TRACE_CONCAT_(a, b) a##b
+#define PINGSTATS_TRACE_CONCAT(a, b) PINGSTATS_TRACE_CONCAT_(a, b)
+
+#if defined PINGSTATS_DISABLE_TRACING
+#define PINGSTATS_TRACE_SCOPE(name, arg)
+#define PINGSTATS_TRACE_INSTANT(name, arg)
+#else
+#define PINGSTATS_TRACE_SCOPE(name, arg) ::utility::TraceScope \
+	PINGSTATS_TRACE_CONCAT(traceScope, __LINE__)( name, arg )
+#define PINGSTATS_TRACE_INSTANT(name, arg) ::utility::traceInstant(name, arg)
+#endif
+
+namespace utility // export
+{
+	// Only constructible from string literals, so events can keep the 
+	// pointer instead of copying the name.
+	class TraceName
+	{
+		const char* _name;
+
+	public:
+		template <std::size_t N>
+		constexpr TraceName(const char (&name)[N])
+			: _name{ name }
+		{}
+
+		constexpr const char* c_str() const
+		{
+			return _name;
+		}
+	};
+
+	struct TraceEvent
+	{
+		const char* name;
+		std::int64_t startTicks;
+		std::int64_t durationTicks; // < 0 for instant events
+		std::int64_t arg;
+	};
+
+	static_assert(sizeof(TraceEvent) == 32);
+
+	// Written by its thread only. Readers copy the events and then drop 
+	// the ones that may have been overwritten meanwhile, like a SeqLock.
+	class TraceBuffer
+	{
+	public:
+		static constexpr std::size_t CAPACITY{ 8192 };
+
+		std::array<TraceEvent, CAPACITY> events;
+		std::atomic<std::uint64_t> written{};
+		std::string threadName;
+
+		void push(const TraceEvent& event)
+		{
+			const auto index{ written.load(std::memory_order_relaxed) };
+			events[index % CAPACITY] = event;
+			written.store(index + 1, std::memory_order_release);
+		}
+
+		void copyTo(std::vector<TraceEvent>& out) const
+		{
+			const auto end{ written.load(std::memory_order_acquire) };
+			const auto begin{ end > CAPACITY ? end - CAPACITY : 0 };
+			const auto offset{ out.size() };
+
+			out.resize(offset + static_cast<std::size_t>(end - begin));
+
+			for (auto i{ begin }; i < end; ++i)
+			{
+				std::memcpy(&out[offset + static_cast<std::size_t>(i - begin)], 
+					&events[i % CAPACITY], sizeof(TraceEvent));
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			const auto now{ written.load(std::memory_order_relaxed) };
+			const auto overwritten{ now > CAPACITY ? now - CAPACITY : 0 };
+
+			if (overwritten > begin)
+			{
+				const auto drop{ static_cast<std::size_t>(std::min(overwritten, end) - begin) };
+				out.erase(out.begin() + offset, out.begin() + offset + drop);
+			}
+		}
+	};
+
+	// Event names are literals from the code, only thread names need this.
+	std::string escapeJson(const std::string& s)
+	{
+		std::string result;
+
+		for (const auto c : s)
+		{
+			if (c == '"' || c == '\\')
+			{
+				result += '\\';
+				result += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				result += formatString("\\u%04x", static_cast<unsigned>(c));
+			}
+			else
+			{
+				result += c;
+			}
+		}
+
+		return result;
+	}
+
+	class EventTracer
+	{
+		std::atomic<bool> _enabled{};
+
+		// Events are stamped with the time stamp counter where there is one, 
+		// which takes a fraction of reading a system clock. Ticks are converted 
+		// when dumping, by comparing how far both advanced since these. Each
+		// stamp is one counter read: an instant takes one, a scope two.
+		const std::int64_t _startTicks{ ticks() };
+		const std::chrono::steady_clock::time_point _start{ std::chrono::steady_clock::now() };
+
+		// Buffers outlive their threads, so events of finished threads
+		// still make it into the dump.
+		mutable std::mutex _mutex;
+		std::vector<std::unique_ptr<TraceBuffer>> _buffers;
+
+	public:
+		bool enabled() const
+		{
+			return _enabled.load(std::memory_order_relaxed);
+		}
+
+		void setEnabled(bool enabled)
+		{
+			_enabled.store(enabled, std::memory_order_relaxed);
+		}
+
+		static std::int64_t ticks()
+		{
+#if defined PINGSTATS_TRACE_TSC
+			return static_cast<std::int64_t>(__rdtsc());
+#else
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+		}
+
+		TraceBuffer& threadBuffer()
+		{
+			static thread_local TraceBuffer* buffer{};
+
+			if (buffer == nullptr)
+			{
+				std::lock_guard<std::mutex> lock{ _mutex };
+				_buffers.push_back(std::make_unique<TraceBuffer>());
+				buffer = _buffers.back().get();
+			}
+
+			return *buffer;
+		}
+
+		void setThreadName(std::string name)
+		{
+			auto& buffer{ threadBuffer() };
+
+			std::lock_guard<std::mutex> lock{ _mutex };
+			buffer.threadName = std::move(name);
+		}
+
+		void record(TraceName name, std::int64_t startTicks, std::int64_t durationTicks, std::int64_t arg)
+		{
+			threadBuffer().push(TraceEvent{ name.c_str(), startTicks, durationTicks, arg });
+		}
+
+		std::string toJson() const
+		{
+			// The rate comes from the whole recorded span. Reading both clocks 
+			// takes well under a microsecond, so spans of a millisecond are 
+			// already good to a few parts in ten thousand.
+			const auto elapsedTicks{ ticks() - _startTicks };
+			const auto elapsedUs{ std::chrono::duration<double, std::micro>(
+				std::chrono::steady_clock::now() - _start).count() };
+
+			// Assumes a constant rate counter, which x86 CPUs have had for long.
+			const auto usPerTick{ elapsedTicks > 0 ? elapsedUs / elapsedTicks : 1e-3 };
+
+			std::string json{ "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" };
+			std::vector<TraceEvent> events;
+			const char* separator{ "" };
+
+			std::lock_guard<std::mutex> lock{ _mutex };
+
+			for (std::size_t tid{ 1 }; tid <= _buffers.size(); ++tid)
+			{
+				const auto& buffer{ *_buffers[tid - 1] };
+
+				json += formatString(
+					"%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,"
+					"\"args\":{\"name\":\"%s\"}}",
+					separator, tid, 
+					escapeJson(buffer.threadName.empty() ? "thread" : buffer.threadName).c_str());
+
+				separator = ",";
+
+				events.clear();
+				buffer.copyTo(events);
+
+				for (const auto& event : events)
+				{
+					const auto ts{ (event.startTicks - _startTicks) * usPerTick };
+
+					if (event.durationTicks < 0)
+					{
+						json += formatString(
+							",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%zu,"
+							"\"ts\":%.3f,\"args\":{\"value\":%lld}}",
+							event.name, tid, ts, static_cast<long long>(event.arg));
+					}
+					else
+					{
+						json += formatString(
+							",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,"
+							"\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"value\":%lld}}",
+							event.name, tid, ts, event.durationTicks * usPerTick, 
+							static_cast<long long>(event.arg));
+					}
+				}
+			}
+
+			json += "\n]}\n";
+			return json;
+		}
+
+		bool writeJson(const std::string& filename) const
+		{
+			const auto json{ toJson() };
+			FileHandle file{ std::fopen(filename.c_str(), "wb") };
+
+			return file != nullptr && 
+				std::fwrite(json.data(), 1, json.size(), file.get()) == json.size();
+		}
+	};
+
+	EventTracer& eventTracer()
+	{
+		static EventTracer tracer;
+		return tracer;
+	}
+
+	// Records its lifetime as a complete ("X") event.
+	class TraceScope
+	{
+		static constexpr auto DISABLED{ std::numeric_limits<std::int64_t>::min() };
+
+		TraceName _name;
+		std::int64_t _arg;
+		std::int64_t _startTicks;
+
+	public:
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator = (const TraceScope&) = delete;
+
+		TraceScope(TraceName name, std::int64_t arg)
+			: _name{ name }
+			, _arg{ arg }
+			, _startTicks{ eventTracer().enabled() ? EventTracer::ticks() : DISABLED }
+		{}
+
+		~TraceScope()
+		{
+			if (_startTicks != DISABLED)
+			{
+				eventTracer().record(_name, _startTicks, EventTracer::ticks() - _startTicks, _arg);
+			}
+		}
+	};
+
+	void traceInstant(TraceName name, std::int64_t arg)
+	{
+		if (eventTracer().enabled())
+		{
+			eventTracer().record(name, EventTracer::ticks(), -1, arg);
+		}
+	}
+}
@@ -0,0 +1,168 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace utility // export
+{
+	// String with inline storage for text that is rebuilt every frame.
+	// Appending never allocates, anything past the capacity is cut off.
+
+	template <std::size_t N>
+	class FixedString
+	{
+		std::array<char, N> _data{};
+		std::size_t _size{};
+
+	public:
+		void clear()
+		{
+			_size = 0;
+		}
+
+		auto size() const
+		{
+			return _size;
+		}
+
+		auto empty() const
+		{
+			return _size == 0;
+		}
+
+		std::string_view view() const
+		{
+			return { _data.data(), _size };
+		}
+
+		FixedString& append(std::string_view s)
+		{
+			const auto count{ std::min(s.size(), N - _size) };
+			std::copy_n(s.data(), count, &_data[_size]);
+			_size += count;
+			return *this;
+		}
+
+		FixedString& append(char c, std::size_t count = 1)
+		{
+			count = std::min(count, N - _size);
+			std::fill_n(&_data[_size], count, c);
+			_size += count;
+			return *this;
+		}
+
+		// Like "%0*lld" with fill '0' or "%*lld" with fill ' '.
+		FixedString& appendInteger(
+			std::int64_t value, std::size_t width = 0, char fill = ' ')
+		{
+			std::array<char, 24> buffer;
+			const auto end{ std::to_chars(
+				buffer.data(), buffer.data() + buffer.size(), value).ptr };
+
+			return appendPadded({ buffer.data(), 
+				static_cast<std::size_t>(end - buffer.data()) }, width, fill);
+		}
+
+		// Like "%*.*f". Rounds through a scaled integer, which only 
+		// differs from printf in the last digit on exact ties.
+		FixedString& appendFixed(double value, int precision, std::size_t width = 0)
+		{
+			static constexpr std::array<std::int64_t, 7> POWERS{ 
+				1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+			precision = std::clamp(precision, 0, static_cast<int>(POWERS.size() - 1));
+			const auto power{ POWERS[precision] };
+
+			if (!std::isfinite(value) || std::abs(value) * power > 1e18)
+			{
+				return appendPadded(std::isnan(value) ? "nan" : 
+					value < 0.0 ? "-inf" : "inf", width, ' ');
+			}
+
+			const auto scaled{ std::llround(std::abs(value) * power) };
+
+			std::array<char, 32> buffer;
+			auto ptr{ buffer.data() };
+
+			// printf keeps the sign of values that round to zero.
+			if (std::signbit(value))
+			{
+				*ptr++ = '-';
+			}
+
+			ptr = std::to_chars(ptr, buffer.data() + buffer.size(), scaled / power).ptr;
+
+			if (precision > 0)
+			{
+				*ptr++ = '.';
+
+				// Leading zeros of the fraction.
+				const auto fraction{ scaled % power };
+
+				for (auto p{ power / 10 }; p > 1 && fraction < p; p /= 10)
+				{
+					*ptr++ = '0';
+				}
+
+				ptr = std::to_chars(ptr, buffer.data() + buffer.size(), fraction).ptr;
+			}
+
+			return appendPadded({ buffer.data(), 
+				static_cast<std::size_t>(ptr - buffer.data()) }, width, ' ');
+		}
+
+		bool operator == (const FixedString& rhs) const
+		{
+			return view() == rhs.view();
+		}
+
+		bool operator != (const FixedString& rhs) const
+		{
+			return !(*this == rhs);
+		}
+
+	private:
+		FixedString& appendPadded(std::string_view s, std::size_t width, char fill)
+		{
+			const auto padding{ width > s.size() ? width - s.size() : 0 };
+
+			// Zero padding goes after the sign.
+			if (fill == '0' && !s.empty() && s.front() == '-')
+			{
+				append('-');
+				s.remove_prefix(1);
+			}
+
+			append(fill, padding);
+			return append(s);
+		}
+	};
+}
@@ -46,7 +46,11 @@ namespace utility // export
 
 	using FileHandle = std::unique_ptr<std::FILE, FcloseType>;
 
+#if defined _MSC_VER
 	namespace filesystem = std::experimental::filesystem;
+#else
+	namespace filesystem = std::filesystem;
+#endif
 
 	template <typename Buffer>
 	Buffer readFileAs(filesystem::path filePath)
@@ -0,0 +1,199 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+namespace utility // export
+{
+	// Sequence lock for a single writer and any number of readers.
+	// The writer never blocks; readers retry until they observed
+	// a sequence number that didn't change while they were reading.
+
+	class SeqLock
+	{
+		std::atomic<std::uint32_t> _sequence{};
+
+	public:
+		SeqLock() = default;
+		SeqLock(SeqLock&&) = delete;
+
+		void beginWrite()
+		{
+			const auto sequence{ _sequence.load(std::memory_order_relaxed) };
+			_sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		// beginWrite() for a lock in shared memory whose 
+		// previous writer may have died inside a write.
+		void beginAbandonedWrite()
+		{
+			const auto sequence{ _sequence.load(std::memory_order_relaxed) };
+			_sequence.store(sequence | 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		void endWrite()
+		{
+			const auto sequence{ _sequence.load(std::memory_order_relaxed) };
+			_sequence.store(sequence + 1, std::memory_order_release);
+		}
+
+		auto sequence() const
+		{
+			return _sequence.load(std::memory_order_acquire);
+		}
+
+		// The reader may be invoked more than once and may observe torn data, 
+		// so it must not act on what it reads before read() returns.
+		template <typename Reader>
+		auto read(Reader&& reader) const
+		{
+			for (;;)
+			{
+				const auto before{ _sequence.load(std::memory_order_acquire) };
+
+				if (before & 1)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				if constexpr (std::is_void_v<decltype(reader())>)
+				{
+					reader();
+
+					if (validate(before))
+					{
+						return;
+					}
+				}
+				else
+				{
+					auto result{ reader() };
+
+					if (validate(before))
+					{
+						return result;
+					}
+				}
+			}
+		}
+
+		// read() for a lock in shared memory, which stays odd forever if the 
+		// writer died inside a write. Gives up once reading failed for timeout
+		// and returns an empty optional. The clock is only read after a failure.
+		template <typename Reader, typename Rep, typename Period>
+		auto tryReadFor(Reader&& reader, std::chrono::duration<Rep, Period> timeout) const
+			-> std::optional<decltype(reader())>
+		{
+			auto deadline{ std::chrono::steady_clock::time_point::max() };
+
+			const auto expired{ [&] {
+				const auto now{ std::chrono::steady_clock::now() };
+
+				if (deadline == std::chrono::steady_clock::time_point::max())
+				{
+					deadline = now + timeout;
+				}
+
+				return now >= deadline;
+			} };
+
+			for (;;)
+			{
+				const auto before{ _sequence.load(std::memory_order_acquire) };
+
+				if (before & 1)
+				{
+					if (expired())
+					{
+						return std::nullopt;
+					}
+
+					std::this_thread::yield();
+					continue;
+				}
+
+				auto result{ reader() };
+
+				if (validate(before))
+				{
+					return result;
+				}
+
+				if (expired())
+				{
+					return std::nullopt;
+				}
+			}
+		}
+
+	private:
+		bool validate(std::uint32_t before) const
+		{
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return _sequence.load(std::memory_order_relaxed) == before;
+		}
+	};
+
+	template <typename T>
+	class SeqLockValue
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		SeqLock _lock;
+		T _value{};
+
+	public:
+		SeqLockValue() = default;
+
+		explicit SeqLockValue(const T& value)
+			: _value(value)
+		{}
+
+		void store(const T& value)
+		{
+			_lock.beginWrite();
+			std::memcpy(&_value, &value, sizeof _value);
+			_lock.endWrite();
+		}
+
+		T load() const
+		{
+			return _lock.read([this] {
+				T value;
+				std::memcpy(&value, &_value, sizeof value);
+				return value;
+			});
+		}
+	};
+}
@@ -0,0 +1,200 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "event_trace.hpp"
+#include "scoped_thread.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utility // export
+{
+	// Persistent threads for data parallel loops. forEach(count, task) calls
+	// task(i) for every i in [0, count), spread over the workers and the
+	// calling thread, and returns once all calls have finished. Indices are
+	// handed out one at a time, so uneven tasks balance themselves.
+	class WorkerPool
+	{
+		std::mutex _mutex;
+		std::condition_variable _workAvailable;
+		std::condition_variable _workDone;
+
+		const std::function<void(std::size_t)>* _task{};
+		std::size_t _count{};
+		std::atomic<std::size_t> _next{};
+		std::size_t _busyWorkers{};
+		std::uint64_t _generation{};
+		std::exception_ptr _exception;
+		bool _stop{};
+
+		// Last, so the threads are joined before anything they use is gone.
+		std::vector<AutojoinThread> _threads;
+
+	public:
+		~WorkerPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock{ _mutex };
+				_stop = true;
+			}
+
+			_workAvailable.notify_all();
+		}
+
+		// The calling thread does work too, so threads is the total number
+		// of threads working on a loop. 0 means one per hardware thread.
+		explicit WorkerPool(std::size_t threads = 0)
+		{
+			if (threads == 0)
+			{
+				threads = std::thread::hardware_concurrency();
+			}
+
+			// hardware_concurrency() may return 0, which runs everything
+			// on the calling thread just like 1 would.
+			for (std::size_t i{ 1 }; i < threads; ++i)
+			{
+				_threads.emplace_back(std::thread{ [this] { workerLoop(); } });
+			}
+		}
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator = (const WorkerPool&) = delete;
+
+		std::size_t size() const
+		{
+			return _threads.size() + 1;
+		}
+
+		// Not reentrant. The first exception thrown by a task is rethrown
+		// here after all tasks have finished.
+		template <typename Task>
+		void forEach(std::size_t count, Task&& task)
+		{
+			if (_threads.empty() || count <= 1)
+			{
+				for (std::size_t i{}; i < count; ++i)
+				{
+					task(i);
+				}
+
+				return;
+			}
+
+			const std::function<void(std::size_t)> function{ std::ref(task) };
+
+			{
+				std::lock_guard<std::mutex> lock{ _mutex };
+
+				_task = &function;
+				_count = count;
+				_next = 0;
+				_busyWorkers = _threads.size();
+				_exception = nullptr;
+				_generation += 1;
+			}
+
+			_workAvailable.notify_all();
+
+			runTasks();
+
+			std::unique_lock<std::mutex> lock{ _mutex };
+			_workDone.wait(lock, [this] { return _busyWorkers == 0; });
+			_task = nullptr;
+
+			if (_exception)
+			{
+				std::rethrow_exception(_exception);
+			}
+		}
+
+	private:
+		void runTasks()
+		{
+			for (auto i{ _next.fetch_add(1) }; i < _count; i = _next.fetch_add(1))
+			{
+				try
+				{
+					(*_task)(i);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock{ _mutex };
+
+					if (!_exception)
+					{
+						_exception = std::current_exception();
+					}
+				}
+			}
+		}
+
+		void workerLoop()
+		{
+			eventTracer().setThreadName("worker");
+
+			std::uint64_t generation{};
+
+			for (;;)
+			{
+				{
+					std::unique_lock<std::mutex> lock{ _mutex };
+
+					_workAvailable.wait(lock, [&] { 
+						return _stop || _generation != generation; 
+					});
+
+					if (_stop)
+					{
+						return;
+					}
+
+					generation = _generation;
+				}
+
+				runTasks();
+
+				bool done;
+
+				{
+					std::lock_guard<std::mutex> lock{ _mutex };
+					done = --_busyWorkers == 0;
+				}
+
+				if (done)
+				{
+					_workDone.notify_one();
+				}
+			}
+		}
+	};
+}
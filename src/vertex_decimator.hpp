@@ -0,0 +1,122 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include "canvas_drawing.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace pingstats // export
+{
+	// Streaming M4 decimation of a polyline with increasing x. Of all
+	// vertices that round to the same pixel column only the first, the 
+	// minimum, the maximum and the last are passed on, in their original
+	// order, so a column never costs more than four segments and still
+	// covers the same pixels.
+	//
+	// A segment takes the colour of its end vertex. If any of the vertices
+	// merged into a segment has the emphasis colour (loss), the segment
+	// gets it too, so single lost samples stay visible.
+	class VertexDecimator
+	{
+		std::vector<Vertex> _column;
+		Color _emphasis{};
+
+	public:
+		explicit VertexDecimator(Color emphasis = Color{})
+			: _emphasis{ emphasis }
+		{}
+
+		void push(std::vector<Vertex>& output, const Vertex& vertex)
+		{
+			if (!_column.empty() && 
+				fastround<pxindex>(_column.front().x) != fastround<pxindex>(vertex.x))
+			{
+				flush(output);
+			}
+
+			_column.push_back(vertex);
+		}
+
+		void flush(std::vector<Vertex>& output)
+		{
+			if (_column.empty())
+			{
+				return;
+			}
+
+			std::size_t minIndex{};
+			std::size_t maxIndex{};
+
+			for (std::size_t i{ 1 }; i < _column.size(); ++i)
+			{
+				if (_column[i].y < _column[minIndex].y)
+				{
+					minIndex = i;
+				}
+
+				if (_column[i].y > _column[maxIndex].y)
+				{
+					maxIndex = i;
+				}
+			}
+
+			const std::array<std::size_t, 4> picks{ 
+				0, 
+				std::min(minIndex, maxIndex), 
+				std::max(minIndex, maxIndex), 
+				_column.size() - 1 
+			};
+
+			output.push_back(_column.front());
+
+			for (std::size_t i{ 1 }, previous{}; i < picks.size(); ++i)
+			{
+				if (picks[i] <= previous)
+				{
+					continue;
+				}
+
+				auto vertex{ _column[picks[i]] };
+
+				for (auto j{ previous + 1 }; j < picks[i]; ++j)
+				{
+					if (_column[j].color.value == _emphasis.value)
+					{
+						vertex.color = _emphasis;
+					}
+				}
+
+				output.push_back(vertex);
+				previous = picks[i];
+			}
+
+			_column.clear();
+		}
+	};
+}
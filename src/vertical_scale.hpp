@@ -0,0 +1,325 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+
+#pragma once
+
+#include "utility/utility.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace pingstats // export
+{
+	namespace cr = std::chrono;
+
+	enum class ScaleMode
+	{
+		LINEAR,
+		LOG,
+	};
+
+	// The smallest of 1, 2, 5, 10, 20 ... that is at least value.
+	double niceCeil(double value)
+	{
+		const auto decade{ std::pow(10.0, std::floor(std::log10(value))) };
+
+		for (const auto step : { 1.0, 2.0, 5.0 })
+		{
+			if (value <= step * decade * (1.0 + 1e-9))
+			{
+				return step * decade;
+			}
+		}
+
+		return 10.0 * decade;
+	}
+
+	// The largest of 1, 2, 5, 10, 20 ... that is at most value.
+	double niceFloor(double value)
+	{
+		const auto decade{ std::pow(10.0, std::floor(std::log10(value))) };
+
+		for (const auto step : { 5.0, 2.0 })
+		{
+			if (value >= step * decade * (1.0 - 1e-9))
+			{
+				return step * decade;
+			}
+		}
+
+		return decade;
+	}
+
+	// Maps latencies to heights above the bottom edge of a plot, bottomMs 
+	// to 0 and topMs to the full height. Linear scales start at 0 ms, log 
+	// scales above it. Grid lines are at least MIN_GRID_PIXELS apart.
+	class VerticalScale
+	{
+		ScaleMode _mode{ ScaleMode::LINEAR };
+		double _bottomMs{};
+		double _topMs{ 100.0 };
+		double _height{ 1.0 };
+
+		// Per millisecond, or per e-fold of latency on a log scale.
+		double _pixelPerUnit{ 0.01 };
+		double _gridMs{ 50.0 };
+
+	public:
+		static constexpr double MIN_GRID_PIXELS{ 50.0 };
+
+		VerticalScale() = default;
+
+		VerticalScale(ScaleMode mode, double bottomMs, double topMs, double height)
+			: _mode{ mode }
+			, _bottomMs{ mode == ScaleMode::LOG ? std::max(bottomMs, 0.01) : 0.0 }
+			, _topMs{ std::max(topMs, _bottomMs * 2.0 + 0.1) }
+			, _height{ std::max(height, 1.0) }
+		{
+			if (_mode == ScaleMode::LOG)
+			{
+				_pixelPerUnit = _height / std::log(_topMs / _bottomMs);
+
+				// Thins out to decades when the 1, 2, 5 steps get too close.
+				_gridMs = std::log(2.0) * _pixelPerUnit >= MIN_GRID_PIXELS / 2.0 ? 1.0 : 10.0;
+			}
+			else
+			{
+				_pixelPerUnit = _height / (_topMs - _bottomMs);
+				_gridMs = niceCeil(MIN_GRID_PIXELS / _pixelPerUnit);
+			}
+		}
+
+		auto mode() const
+		{
+			return _mode;
+		}
+
+		auto bottomMs() const
+		{
+			return _bottomMs;
+		}
+
+		auto topMs() const
+		{
+			return _topMs;
+		}
+
+		auto height() const
+		{
+			return _height;
+		}
+
+		// Grid line distance on a linear scale.
+		auto gridMs() const
+		{
+			return _gridMs;
+		}
+
+		// Only meaningful on a linear scale: height is bottomMs subtracted
+		// and multiplied with this.
+		auto pixelPerMs() const
+		{
+			return _pixelPerUnit;
+		}
+
+		double pixels(double ms) const
+		{
+			if (_mode == ScaleMode::LOG)
+			{
+				return std::log(std::max(ms, _bottomMs) / _bottomMs) * _pixelPerUnit;
+			}
+
+			return (ms - _bottomMs) * _pixelPerUnit;
+		}
+
+		double latency(double pixels) const
+		{
+			if (_mode == ScaleMode::LOG)
+			{
+				return _bottomMs * std::exp(pixels / _pixelPerUnit);
+			}
+
+			return _bottomMs + pixels / _pixelPerUnit;
+		}
+
+		// Calls f(ms) for the grid lines in [bottomMs, topMs], upwards.
+		// Log scales have them at 1, 2, 5, 10 ... or only at the decades.
+		template <typename F>
+		void forEachGridLine(F&& f) const
+		{
+			if (_mode == ScaleMode::LINEAR)
+			{
+				for (auto ms{ _bottomMs }; ms <= _topMs; ms += _gridMs)
+				{
+					f(ms);
+				}
+
+				return;
+			}
+
+			for (auto decade{ std::pow(10.0, std::floor(std::log10(_bottomMs))) }; 
+				decade <= _topMs; decade *= 10.0)
+			{
+				for (const auto step : { 1.0, 2.0, 5.0 })
+				{
+					const auto ms{ step * decade };
+
+					if ((step == 1.0 || _gridMs == 1.0) && 
+						ms >= _bottomMs * (1.0 - 1e-9) && ms <= _topMs)
+					{
+						f(ms);
+					}
+				}
+			}
+		}
+
+		bool operator == (const VerticalScale& rhs) const
+		{
+			return _mode == rhs._mode && _bottomMs == rhs._bottomMs &&
+				_topMs == rhs._topMs && _height == rhs._height;
+		}
+
+		bool operator != (const VerticalScale& rhs) const
+		{
+			return !(*this == rhs);
+		}
+	};
+
+	// Fits a VerticalScale to the p1 and p99 of the visible latencies,
+	// with HEADROOM above and below. The scale grows as soon as the p99 is
+	// past the top, but only shrinks once the latencies fit in less than 
+	// 1 / SHRINK_MARGIN of it for shrinkDelay. Rescales are at least 
+	// minInterval apart, so a spike costs at most two of them; every 
+	// rescale repaints the plot.
+	class VerticalAutoScale
+	{
+		VerticalScale _scale;
+		bool _valid{};
+		std::size_t _rescales{};
+
+		cr::steady_clock::time_point _lastRescale{};
+		cr::steady_clock::time_point _shrinkSince{};
+		bool _shrinking{};
+
+		cr::nanoseconds _minInterval{ cr::seconds{ 1 } };
+		cr::nanoseconds _shrinkDelay{ cr::seconds{ 10 } };
+
+	public:
+		static constexpr double HEADROOM{ 1.25 };
+		static constexpr double SHRINK_MARGIN{ 1.5 };
+		static constexpr double MIN_TOP_MS{ 1.0 };
+
+		// Rounds up to 1, 1.5, 2, 3, 4, 5, 6 or 8 times a power of ten,
+		// finer than the grid steps so little of the height goes unused.
+		static double roundTopMs(double ms)
+		{
+			const auto decade{ std::pow(10.0, std::floor(std::log10(ms))) };
+
+			for (const auto step : { 1.0, 1.5, 2.0, 3.0, 4.0, 5.0, 6.0, 8.0 })
+			{
+				if (ms <= step * decade * (1.0 + 1e-9))
+				{
+					return step * decade;
+				}
+			}
+
+			return 10.0 * decade;
+		}
+
+		VerticalAutoScale() = default;
+
+		VerticalAutoScale(cr::nanoseconds minInterval, cr::nanoseconds shrinkDelay)
+			: _minInterval{ minInterval }
+			, _shrinkDelay{ shrinkDelay }
+		{}
+
+		auto& scale() const
+		{
+			return _scale;
+		}
+
+		// Times the scale changed other than by mode or height.
+		auto rescales() const
+		{
+			return _rescales;
+		}
+
+		// Returns true if the scale changed. Without samples, pass NaN.
+		bool update(
+			ScaleMode mode, 
+			double height, 
+			double lowMs, 
+			double highMs, 
+			cr::steady_clock::time_point now)
+		{
+			const auto reshaped{ !_valid || mode != _scale.mode() || height != _scale.height() };
+
+			if (std::isnan(highMs))
+			{
+				if (reshaped)
+				{
+					_scale = VerticalScale{ mode, 1.0, _valid ? _scale.topMs() : 100.0, height };
+					_valid = true;
+				}
+
+				return reshaped;
+			}
+
+			const VerticalScale target{ mode, 
+				niceFloor(std::max(lowMs / HEADROOM, 0.1)), 
+				roundTopMs(std::max(highMs * HEADROOM, MIN_TOP_MS)), height };
+
+			if (!reshaped)
+			{
+				const auto logScale{ mode == ScaleMode::LOG };
+				const auto grow{ highMs > _scale.topMs() || (logScale && lowMs < _scale.bottomMs()) };
+				const auto shrink{ target.topMs() * SHRINK_MARGIN < _scale.topMs() || 
+					(logScale && target.bottomMs() > _scale.bottomMs() * SHRINK_MARGIN) };
+
+				if (shrink && !_shrinking)
+				{
+					_shrinkSince = now;
+				}
+
+				_shrinking = shrink;
+
+				if (now - _lastRescale < _minInterval || 
+					!(grow || (shrink && now - _shrinkSince >= _shrinkDelay)))
+				{
+					return false;
+				}
+
+				_rescales += 1;
+			}
+
+			_scale = target;
+			_valid = true;
+			_lastRescale = now;
+			_shrinking = false;
+
+			return true;
+		}
+	};
+}
@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <string_view>
 
@@ -107,6 +108,11 @@ namespace winapi // export
 		{
 			return _deviceContext;
 		}
+
+		auto& paintRect() const
+		{
+			return _paintStruct.rcPaint;
+		}
 	};
 
 	class DeviceContext
@@ -223,23 +229,54 @@ namespace winapi // export
 
 	class MemoryCanvas
 	{
+	public:
+		// Pixel memory as a pagefile backed section, which a DIB can be
+		// created on. It outlives the DIB, so CanvasPool can hand the 
+		// committed pages to the next canvas.
+		class Storage
+		{
+			HandlePtr _section;
+			std::size_t _capacity{};
+
+		public:
+			static Storage allocate(std::size_t capacity)
+			{
+				const auto bytes{ static_cast<std::uint64_t>(capacity) * sizeof(std::uint32_t) };
+
+				Storage storage;
+				storage._section = HandlePtr{ CreateFileMappingW(
+					INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 
+					static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes), nullptr) };
+
+				if (storage._section == nullptr)
+				{
+					throw WindowsError("CreateFileMappingW()");
+				}
+
+				storage._capacity = capacity;
+				return storage;
+			}
+
+			std::size_t capacity() const
+			{
+				return _section != nullptr ? _capacity : 0;
+			}
+
+			HANDLE section() const
+			{
+				return _section.get();
+			}
+		};
+
+	private:
+		// Declared before the bitmap, the view has to go first.
+		Storage _storage;
 		BitmapPtr _bitmap;
 		std::uint32_t* _pixelPtr{};
 		LONG _width{};
 		LONG _height{};
 
-	public:
-		MemoryCanvas(MemoryCanvas&& other)
-			: MemoryCanvas{}
-		{
-			*this = std::move(other);
-		}
-
-		constexpr MemoryCanvas() = default;
-
-		MemoryCanvas(LONG width, LONG height, bool isTopDown = true)
-			: _width{ width }
-			, _height{ height }
+		void createBitmap(HANDLE section, bool isTopDown)
 		{
 			if (_width != 0 && _height != 0)
 			{
@@ -251,7 +288,7 @@ namespace winapi // export
 
 				_bitmap = BitmapPtr{ CreateDIBSection(
 					nullptr, &bitmapInfo, DIB_RGB_COLORS, 
-					reinterpret_cast<void**>(&_pixelPtr), nullptr, 0) };
+					reinterpret_cast<void**>(&_pixelPtr), section, 0) };
 
 				if (_bitmap == nullptr)
 				{
@@ -260,9 +297,35 @@ namespace winapi // export
 			}
 		}
 
+	public:
+		MemoryCanvas(MemoryCanvas&& other)
+			: MemoryCanvas{}
+		{
+			*this = std::move(other);
+		}
+
+		constexpr MemoryCanvas() = default;
+
+		MemoryCanvas(LONG width, LONG height, bool isTopDown = true)
+			: _width{ width }
+			, _height{ height }
+		{
+			createBitmap(nullptr, isTopDown);
+		}
+
+		// Takes storage that holds at least width * height pixels.
+		MemoryCanvas(LONG width, LONG height, Storage storage, bool isTopDown = true)
+			: _storage{ std::move(storage) }
+			, _width{ width }
+			, _height{ height }
+		{
+			createBitmap(_storage.section(), isTopDown);
+		}
+
 		MemoryCanvas& operator = (MemoryCanvas&& other)
 		{
 			_bitmap = std::move(other._bitmap);
+			_storage = std::move(other._storage);
 			_pixelPtr = other._pixelPtr;
 			_width = other._width;
 			_height = other._height;
@@ -272,6 +335,17 @@ namespace winapi // export
 			return *this;
 		}
 
+		// Leaves the canvas empty. Storage of canvases that were created
+		// without one is empty as well.
+		Storage releaseStorage()
+		{
+			_bitmap.reset();
+			_pixelPtr = {};
+			_width = {};
+			_height = {};
+			return std::move(_storage);
+		}
+
 		auto get()
 		{
 			return _bitmap.get();
@@ -0,0 +1,182 @@
+/* 
+ * Copyright (c) 2016 - 2017 cooky451
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <set>
+#include <vector>
+
+namespace pingstats // export
+{
+	// One quantile of a multiset that changes a sample at a time. The 
+	// lower set holds the samples up to the quantile's rank, so the 
+	// quantile is its largest element and any update is O(log n).
+	class WindowedQuantile
+	{
+		double _quantile{};
+		std::multiset<double> _lower;
+		std::multiset<double> _upper;
+
+	public:
+		WindowedQuantile() = default;
+
+		explicit WindowedQuantile(double quantile)
+			: _quantile{ quantile }
+		{}
+
+		std::size_t size() const
+		{
+			return _lower.size() + _upper.size();
+		}
+
+		// Only defined while size() > 0.
+		double value() const
+		{
+			return *std::prev(_lower.end());
+		}
+
+		void insert(double sample)
+		{
+			if (!_lower.empty() && sample < value())
+			{
+				_lower.insert(sample);
+			}
+			else
+			{
+				_upper.insert(sample);
+			}
+
+			rebalance();
+		}
+
+		// Reuses the node of oldSample, which has to be in the set, 
+		// so a full window is updated without allocating.
+		void replace(double oldSample, double newSample)
+		{
+			auto node{ oldSample <= value() ? 
+				_lower.extract(_lower.find(oldSample)) : 
+				_upper.extract(_upper.find(oldSample)) };
+
+			node.value() = newSample;
+
+			if (!_lower.empty() && newSample < value())
+			{
+				_lower.insert(std::move(node));
+			}
+			else
+			{
+				_upper.insert(std::move(node));
+			}
+
+			rebalance();
+		}
+
+	private:
+		void rebalance()
+		{
+			// Nearest rank, so the quantile is always one of the samples.
+			const auto lowerSize{ static_cast<std::size_t>(
+				_quantile * (size() - 1) + 0.5) + 1 };
+
+			while (_lower.size() > lowerSize)
+			{
+				_upper.insert(_lower.extract(std::prev(_lower.end())));
+			}
+
+			while (_lower.size() < lowerSize && !_upper.empty())
+			{
+				_lower.insert(_upper.extract(_upper.begin()));
+			}
+		}
+	};
+
+	struct LatencyBand
+	{
+		float lowMs{ std::numeric_limits<float>::quiet_NaN() };
+		float highMs{ std::numeric_limits<float>::quiet_NaN() };
+
+		bool valid() const
+		{
+			return !std::isnan(lowMs);
+		}
+	};
+
+	// The p10 and p90 latency of the last few samples.
+	class LatencyBandWindow
+	{
+		std::vector<double> _samples;
+		std::size_t _window{ 1 };
+		std::size_t _oldest{};
+
+		WindowedQuantile _low{ 0.1 };
+		WindowedQuantile _high{ 0.9 };
+
+	public:
+		LatencyBandWindow() = default;
+
+		explicit LatencyBandWindow(std::size_t window)
+			: _window{ window < 1 ? 1 : window }
+		{
+			_samples.reserve(_window);
+		}
+
+		auto window() const
+		{
+			return _window;
+		}
+
+		void push(double latencyMs)
+		{
+			if (_samples.size() < _window)
+			{
+				_samples.push_back(latencyMs);
+				_low.insert(latencyMs);
+				_high.insert(latencyMs);
+			}
+			else
+			{
+				auto& oldest{ _samples[_oldest] };
+
+				_low.replace(oldest, latencyMs);
+				_high.replace(oldest, latencyMs);
+
+				oldest = latencyMs;
+				_oldest = (_oldest + 1) % _window;
+			}
+		}
+
+		LatencyBand band() const
+		{
+			if (_samples.empty())
+			{
+				return {};
+			}
+
+			return { static_cast<float>(_low.value()), static_cast<float>(_high.value()) };
+		}
+	};
+}